@@ -1,6 +1,7 @@
 // QuUI.cpp
 // Точка входа SDK — инициализирует подсистемы при подключении/линковке QuUI
 #include "QuUI.h"
+#include "core/renderer.hpp"
 
 #include <atomic>
 #include <mutex>
@@ -79,6 +80,24 @@ namespace {
     } s_autoInit;
 }
 
+// Перевод статистики рендерера в C-структуру
+namespace {
+    void CopyRenderStats(const gui::RenderStats& stats, QuUI_RenderStats* out)
+    {
+        out->drawCalls = stats.drawCalls;
+        out->primitives = stats.primitives;
+        out->stateChanges = stats.stateChanges;
+        out->clipPushes = stats.clipPushes;
+        out->pixelsFilled = stats.pixelsFilled;
+        out->frameTimeMs = stats.frameTimeMs;
+    }
+
+    const gui::Renderer* ToRenderer(const QuUI_Renderer* renderer)
+    {
+        return reinterpret_cast<const gui::Renderer*>(renderer);
+    }
+}
+
 // C-совместимый API-обёртки (удобно для DLL/SO)
 extern "C" {
 
@@ -87,4 +106,38 @@ void QuUI_Shutdown()      { QuUI::Shutdown(); }
 bool QuUI_IsInitialized() { return QuUI::IsInitialized(); }
 const char* QuUI_Version(){ return QuUI::Version(); }
 
+bool QuUI_GetRenderStats(const QuUI_Renderer* renderer, QuUI_RenderStats* out)
+{
+    if (!renderer || !out)
+        return false;
+    CopyRenderStats(ToRenderer(renderer)->getRenderStats(), out);
+    return true;
+}
+
+bool QuUI_GetAverageRenderStats(const QuUI_Renderer* renderer, QuUI_RenderStats* out)
+{
+    if (!renderer || !out)
+        return false;
+    CopyRenderStats(ToRenderer(renderer)->getAverageRenderStats(), out);
+    return true;
+}
+
+size_t QuUI_GetRenderStatsHistory(const QuUI_Renderer* renderer, QuUI_RenderStats* out, size_t maxFrames)
+{
+    if (!renderer || !out)
+        return 0;
+    const gui::RenderStatsHistory& history = ToRenderer(renderer)->getRenderStatsHistory();
+    const size_t count = history.size() < maxFrames ? history.size() : maxFrames;
+    const size_t first = history.size() - count;
+    for (size_t i = 0; i < count; ++i)
+        CopyRenderStats(history.at(first + i), out + i);
+    return count;
+}
+
+void QuUI_SetRenderStatsWindow(QuUI_Renderer* renderer, size_t frames)
+{
+    if (renderer)
+        reinterpret_cast<gui::Renderer*>(renderer)->setRenderStatsWindow(frames);
+}
+
 }
\ No newline at end of file
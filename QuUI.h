@@ -1,6 +1,8 @@
 #ifndef QUUI_H
 #define QUUI_H
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <functional>
@@ -101,4 +103,29 @@ struct UIConfig {
 
 } // namespace QuUI
 
-#endif // QUUI_H
+// C API for render statistics. A QuUI_Renderer* is a gui::Renderer* passed
+// through an opaque pointer; the renderer must not be drawing on another thread.
+extern "C" {
+
+typedef struct QuUI_Renderer QuUI_Renderer;
+
+typedef struct QuUI_RenderStats {
+    uint64_t drawCalls;
+    uint64_t primitives;
+    uint64_t stateChanges;
+    uint64_t clipPushes;
+    uint64_t pixelsFilled;
+    double frameTimeMs;
+} QuUI_RenderStats;
+
+// Last completed frame; returns false if renderer or out is null
+bool QuUI_GetRenderStats(const QuUI_Renderer* renderer, QuUI_RenderStats* out);
+// Rolling average over the statistics window
+bool QuUI_GetAverageRenderStats(const QuUI_Renderer* renderer, QuUI_RenderStats* out);
+// Copies up to maxFrames most recent frames, oldest first; returns the number copied
+size_t QuUI_GetRenderStatsHistory(const QuUI_Renderer* renderer, QuUI_RenderStats* out, size_t maxFrames);
+void QuUI_SetRenderStatsWindow(QuUI_Renderer* renderer, size_t frames);
+
+}
+
+#endif // QUUI_H
\ No newline at end of file
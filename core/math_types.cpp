@@ -0,0 +1,51 @@
+#include "math_types.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GUI_MATH_SSE2 1
+#endif
+
+namespace gui {
+
+void Affine::transformPoints(const Vector2f* src, Vector2f* dst, size_t count, size_t stride) const {
+    const char* in = reinterpret_cast<const char*>(src);
+    char* out = reinterpret_cast<char*>(dst);
+    size_t i = 0;
+
+#ifdef GUI_MATH_SSE2
+    // Две точки за итерацию: [x0 x0 x1 x1] * [a b a b] + [y0 y0 y1 y1] * [c d c d] + [tx ty tx ty].
+    // Порядок операций тот же, что в apply(), поэтому результат совпадает побитно.
+    const __m128 ab = _mm_setr_ps(a, b, a, b);
+    const __m128 cd = _mm_setr_ps(c, d, c, d);
+    const __m128 t = _mm_setr_ps(tx, ty, tx, ty);
+
+    if (stride == sizeof(Vector2f)) {
+        for (; i + 2 <= count; i += 2) {
+            const __m128 p = _mm_loadu_ps(reinterpret_cast<const float*>(in + i * stride));
+            const __m128 xs = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 0, 0));
+            const __m128 ys = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 1, 1));
+            const __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(xs, ab), _mm_mul_ps(ys, cd)), t);
+            _mm_storeu_ps(reinterpret_cast<float*>(out + i * stride), r);
+        }
+    } else {
+        // Позиции внутри более крупных структур собираются 64-битными загрузками
+        for (; i + 2 <= count; i += 2) {
+            __m128 p = _mm_setzero_ps();
+            p = _mm_loadl_pi(p, reinterpret_cast<const __m64*>(in + i * stride));
+            p = _mm_loadh_pi(p, reinterpret_cast<const __m64*>(in + (i + 1) * stride));
+            const __m128 xs = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 0, 0));
+            const __m128 ys = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 1, 1));
+            const __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(xs, ab), _mm_mul_ps(ys, cd)), t);
+            _mm_storel_pi(reinterpret_cast<__m64*>(out + i * stride), r);
+            _mm_storeh_pi(reinterpret_cast<__m64*>(out + (i + 1) * stride), r);
+        }
+    }
+#endif
+
+    for (; i < count; ++i) {
+        const Vector2f p = *reinterpret_cast<const Vector2f*>(in + i * stride);
+        *reinterpret_cast<Vector2f*>(out + i * stride) = apply(p);
+    }
+}
+
+} // namespace gui
\ No newline at end of file
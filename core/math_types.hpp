@@ -1,5 +1,6 @@
 #pragma once
 #include <cmath>
+#include <cstddef>
 
 namespace gui {
 
@@ -62,6 +63,44 @@ struct Rect {
                position.y + size.y > other.position.y;
     }
     
+    bool isEmpty() const {
+        return size.x <= 0.0f || size.y <= 0.0f;
+    }
+    
+    float area() const {
+        return isEmpty() ? 0.0f : size.x * size.y;
+    }
+    
+    bool contains(const Rect& other) const {
+        return other.position.x >= position.x && other.position.y >= position.y &&
+               other.position.x + other.size.x <= position.x + size.x &&
+               other.position.y + other.size.y <= position.y + size.y;
+    }
+    
+    // Пересечение; пустой результат имеет нулевой размер
+    Rect intersected(const Rect& other) const {
+        const float x0 = std::fmax(position.x, other.position.x);
+        const float y0 = std::fmax(position.y, other.position.y);
+        const float x1 = std::fmin(position.x + size.x, other.position.x + other.size.x);
+        const float y1 = std::fmin(position.y + size.y, other.position.y + other.size.y);
+        if (x1 <= x0 || y1 <= y0)
+            return Rect(Vector2f(x0, y0), Vector2f());
+        return Rect(Vector2f(x0, y0), Vector2f(x1 - x0, y1 - y0));
+    }
+    
+    // Наименьший прямоугольник, содержащий оба; пустые прямоугольники не учитываются
+    Rect united(const Rect& other) const {
+        if (other.isEmpty())
+            return *this;
+        if (isEmpty())
+            return other;
+        const float x0 = std::fmin(position.x, other.position.x);
+        const float y0 = std::fmin(position.y, other.position.y);
+        const float x1 = std::fmax(position.x + size.x, other.position.x + other.size.x);
+        const float y1 = std::fmax(position.y + size.y, other.position.y + other.size.y);
+        return Rect(Vector2f(x0, y0), Vector2f(x1 - x0, y1 - y0));
+    }
+    
     Vector2f getCenter() const {
         return position + size * 0.5f;
     }
@@ -107,6 +146,114 @@ struct Color {
     static Color transparent() { return Color(0, 0, 0, 0); }
 };
 
+struct Transform;
+
+// Аффинное преобразование 2x3: x' = a*x + c*y + tx, y' = b*x + d*y + ty.
+// Тригонометрия считается один раз при построении, применение к точке —
+// только умножения и сложения. В отличие от Transform композиция точная
+// и сохраняет сдвиг.
+struct Affine {
+    float a = 1.0f, b = 0.0f, c = 0.0f, d = 1.0f, tx = 0.0f, ty = 0.0f;
+    
+    static Affine translation(float x, float y) {
+        Affine m;
+        m.tx = x;
+        m.ty = y;
+        return m;
+    }
+    
+    static Affine scaling(float sx, float sy) {
+        Affine m;
+        m.a = sx;
+        m.d = sy;
+        return m;
+    }
+    
+    // Поворот в градусах, как в Transform
+    static Affine rotation(float degrees) {
+        const float rad = degrees * 3.14159265358979323846f / 180.0f;
+        const float cosR = std::cos(rad);
+        const float sinR = std::sin(rad);
+        Affine m;
+        m.a = cosR;
+        m.b = sinR;
+        m.c = -sinR;
+        m.d = cosR;
+        return m;
+    }
+    
+    static Affine fromTransform(const Transform& transform);
+    
+    // Композиция: сначала other, затем this
+    Affine operator*(const Affine& other) const {
+        Affine m;
+        m.a = a * other.a + c * other.b;
+        m.b = b * other.a + d * other.b;
+        m.c = a * other.c + c * other.d;
+        m.d = b * other.c + d * other.d;
+        m.tx = a * other.tx + c * other.ty + tx;
+        m.ty = b * other.tx + d * other.ty + ty;
+        return m;
+    }
+    
+    Vector2f apply(const Vector2f& p) const {
+        return Vector2f(a * p.x + c * p.y + tx, b * p.x + d * p.y + ty);
+    }
+    
+    // Без переноса — для направлений и размеров
+    Vector2f applyVector(const Vector2f& v) const {
+        return Vector2f(a * v.x + c * v.y, b * v.x + d * v.y);
+    }
+    
+    // Ограничивающий прямоугольник образа rect
+    Rect mapRect(const Rect& rect) const {
+        if (isAxisAligned()) {
+            const Vector2f p0 = apply(rect.position);
+            const Vector2f p1 = apply(rect.position + rect.size);
+            return Rect(Vector2f(std::fmin(p0.x, p1.x), std::fmin(p0.y, p1.y)),
+                        Vector2f(std::fabs(p1.x - p0.x), std::fabs(p1.y - p0.y)));
+        }
+        const Vector2f p0 = apply(rect.position);
+        const Vector2f p1 = apply(Vector2f(rect.position.x + rect.size.x, rect.position.y));
+        const Vector2f p2 = apply(rect.position + rect.size);
+        const Vector2f p3 = apply(Vector2f(rect.position.x, rect.position.y + rect.size.y));
+        const float x0 = std::fmin(std::fmin(p0.x, p1.x), std::fmin(p2.x, p3.x));
+        const float y0 = std::fmin(std::fmin(p0.y, p1.y), std::fmin(p2.y, p3.y));
+        const float x1 = std::fmax(std::fmax(p0.x, p1.x), std::fmax(p2.x, p3.x));
+        const float y1 = std::fmax(std::fmax(p0.y, p1.y), std::fmax(p2.y, p3.y));
+        return Rect(Vector2f(x0, y0), Vector2f(x1 - x0, y1 - y0));
+    }
+    
+    // Пакетное преобразование точек; stride — шаг в байтах между точками
+    // в src и dst, что позволяет обрабатывать позиции внутри массива вершин.
+    // src и dst могут совпадать.
+    void transformPoints(const Vector2f* src, Vector2f* dst, size_t count,
+                         size_t stride = sizeof(Vector2f)) const;
+    
+    Affine inverse() const {
+        const float det = a * d - b * c;
+        Affine m;
+        if (std::fabs(det) < 1e-12f) {
+            m.a = m.d = 0.0f;
+            return m;
+        }
+        const float invDet = 1.0f / det;
+        m.a = d * invDet;
+        m.b = -b * invDet;
+        m.c = -c * invDet;
+        m.d = a * invDet;
+        m.tx = -(m.a * tx + m.c * ty);
+        m.ty = -(m.b * tx + m.d * ty);
+        return m;
+    }
+    
+    bool isIdentity() const {
+        return a == 1.0f && b == 0.0f && c == 0.0f && d == 1.0f && tx == 0.0f && ty == 0.0f;
+    }
+    bool isAxisAligned() const { return b == 0.0f && c == 0.0f; }
+    float scaleFactor() const { return std::sqrt(std::fabs(a * d - b * c)); }
+};
+
 struct Transform {
     Vector2f position;
     Vector2f scale;
@@ -117,23 +264,30 @@ struct Transform {
              float rot = 0.0f)
         : position(pos), scale(scl), rotation(rot) {}
     
+    // Матрица того же преобразования: масштаб, поворот, перенос
+    Affine toMatrix() const {
+        float cosine, sine;
+        rotationTrig(cosine, sine);
+        Affine m;
+        m.a = cosine * scale.x;
+        m.b = sine * scale.x;
+        m.c = -sine * scale.y;
+        m.d = cosine * scale.y;
+        m.tx = position.x;
+        m.ty = position.y;
+        return m;
+    }
+    
     Vector2f transformPoint(const Vector2f& point) const {
-        // Применяем масштаб
-        Vector2f scaled(point.x * scale.x, point.y * scale.y);
-        
-        // Применяем поворот
-        float rad = rotation * 3.14159f / 180.0f;
-        float cos_r = std::cos(rad);
-        float sin_r = std::sin(rad);
-        Vector2f rotated(
-            scaled.x * cos_r - scaled.y * sin_r,
-            scaled.x * sin_r + scaled.y * cos_r
-        );
-        
-        // Применяем перемещение
-        return rotated + position;
+        float cosine, sine;
+        rotationTrig(cosine, sine);
+        const Vector2f scaled(point.x * scale.x, point.y * scale.y);
+        return Vector2f(scaled.x * cosine - scaled.y * sine + position.x,
+                        scaled.x * sine + scaled.y * cosine + position.y);
     }
     
+    // Приближённая композиция: поворот и неравномерный масштаб не коммутируют,
+    // поэтому для точного результата используйте toMatrix() и Affine::operator*
     Transform& combine(const Transform& other) {
         // Комбинируем масштаб
         scale.x *= other.scale.x;
@@ -147,6 +301,25 @@ struct Transform {
         
         return *this;
     }
+    
+private:
+    // Считается на месте при каждом вызове: преобразование читают потоки
+    // записи, и общего кэша в const-методах быть не должно. Без поворота
+    // тригонометрия не нужна
+    void rotationTrig(float& cosine, float& sine) const {
+        if (rotation == 0.0f) {
+            cosine = 1.0f;
+            sine = 0.0f;
+            return;
+        }
+        const float rad = rotation * 3.14159265358979323846f / 180.0f;
+        cosine = std::cos(rad);
+        sine = std::sin(rad);
+    }
 };
 
+inline Affine Affine::fromTransform(const Transform& transform) {
+    return transform.toMatrix();
+}
+
 } // namespace gui
\ No newline at end of file
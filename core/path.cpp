@@ -0,0 +1,187 @@
+#include "path.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace gui {
+
+namespace {
+
+constexpr unsigned int kMaxCurveSegments = 256;
+// Четверть эллипса кубической кривой: контрольные точки на 0.5523 радиуса
+constexpr float kEllipseKappa = 0.5522847498f;
+
+unsigned int curveSegments(float deviation, float tolerance) {
+    if (deviation <= 0.0f)
+        return 1;
+    const float segments = std::ceil(std::sqrt(deviation / std::max(tolerance, 1e-4f)));
+    return static_cast<unsigned int>(std::clamp(segments, 1.0f, static_cast<float>(kMaxCurveSegments)));
+}
+
+} // namespace
+
+void Path::append(Verb verb, const Vector2f* points, size_t count) {
+    verbs_.push_back(verb);
+    hash_ = (hash_ ^ static_cast<uint8_t>(verb)) * 1099511628211ull;
+    for (size_t i = 0; i < count; ++i) {
+        points_.push_back(points[i]);
+        uint8_t bytes[sizeof(Vector2f)];
+        std::memcpy(bytes, &points[i], sizeof(bytes));
+        for (uint8_t byte : bytes) {
+            hash_ = (hash_ ^ byte) * 1099511628211ull;
+        }
+    }
+}
+
+void Path::ensureContour() {
+    if (!contourOpen_)
+        moveTo(contourStart_);
+}
+
+Path& Path::moveTo(const Vector2f& point) {
+    append(Verb::Move, &point, 1);
+    contourStart_ = point;
+    contourOpen_ = true;
+    return *this;
+}
+
+Path& Path::lineTo(const Vector2f& point) {
+    ensureContour();
+    append(Verb::Line, &point, 1);
+    return *this;
+}
+
+Path& Path::quadTo(const Vector2f& control, const Vector2f& point) {
+    ensureContour();
+    const Vector2f points[2] = {control, point};
+    append(Verb::Quad, points, 2);
+    return *this;
+}
+
+Path& Path::cubicTo(const Vector2f& control1, const Vector2f& control2, const Vector2f& point) {
+    ensureContour();
+    const Vector2f points[3] = {control1, control2, point};
+    append(Verb::Cubic, points, 3);
+    return *this;
+}
+
+// Следующий контур без moveTo начнётся там же, где начинался замкнутый
+Path& Path::close() {
+    if (contourOpen_) {
+        append(Verb::Close, nullptr, 0);
+        contourOpen_ = false;
+    }
+    return *this;
+}
+
+Path& Path::addRect(const Rect& rect) {
+    const Vector2f& p = rect.position;
+    moveTo(p);
+    lineTo(Vector2f(p.x + rect.size.x, p.y));
+    lineTo(p + rect.size);
+    lineTo(Vector2f(p.x, p.y + rect.size.y));
+    return close();
+}
+
+Path& Path::addEllipse(const Rect& rect) {
+    const Vector2f radius = rect.size * 0.5f;
+    const Vector2f center = rect.position + radius;
+    const Vector2f k = radius * kEllipseKappa;
+    moveTo(Vector2f(center.x + radius.x, center.y));
+    cubicTo(Vector2f(center.x + radius.x, center.y + k.y), Vector2f(center.x + k.x, center.y + radius.y),
+            Vector2f(center.x, center.y + radius.y));
+    cubicTo(Vector2f(center.x - k.x, center.y + radius.y), Vector2f(center.x - radius.x, center.y + k.y),
+            Vector2f(center.x - radius.x, center.y));
+    cubicTo(Vector2f(center.x - radius.x, center.y - k.y), Vector2f(center.x - k.x, center.y - radius.y),
+            Vector2f(center.x, center.y - radius.y));
+    cubicTo(Vector2f(center.x + k.x, center.y - radius.y), Vector2f(center.x + radius.x, center.y - k.y),
+            Vector2f(center.x + radius.x, center.y));
+    return close();
+}
+
+void Path::clear() {
+    verbs_.clear();
+    points_.clear();
+    hash_ = Path().hash_;
+    contourStart_ = Vector2f();
+    contourOpen_ = false;
+}
+
+Rect Path::getBounds() const {
+    if (points_.empty())
+        return Rect();
+    float minX = points_[0].x, maxX = points_[0].x;
+    float minY = points_[0].y, maxY = points_[0].y;
+    for (const Vector2f& p : points_) {
+        minX = std::min(minX, p.x);
+        maxX = std::max(maxX, p.x);
+        minY = std::min(minY, p.y);
+        maxY = std::max(maxY, p.y);
+    }
+    return Rect(Vector2f(minX, minY), Vector2f(maxX - minX, maxY - minY));
+}
+
+// Отклонение хорды на участке длины 1/n не больше |B''| / (8 n^2):
+// у квадратичной кривой B'' = 2 (p0 - 2 p1 + p2), у кубической |B''| <= 6 max|p_i - 2 p_i+1 + p_i+2|
+void Path::flatten(float tolerance, std::vector<Vector2f>& points, std::vector<uint32_t>& contourEnds,
+                   std::vector<uint8_t>& closed) const {
+    points.clear();
+    contourEnds.clear();
+    closed.clear();
+
+    size_t contourBegin = 0;
+    auto finishContour = [&](bool isClosed) {
+        if (points.size() > contourBegin) {
+            contourEnds.push_back(static_cast<uint32_t>(points.size()));
+            closed.push_back(isClosed ? 1 : 0);
+        }
+        contourBegin = points.size();
+    };
+
+    size_t index = 0;
+    for (Verb verb : verbs_) {
+        switch (verb) {
+            case Verb::Move:
+                finishContour(false);
+                points.push_back(points_[index++]);
+                break;
+            case Verb::Line:
+                points.push_back(points_[index++]);
+                break;
+            case Verb::Quad: {
+                const Vector2f p0 = points.back();
+                const Vector2f& p1 = points_[index];
+                const Vector2f& p2 = points_[index + 1];
+                index += 2;
+                const unsigned int n = curveSegments((p0 - p1 * 2.0f + p2).length() * 0.25f, tolerance);
+                for (unsigned int i = 1; i <= n; ++i) {
+                    const float t = static_cast<float>(i) / static_cast<float>(n);
+                    const float u = 1.0f - t;
+                    points.push_back(p0 * (u * u) + p1 * (2.0f * u * t) + p2 * (t * t));
+                }
+                break;
+            }
+            case Verb::Cubic: {
+                const Vector2f p0 = points.back();
+                const Vector2f& p1 = points_[index];
+                const Vector2f& p2 = points_[index + 1];
+                const Vector2f& p3 = points_[index + 2];
+                index += 3;
+                const float bend = std::max((p0 - p1 * 2.0f + p2).length(), (p1 - p2 * 2.0f + p3).length());
+                const unsigned int n = curveSegments(bend * 0.75f, tolerance);
+                for (unsigned int i = 1; i <= n; ++i) {
+                    const float t = static_cast<float>(i) / static_cast<float>(n);
+                    const float u = 1.0f - t;
+                    points.push_back(p0 * (u * u * u) + p1 * (3.0f * u * u * t) + p2 * (3.0f * u * t * t) +
+                                     p3 * (t * t * t));
+                }
+                break;
+            }
+            case Verb::Close:
+                finishContour(true);
+                break;
+        }
+    }
+    finishContour(false);
+}
+
+} // namespace gui
\ No newline at end of file
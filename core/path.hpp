@@ -0,0 +1,97 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "math_types.hpp"
+
+namespace gui {
+
+// Правило заполнения самопересекающихся и вложенных контуров
+enum class FillRule : uint8_t {
+    NonZero,    // внутри, если сумма направлений пересечённых контуров не ноль
+    EvenOdd     // внутри, если число пересечённых контуров нечётно
+};
+
+enum class LineJoin : uint8_t {
+    Miter,
+    Round,
+    Bevel
+};
+
+enum class LineCap : uint8_t {
+    Butt,
+    Round,
+    Square
+};
+
+struct StrokeStyle {
+    float width = 1.0f;
+    LineJoin join = LineJoin::Miter;
+    LineCap cap = LineCap::Butt;
+    // Отношение длины острия к полутолщине, сверх которого угол срезается
+    float miterLimit = 4.0f;
+};
+
+// Векторный путь из контуров с отрезками и кривыми Безье. Хранит команды
+// и точки как есть; ломаные строит кэш рендерера. Хэш содержимого
+// обновляется при каждой команде и служит ключом кэша, поэтому путь,
+// заново построенный с теми же точками, попадает в кэш.
+class Path {
+public:
+    enum class Verb : uint8_t {
+        Move,
+        Line,
+        Quad,
+        Cubic,
+        Close
+    };
+
+    Path& moveTo(const Vector2f& point);
+    // Без moveTo контур начинается в (0, 0) или в начале последнего замкнутого
+    Path& lineTo(const Vector2f& point);
+    Path& quadTo(const Vector2f& control, const Vector2f& point);
+    Path& cubicTo(const Vector2f& control1, const Vector2f& control2, const Vector2f& point);
+    Path& close();
+
+    // Контуры прямоугольника и эллипса, вписанного в прямоугольник
+    Path& addRect(const Rect& rect);
+    Path& addEllipse(const Rect& rect);
+
+    void clear();
+    bool isEmpty() const { return verbs_.empty(); }
+
+    const std::vector<Verb>& getVerbs() const { return verbs_; }
+    const std::vector<Vector2f>& getPoints() const { return points_; }
+    uint64_t getHash() const { return hash_; }
+    // Охватывает контрольные точки, а значит, и сами кривые
+    Rect getBounds() const;
+
+    // Ломаные контуров: кривые делятся так, чтобы хорда отходила от кривой
+    // не дальше tolerance. contourEnds — конец каждого контура в points,
+    // closed — был ли он замкнут командой close()
+    void flatten(float tolerance, std::vector<Vector2f>& points, std::vector<uint32_t>& contourEnds,
+                 std::vector<uint8_t>& closed) const;
+
+private:
+    void append(Verb verb, const Vector2f* points, size_t count);
+    void ensureContour();
+
+    std::vector<Verb> verbs_;
+    std::vector<Vector2f> points_;
+    uint64_t hash_ = 14695981039346656037ull;
+    Vector2f contourStart_;
+    bool contourOpen_ = false;
+};
+
+// Область, которую закрашивает обводка пути: острие угла выходит
+// не дальше miterLimit полутолщин, квадратный конец — на полтолщины по диагонали
+inline Rect strokeBounds(const Rect& bounds, const StrokeStyle& stroke) {
+    float reach = stroke.width * 0.5f;
+    if (stroke.join == LineJoin::Miter)
+        reach *= stroke.miterLimit > 1.4143f ? stroke.miterLimit : 1.4143f;
+    else if (stroke.cap == LineCap::Square)
+        reach *= 1.4143f;
+    return Rect(bounds.position - Vector2f(reach, reach), bounds.size + Vector2f(reach * 2.0f, reach * 2.0f));
+}
+
+} // namespace gui
\ No newline at end of file
@@ -0,0 +1,391 @@
+#include "renderer.hpp"
+#include "../render/path_cache.hpp"
+#include "../render/software_renderer.hpp"
+#include "../render/tessellation_cache.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace gui {
+
+namespace {
+thread_local Renderer* t_currentRenderer = nullptr;
+thread_local TessellationCache t_tessellation;
+thread_local PathCache t_paths;
+thread_local std::vector<Vector2f> t_trianglePoints;
+thread_local std::vector<Vertex> t_triangleVertices;
+
+void fillTriangleList(Renderer& renderer, const std::vector<Vector2f>& points, const Color& color) {
+    if (!renderer.supportsTriangleBatches()) {
+        for (size_t i = 0; i + 2 < points.size(); i += 3) {
+            renderer.fillTriangle(points[i], points[i + 1], points[i + 2], color);
+        }
+        return;
+    }
+
+    t_triangleVertices.clear();
+    for (const Vector2f& point : points) {
+        t_triangleVertices.push_back(Vertex{point, Vector2f(), color});
+    }
+    renderer.drawTriangles(t_triangleVertices.data(), t_triangleVertices.size(), std::string());
+}
+
+// Границы трёх отрезков одной оси: начальный отступ, середина, конечный отступ
+void sliceAxis(float sourceStart, float sourceSize, float destStart, float destSize, float head, float tail,
+               float* source, float* dest) {
+    head = std::clamp(head, 0.0f, sourceSize);
+    tail = std::clamp(tail, 0.0f, sourceSize - head);
+    const float fit = head + tail > destSize && head + tail > 0.0f ? destSize / (head + tail) : 1.0f;
+    source[0] = sourceStart;
+    source[1] = sourceStart + head;
+    source[2] = sourceStart + sourceSize - tail;
+    source[3] = sourceStart + sourceSize;
+    dest[0] = destStart;
+    dest[1] = destStart + head * fit;
+    dest[2] = destStart + destSize - tail * fit;
+    dest[3] = destStart + destSize;
+}
+
+}
+
+RenderStatsHistory::RenderStatsHistory(size_t capacity) : capacity_(capacity > 0 ? capacity : 1) {}
+
+void RenderStatsHistory::push(const RenderStats& stats) {
+    ++frameCount_;
+    if (frames_.size() < capacity_) {
+        frames_.push_back(stats);
+        return;
+    }
+    frames_[head_] = stats;
+    head_ = (head_ + 1) % capacity_;
+}
+
+void RenderStatsHistory::clear() {
+    frames_.clear();
+    head_ = 0;
+}
+
+void RenderStatsHistory::setCapacity(size_t capacity) {
+    capacity = capacity > 0 ? capacity : 1;
+    // Сохраняются последние кадры в порядке от старых к новым
+    std::vector<RenderStats> kept;
+    const size_t count = std::min(frames_.size(), capacity);
+    kept.reserve(count);
+    for (size_t i = frames_.size() - count; i < frames_.size(); ++i) {
+        kept.push_back(at(i));
+    }
+    frames_.swap(kept);
+    capacity_ = capacity;
+    head_ = 0;
+}
+
+const RenderStats& RenderStatsHistory::at(size_t index) const {
+    return frames_[(head_ + index) % frames_.size()];
+}
+
+RenderStats RenderStatsHistory::average() const {
+    RenderStats result;
+    if (frames_.empty())
+        return result;
+
+    double sums[5] = {0.0, 0.0, 0.0, 0.0, 0.0};
+    for (const RenderStats& frame : frames_) {
+        sums[0] += static_cast<double>(frame.drawCalls);
+        sums[1] += static_cast<double>(frame.primitives);
+        sums[2] += static_cast<double>(frame.stateChanges);
+        sums[3] += static_cast<double>(frame.clipPushes);
+        sums[4] += static_cast<double>(frame.pixelsFilled);
+        result.frameTimeMs += frame.frameTimeMs;
+    }
+
+    const double count = static_cast<double>(frames_.size());
+    auto mean = [count](double sum) { return static_cast<uint64_t>(sum / count + 0.5); };
+    result.drawCalls = mean(sums[0]);
+    result.primitives = mean(sums[1]);
+    result.stateChanges = mean(sums[2]);
+    result.clipPushes = mean(sums[3]);
+    result.pixelsFilled = mean(sums[4]);
+    result.frameTimeMs /= count;
+    return result;
+}
+
+void Renderer::beginRenderStats() {
+    renderStats_ = RenderStats();
+    frameStart_ = std::chrono::steady_clock::now();
+}
+
+void Renderer::endRenderStats() {
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - frameStart_;
+    renderStats_.frameTimeMs = elapsed.count();
+    lastRenderStats_ = renderStats_;
+    renderStatsHistory_.push(renderStats_);
+}
+
+Renderer* Renderer::current() {
+    return t_currentRenderer;
+}
+
+Renderer::ScopedBinding::ScopedBinding(Renderer& renderer)
+    : previous_(t_currentRenderer) {
+    t_currentRenderer = &renderer;
+}
+
+Renderer::ScopedBinding::~ScopedBinding() {
+    t_currentRenderer = previous_;
+}
+
+void Renderer::pushTransform(const Affine& matrix) {
+    Transform transform;
+    transform.position = Vector2f(matrix.tx, matrix.ty);
+    const float scaleX = std::sqrt(matrix.a * matrix.a + matrix.b * matrix.b);
+    transform.scale = Vector2f(scaleX, scaleX > 0.0f ? (matrix.a * matrix.d - matrix.b * matrix.c) / scaleX : 0.0f);
+    transform.rotation = std::atan2(matrix.b, matrix.a) * 180.0f / 3.14159265358979323846f;
+    pushTransform(transform);
+}
+
+void Renderer::fillRoundedRect(const Rect& rect, float radius, const Color& color) {
+    if (radius <= 0.0f) {
+        fillRect(rect, color);
+        return;
+    }
+    t_trianglePoints.clear();
+    t_tessellation.appendRoundedRect(t_trianglePoints, rect, radius);
+    fillTriangleList(*this, t_trianglePoints, color);
+}
+
+void Renderer::drawRoundedRect(const Rect& rect, float radius, const Color& color, float thickness) {
+    if (radius <= 0.0f) {
+        drawRect(rect, color, thickness);
+        return;
+    }
+    if (thickness <= 0.0f)
+        return;
+    t_trianglePoints.clear();
+    t_tessellation.appendRoundedRect(t_trianglePoints, rect, radius, thickness);
+    fillTriangleList(*this, t_trianglePoints, color);
+}
+
+void Renderer::drawShape(const Rect& rect, const ShapeStyle& style) {
+    const float radius = *std::max_element(style.radii, style.radii + 4);
+    if (style.shadow.a > 0.0f)
+        fillRoundedRect(Rect(rect.position + style.shadowOffset, rect.size), radius, style.shadow);
+    if (style.fill.a > 0.0f)
+        fillRoundedRect(rect, radius, style.fill);
+    if (style.border.a > 0.0f && style.borderWidth > 0.0f)
+        drawRoundedRect(rect, radius, style.border, style.borderWidth);
+}
+
+void Renderer::fillPath(const Path& path, const Color& color, FillRule rule) {
+    if (color.a <= 0.0f || path.isEmpty())
+        return;
+    fillTriangleList(*this, t_paths.getFill(path, rule, getDeviceScale(), true).triangles, color);
+}
+
+void Renderer::strokePath(const Path& path, const Color& color, const StrokeStyle& stroke) {
+    if (color.a <= 0.0f || stroke.width <= 0.0f || path.isEmpty())
+        return;
+    fillTriangleList(*this, t_paths.getStroke(path, stroke, getDeviceScale(), true).triangles, color);
+}
+
+void Renderer::drawTriangles(const Vertex* vertices, size_t vertexCount, const std::string& texture) {
+    // Текстурирование произвольных треугольников требует поддержки бэкенда
+    if (!texture.empty())
+        return;
+
+    for (size_t i = 0; i + 2 < vertexCount; i += 3) {
+        fillTriangle(vertices[i].position, vertices[i + 1].position, vertices[i + 2].position,
+                     vertices[i].color);
+    }
+}
+
+ImageHandle Renderer::resolveImage(const std::string& imagePath) {
+    auto it = imageIndex_.find(imagePath);
+    if (it != imageIndex_.end())
+        return ImageHandle{it->second};
+
+    // Путь запоминается даже для отсутствующего файла: повторная попытка
+    // загрузки на каждом кадре дороже самой отрисовки
+    ImageHandle handle;
+    if (getImageSize(imagePath).x > 0.0f) {
+        handle.index = static_cast<uint32_t>(images_.size());
+        images_.push_back(ImageEntry{imagePath, Rect(), false});
+    }
+    imageIndex_.emplace(imagePath, handle.index);
+    return handle;
+}
+
+ImageHandle Renderer::resolveImageRegion(ImageHandle image, const Rect& sourceRect) {
+    if (image.index >= images_.size() || sourceRect.isEmpty())
+        return ImageHandle();
+
+    ImageEntry entry = images_[image.index];
+    const Rect offset = entry.hasSource
+        ? Rect(entry.source.position + sourceRect.position, sourceRect.size) : sourceRect;
+    entry.source = offset;
+    entry.hasSource = true;
+    images_.push_back(entry);
+    return ImageHandle{static_cast<uint32_t>(images_.size() - 1)};
+}
+
+ImageHandle Renderer::createImage(const std::string& name, const utils::Image& image) {
+    (void)name;
+    (void)image;
+    return ImageHandle();
+}
+
+ImageHandle Renderer::updateImage(ImageHandle image, const utils::Image& pixels) {
+    (void)image;
+    (void)pixels;
+    return ImageHandle();
+}
+
+void Renderer::releaseImage(ImageHandle image) {
+    (void)image;
+}
+
+void Renderer::drawImage(ImageHandle image, const Rect& destRect, const Color& tint) {
+    if (image.index >= images_.size())
+        return;
+
+    const ImageEntry& entry = images_[image.index];
+    if (!entry.hasSource) {
+        drawImage(entry.path, destRect, tint);
+        return;
+    }
+    drawImageSource(entry.path, entry.source, destRect, tint);
+}
+
+// Изображение растягивается так, чтобы часть source легла в destRect, и обрезается по нему
+void Renderer::drawImageSource(const std::string& path, const Rect& source, const Rect& destRect,
+                               const Color& tint) {
+    const Vector2f full = getImageSize(path);
+    const float scaleX = destRect.size.x / source.size.x;
+    const float scaleY = destRect.size.y / source.size.y;
+    const Rect stretched(Vector2f(destRect.position.x - source.position.x * scaleX,
+                                  destRect.position.y - source.position.y * scaleY),
+                         Vector2f(full.x * scaleX, full.y * scaleY));
+    pushClipRect(destRect);
+    drawImage(path, stretched, tint);
+    popClipRect();
+}
+
+void Renderer::drawNineSlice(ImageHandle image, const Rect& destRect, const NineSlice& slice, const Color& tint) {
+    if (image.index >= images_.size() || destRect.isEmpty())
+        return;
+
+    const ImageEntry& entry = images_[image.index];
+    const Rect source = entry.hasSource ? entry.source : Rect(Vector2f(), getImageSize(entry.path));
+    const NineSliceGrid grid = makeNineSliceGrid(source, destRect, slice);
+    for (int row = 0; row < 3; ++row) {
+        for (int column = 0; column < 3; ++column) {
+            const Rect part(Vector2f(grid.sourceX[column], grid.sourceY[row]),
+                            Vector2f(grid.sourceX[column + 1] - grid.sourceX[column],
+                                     grid.sourceY[row + 1] - grid.sourceY[row]));
+            const Rect target(Vector2f(grid.destX[column], grid.destY[row]),
+                              Vector2f(grid.destX[column + 1] - grid.destX[column],
+                                       grid.destY[row + 1] - grid.destY[row]));
+            if (!part.isEmpty() && !target.isEmpty())
+                drawImageSource(entry.path, part, target, tint);
+        }
+    }
+}
+
+Vector2f Renderer::getImageSize(ImageHandle image) {
+    if (image.index >= images_.size())
+        return Vector2f();
+    const ImageEntry& entry = images_[image.index];
+    return entry.hasSource ? entry.source.size : getImageSize(entry.path);
+}
+
+ImageHandle Renderer::resolveAtlasRegion(ImageHandle atlasImage, const utils::TextureAtlas& atlas,
+                                         utils::TextureAtlas::RegionHandle region) {
+    const utils::TextureAtlas::Region* bounds = atlas.getRegion(region);
+    if (!bounds)
+        return ImageHandle();
+    return resolveImageRegion(atlasImage, bounds->bounds);
+}
+
+NineSliceGrid makeNineSliceGrid(const Rect& source, const Rect& dest, const NineSlice& slice) {
+    NineSliceGrid grid;
+    sliceAxis(source.position.x, source.size.x, dest.position.x, dest.size.x, slice.left, slice.right,
+              grid.sourceX, grid.destX);
+    sliceAxis(source.position.y, source.size.y, dest.position.y, dest.size.y, slice.top, slice.bottom,
+              grid.sourceY, grid.destY);
+    return grid;
+}
+
+ClipStack::ClipStack() {
+    reset();
+}
+
+void ClipStack::reset() {
+    mappings_.assign(1, Affine());
+    clips_.assign(1, Clip());
+}
+
+void ClipStack::reset(const Rect& viewport) {
+    mappings_.assign(1, Affine::translation(viewport.position.x, viewport.position.y));
+    Clip clip;
+    clip.rect = viewport;
+    clip.bounded = true;
+    clips_.assign(1, clip);
+}
+
+void ClipStack::pushTransform(const Affine& matrix) {
+    mappings_.push_back(mappings_.back() * matrix);
+}
+
+void ClipStack::popTransform() {
+    if (mappings_.size() > 1)
+        mappings_.pop_back();
+}
+
+void ClipStack::pushClip(const Rect& rect) {
+    const Affine& mapping = mappings_.back();
+    Clip clip = clips_.back();
+    const Rect device = mapping.mapRect(rect);
+    clip.rect = clip.bounded ? clip.rect.intersected(device) : device;
+    clip.bounded = true;
+    clip.exact = clip.exact && mapping.isAxisAligned();
+    clips_.push_back(clip);
+}
+
+void ClipStack::popClip() {
+    if (clips_.size() > 1)
+        clips_.pop_back();
+}
+
+// Описанный прямоугольник шире образа bounds, поэтому и Outside, и Inside
+// по нему остаются верными при любом преобразовании
+ClipTest ClipStack::test(const Rect& bounds) const {
+    const Clip& clip = clips_.back();
+    if (!clip.bounded)
+        return ClipTest::Partial;
+
+    const Rect device = mappings_.back().mapRect(bounds);
+    if (clip.rect.isEmpty() || !device.intersects(clip.rect))
+        return ClipTest::Outside;
+    if (clip.exact && clip.rect.contains(device))
+        return ClipTest::Inside;
+    return ClipTest::Partial;
+}
+
+bool ClipStack::getDeviceClip(Rect& clip) const {
+    if (!clips_.back().bounded)
+        return false;
+    clip = clips_.back().rect;
+    return true;
+}
+
+std::unique_ptr<Renderer> RendererFactory::createRenderer(RendererType type) {
+    switch (type) {
+        case RendererType::Software:
+            return std::make_unique<SoftwareRenderer>();
+        case RendererType::OpenGL:
+        case RendererType::DirectX:
+        case RendererType::Vulkan:
+        default:
+            return nullptr;
+    }
+}
+
+} // namespace gui
\ No newline at end of file
@@ -1,15 +1,167 @@
 #pragma once
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include "../core/math_types.hpp"
+#include "../core/path.hpp"
+#include "../utils/image.hpp"
 
 namespace gui {
 
 class RenderTarget;
 class RenderStates;
+class Texture;
+class Shader;
+
+// Режимы наложения
+enum class BlendMode {
+    None,
+    Alpha,
+    Additive,
+    Multiply,
+    Screen
+};
+
+// Положение прямоугольника относительно текущей области отсечения
+enum class ClipTest {
+    Outside,    // целиком невидим, рисование можно пропустить
+    Partial,    // пересекает границу или бэкенд не может ответить точно
+    Inside      // целиком видим, отсечение не требуется
+};
+
+// Дескриптор изображения в таблице рендерера. Разрешается один раз через
+// Renderer::resolveImage(), после чего отрисовка по нему — обращение по индексу
+// без поиска строки и загрузки файла. Действителен только для рендерера,
+// который его выдал, и для обёрток, передающих вызовы этому рендереру.
+struct ImageHandle {
+    uint32_t index = InvalidIndex;
+
+    static constexpr uint32_t InvalidIndex = 0xFFFFFFFFu;
+
+    bool isValid() const { return index != InvalidIndex; }
+    explicit operator bool() const { return isValid(); }
+
+    bool operator==(const ImageHandle& other) const { return index == other.index; }
+    bool operator!=(const ImageHandle& other) const { return !(*this == other); }
+};
+
+// Вершина пакета треугольников
+struct Vertex {
+    Vector2f position;
+    Vector2f texCoord;
+    Color color;
+};
+
+// Оформление фигуры, которое бэкенд может нарисовать одним примитивом:
+// скруглённый прямоугольник с радиусом каждого угла, заливкой, рамкой внутри
+// контура и размытой тенью под ним. Круг — квадрат с радиусами в половину стороны.
+struct ShapeStyle {
+    Color fill = Color::transparent();
+    Color border = Color::transparent();
+    float borderWidth = 0.0f;
+    // Левый верхний, правый верхний, правый нижний, левый нижний;
+    // ограничиваются половиной меньшей стороны
+    float radii[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    Color shadow = Color::transparent();
+    Vector2f shadowOffset;
+    float shadowBlur = 0.0f;    // радиус размытия, как в CSS: сигма гауссиана равна половине
+
+    void setRadius(float radius) {
+        for (float& corner : radii) {
+            corner = radius;
+        }
+    }
+};
+
+// Область, которую фигура закрашивает вместе с тенью; гауссиан обрезается на трёх сигмах
+inline Rect shapeBounds(const Rect& rect, const ShapeStyle& style) {
+    if (style.shadow.a <= 0.0f)
+        return rect;
+    const float spread = style.shadowBlur * 1.5f;
+    const Rect shadow(rect.position + style.shadowOffset - Vector2f(spread, spread),
+                      rect.size + Vector2f(spread * 2.0f, spread * 2.0f));
+    return rect.united(shadow);
+}
+
+// Отступы девятисрезового изображения в пикселях источника. Углы выводятся
+// в исходном размере, края растягиваются вдоль своей стороны, середина — по обеим.
+struct NineSlice {
+    float left = 0.0f;
+    float top = 0.0f;
+    float right = 0.0f;
+    float bottom = 0.0f;
+};
+
+// Границы столбцов и строк сетки 3x3: в области источника и в прямоугольнике
+// назначения. Отступы ограничиваются источником; если углы не помещаются
+// в назначение, они уменьшаются пропорционально.
+struct NineSliceGrid {
+    float sourceX[4];
+    float sourceY[4];
+    float destX[4];
+    float destY[4];
+};
+
+NineSliceGrid makeNineSliceGrid(const Rect& source, const Rect& dest, const NineSlice& slice);
+
+// Преобразует позиции потока вершин на месте, не трогая остальные поля
+inline void transformVertices(const Affine& matrix, Vertex* vertices, size_t count) {
+    if (count > 0)
+        matrix.transformPoints(&vertices->position, &vertices->position, count, sizeof(Vertex));
+}
+
+// Счётчики одного кадра. Каждый бэкенд считает вызовы, пришедшие к нему самому:
+// у слоя пакетирования это вызовы до слияния, у его цели — после
+struct RenderStats {
+    uint64_t drawCalls = 0;     // вызовы рисования, включая clear()
+    uint64_t primitives = 0;    // примитивы бэкенда: команды растеризатора, треугольники пакета
+    uint64_t stateChanges = 0;  // смены наложения, сглаживания, вьюпорта и преобразования
+    uint64_t clipPushes = 0;
+    uint64_t pixelsFilled = 0;  // пиксели, пройденные растеризатором; 0 у бэкендов без растеризации
+    double frameTimeMs = 0.0;   // от beginFrame() до возврата из endFrame()
+};
+
+// Кольцевое окно статистики последних кадров
+class RenderStatsHistory {
+public:
+    explicit RenderStatsHistory(size_t capacity = 120);
+
+    void push(const RenderStats& stats);
+    void clear();
+    void setCapacity(size_t capacity);
+    size_t getCapacity() const { return capacity_; }
+
+    size_t size() const { return frames_.size(); }
+    bool empty() const { return frames_.empty(); }
+    // 0 — самый старый кадр окна, size() - 1 — последний
+    const RenderStats& at(size_t index) const;
+    // Среднее по окну; целые счётчики округляются к ближайшему
+    RenderStats average() const;
+    // Кадров завершено за всё время, а не только в окне
+    uint64_t getFrameCount() const { return frameCount_; }
+
+private:
+    std::vector<RenderStats> frames_;
+    size_t capacity_;
+    size_t head_ = 0;       // индекс самого старого кадра, когда окно заполнено
+    uint64_t frameCount_ = 0;
+};
 
 // Абстрактный класс для рендеринга
 class Renderer {
 public:
+    // Счётчики отбраковки по отсечению; сбрасываются в beginFrame() бэкенда
+    struct CullStats {
+        size_t culledDraws = 0;     // примитивы, отброшенные целиком
+        size_t clippedDraws = 0;    // примитивы, обрезанные по границе
+        size_t acceptedDraws = 0;   // примитивы, целиком попавшие в область
+        size_t culledWidgets = 0;   // виджеты, пропущенные вместе с поддеревом
+        size_t occludedWidgets = 0; // виджеты под непрозрачными соседями, пропущенные целиком
+    };
+
     virtual ~Renderer() = default;
 
     // Инициализация и очистка
@@ -31,16 +183,67 @@ public:
                             const Color& color, float thickness = 1.0f) = 0;
     virtual void fillTriangle(const Vector2f& p1, const Vector2f& p2, const Vector2f& p3, const Color& color) = 0;
 
+    // Скруглённые прямоугольники; радиус ограничивается половиной меньшей стороны,
+    // обводка лежит внутри прямоугольника, как у drawRect. Реализация по умолчанию
+    // берёт тесселяцию из кэша и рисует треугольники.
+    virtual void fillRoundedRect(const Rect& rect, float radius, const Color& color);
+    virtual void drawRoundedRect(const Rect& rect, float radius, const Color& color, float thickness = 1.0f);
+
+    // Фигура с тенью, заливкой и рамкой, в этом порядке. Реализация по умолчанию
+    // рисует их отдельными примитивами с наибольшим из радиусов и тенью без размытия;
+    // программный бэкенд вычисляет всё одним проходом по пикселям.
+    virtual void drawShape(const Rect& rect, const ShapeStyle& style);
+    // Векторные пути. Реализация по умолчанию тесселирует путь через кэш
+    // геометрии потока и рисует треугольники пакетом или через fillTriangle
+    virtual void fillPath(const Path& path, const Color& color, FillRule rule = FillRule::NonZero);
+    virtual void strokePath(const Path& path, const Color& color, const StrokeStyle& stroke = StrokeStyle());
+
+    // Пакет треугольников одним вызовом: по три вершины на треугольник,
+    // texture — путь изображения или пустая строка. Реализация по умолчанию
+    // рисует нетекстурированные треугольники через fillTriangle.
+    virtual bool supportsTriangleBatches() const { return false; }
+    virtual void drawTriangles(const Vertex* vertices, size_t vertexCount, const std::string& texture);
+
     // Текст и изображения
     virtual void drawText(const std::string& text, const Vector2f& position, 
                          const std::string& font, float size, const Color& color) = 0;
     virtual void drawImage(const std::string& imagePath, const Rect& destRect, 
                          const Color& tint = Color::white()) = 0;
 
+    // Изображения по дескрипторам. Неудачное разрешение возвращает невалидный
+    // дескриптор, отрисовка по нему ничего не делает. Регион задаёт часть уже
+    // разрешённого изображения в его пикселях. Реализация по умолчанию хранит
+    // таблицу путей и рисует через строковый drawImage, регион — под отсечением.
+    virtual ImageHandle resolveImage(const std::string& imagePath);
+    virtual ImageHandle resolveImageRegion(ImageHandle image, const Rect& sourceRect);
+    // Изображение из памяти под именем name; по умолчанию не поддерживается
+    virtual ImageHandle createImage(const std::string& name, const utils::Image& image);
+    // Заменяет пиксели изображения, созданного createImage(); дескриптор сохраняется,
+    // размер может измениться. Невалидный дескриптор — создаётся безымянное изображение.
+    // Кадр, уже разрешивший дескриптор, дорисовывается прежними пикселями.
+    virtual ImageHandle updateImage(ImageHandle image, const utils::Image& pixels);
+    // Освобождает пиксели; дальнейшая отрисовка по дескриптору ничего не делает
+    virtual void releaseImage(ImageHandle image);
+    // Рендерер, выдающий дескрипторы; обёртки возвращают тот, которому передают вызовы
+    virtual Renderer& getImageOwner() { return *this; }
+    virtual void drawImage(ImageHandle image, const Rect& destRect, const Color& tint = Color::white());
+    virtual Vector2f getImageSize(ImageHandle image);
+    // Девятисрезовое изображение по destRect. Реализация по умолчанию рисует
+    // девять частей изображения под отсечением, как регионы
+    virtual void drawNineSlice(ImageHandle image, const Rect& destRect, const NineSlice& slice,
+                               const Color& tint = Color::white());
+
+    // Регион атласа, изображение которого уже разрешено как atlasImage
+    ImageHandle resolveAtlasRegion(ImageHandle atlasImage, const utils::TextureAtlas& atlas,
+                                   utils::TextureAtlas::RegionHandle region);
+
     // Продвинутые функции рендеринга
     virtual void pushClipRect(const Rect& rect) = 0;
     virtual void popClipRect() = 0;
     virtual void pushTransform(const Transform& transform) = 0;
+    // Произвольная матрица, в том числе со сдвигом. Реализация по умолчанию
+    // раскладывает её в Transform, и сдвиг теряется.
+    virtual void pushTransform(const Affine& matrix);
     virtual void popTransform() = 0;
 
     // Управление состоянием
@@ -51,15 +254,120 @@ public:
     // Вспомогательные функции
     virtual Vector2f getTextSize(const std::string& text, const std::string& font, float size) = 0;
     virtual Vector2f getImageSize(const std::string& imagePath) = 0;
+
+    // true, если getTextSize, getImageSize и resolveImage можно вызывать
+    // одновременно из нескольких потоков (параллельная запись поддеревьев)
+    virtual bool isMeasureThreadSafe() const { return false; }
+
+    // Проверка прямоугольника в текущих локальных координатах против пересечения
+    // стека отсечения. Бэкенд без сведений об отсечении отвечает Partial.
+    virtual ClipTest testClip(const Rect& bounds) const { (void)bounds; return ClipTest::Partial; }
+    // Пикселей устройства на единицу текущих локальных координат: по нему
+    // выбирается подробность ломаных путей. Бэкенд без сведений о
+    // преобразовании отвечает 1.
+    virtual float getDeviceScale() const { return 1.0f; }
+
+    const CullStats& getCullStats() const { return cullStats_; }
+    void resetCullStats() { cullStats_ = CullStats(); }
+    void recordCulledWidget() { ++cullStats_.culledWidgets; }
+    void recordOccludedWidget() { ++cullStats_.occludedWidgets; }
+    // Учитывает отбраковку, выполненную при записи вложенного списка команд
+    void addCullStats(const CullStats& other) {
+        cullStats_.culledDraws += other.culledDraws;
+        cullStats_.clippedDraws += other.clippedDraws;
+        cullStats_.acceptedDraws += other.acceptedDraws;
+        cullStats_.culledWidgets += other.culledWidgets;
+        cullStats_.occludedWidgets += other.occludedWidgets;
+    }
+
+    // Статистика последнего завершённого кадра и скользящие средние. Кадр
+    // фиксируется в endFrame(); рендерер, занятый другим потоком, читать нельзя.
+    const RenderStats& getRenderStats() const { return lastRenderStats_; }
+    RenderStats getAverageRenderStats() const { return renderStatsHistory_.average(); }
+    const RenderStatsHistory& getRenderStatsHistory() const { return renderStatsHistory_; }
+    void setRenderStatsWindow(size_t frames) { renderStatsHistory_.setCapacity(frames); }
+
+    // Рендерер, в который рисуют виджеты текущего потока: Widget::render() не получает
+    // его аргументом. Каждый поток привязывает свой рендерер через ScopedBinding.
+    static Renderer* current();
+
+    class ScopedBinding {
+    public:
+        explicit ScopedBinding(Renderer& renderer);
+        ~ScopedBinding();
+
+        ScopedBinding(const ScopedBinding&) = delete;
+        ScopedBinding& operator=(const ScopedBinding&) = delete;
+
+    private:
+        Renderer* previous_;
+    };
+
+protected:
+    CullStats cullStats_;
+    RenderStats renderStats_;   // текущий, ещё не завершённый кадр
+
+    // Бэкенд вызывает их в начале beginFrame() и в конце endFrame()
+    void beginRenderStats();
+    void endRenderStats();
+
+    void recordDrawCall() { ++renderStats_.drawCalls; }
+    void recordPrimitives(uint64_t count) { renderStats_.primitives += count; }
+    void recordStateChange() { ++renderStats_.stateChanges; }
+    void recordClipPush() { ++renderStats_.clipPushes; }
+
+private:
+    struct ImageEntry {
+        std::string path;
+        Rect source;
+        bool hasSource = false;
+    };
+
+    // Часть source изображения path, растянутая на destRect
+    void drawImageSource(const std::string& path, const Rect& source, const Rect& destRect, const Color& tint);
+
+    std::vector<ImageEntry> images_;
+    std::unordered_map<std::string, uint32_t> imageIndex_;
+
+    RenderStats lastRenderStats_;
+    RenderStatsHistory renderStatsHistory_;
+    std::chrono::steady_clock::time_point frameStart_;
 };
 
-// Режимы наложения
-enum class BlendMode {
-    None,
-    Alpha,
-    Additive,
-    Multiply,
-    Screen
+// Стек отсечения в координатах устройства для бэкендов, которые сами не
+// растеризуют: записи команд и промежуточных слоёв. Под поворотом область
+// отсечения заменяется описанным прямоугольником, и проверки против неё
+// не дают ответа Inside.
+class ClipStack {
+public:
+    ClipStack();
+
+    // Без аргумента отсечение не ограничено
+    void reset();
+    void reset(const Rect& viewport);
+
+    void pushTransform(const Transform& transform) { pushTransform(transform.toMatrix()); }
+    void pushTransform(const Affine& matrix);
+    void popTransform();
+    void pushClip(const Rect& rect);
+    void popClip();
+
+    ClipTest test(const Rect& bounds) const;
+
+    // Текущая область в координатах устройства; false, если она не ограничена
+    bool getDeviceClip(Rect& clip) const;
+    // Из текущих локальных координат в координаты устройства
+    const Affine& getMatrix() const { return mappings_.back(); }
+
+private:
+    struct Clip {
+        Rect rect;
+        bool bounded = false;
+        bool exact = true;  // false — область шире настоящей
+    };
+
+    std::vector<Affine> mappings_;
+    std::vector<Clip> clips_;
 };
 
 // Состояния рендеринга
@@ -97,14 +405,15 @@ public:
 // Фабрика для создания рендереров
 class RendererFactory {
 public:
-    static std::unique_ptr<Renderer> createRenderer(RendererType type);
-    
     enum class RendererType {
         OpenGL,
         DirectX,
         Vulkan,
         Software
     };
+
+    // Возвращает nullptr, если бэкенд не собран в данной конфигурации
+    static std::unique_ptr<Renderer> createRenderer(RendererType type);
 };
 
 } // namespace gui
\ No newline at end of file
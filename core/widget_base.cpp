@@ -0,0 +1,586 @@
+#include "widget_base.hpp"
+#include "renderer.hpp"
+#include "../render/command_buffer.hpp"
+#include "../render/damage_tracker.hpp"
+#include "../render/layer_cache.hpp"
+#include <bitset>
+#include <cstdio>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_set>
+
+namespace gui {
+
+namespace {
+
+static_assert(static_cast<unsigned int>(Event::Type::Custom) < 16, "тип события не помещается в handlerMask_");
+
+size_t countHandlers(uint16_t mask) {
+    return std::bitset<16>(mask).count();
+}
+
+// Обработчик может назначить другой обработчик своему же виджету. Пока идёт
+// рассылка, старый массив слотов не освобождается, а копируется
+thread_local int t_dispatchDepth = 0;
+thread_local std::vector<std::unique_ptr<EventCallback[]>> t_retiredHandlers;
+
+DirtyTrace* g_dirtyTrace = nullptr;
+
+struct DispatchScope {
+    DispatchScope() { ++t_dispatchDepth; }
+    ~DispatchScope() {
+        if (--t_dispatchDepth == 0)
+            t_retiredHandlers.clear();
+    }
+};
+
+// Имена свойств стиля повторяются у тысяч виджетов и хранятся один раз;
+// строки не удаляются, поэтому указатель на строку служит ключом. Новые
+// имена появляются редко, поэтому поиск идёт под разделяемой блокировкой
+struct StyleNames {
+    std::shared_mutex mutex;
+    std::unordered_set<std::string> names;
+};
+
+StyleNames& styleNames() {
+    static StyleNames instance;
+    return instance;
+}
+
+// Не добавляет имя: свойство, которого нет в пуле, не задано ни у одного виджета
+const std::string* findStyleName(const std::string& name) {
+    StyleNames& pool = styleNames();
+    std::shared_lock<std::shared_mutex> lock(pool.mutex);
+    auto it = pool.names.find(name);
+    return it != pool.names.end() ? &*it : nullptr;
+}
+
+} // namespace
+
+void DirtyTrace::add(const Widget* widget, uint8_t flags, DirtyCause cause) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.push_back(Entry{widget, flags, cause});
+}
+
+std::vector<DirtyTrace::Entry> DirtyTrace::getEntries() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_;
+}
+
+size_t DirtyTrace::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+void DirtyTrace::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+}
+
+std::string DirtyTrace::format() const {
+    static const char* const kFlagNames[] = {"layout", "paint", "transform", "style"};
+    std::string text;
+    for (const Entry& entry : getEntries()) {
+        char address[32];
+        std::snprintf(address, sizeof(address), "%p ", static_cast<const void*>(entry.widget));
+        text += address;
+        std::string flags;
+        for (unsigned int bit = 0; bit < 4; ++bit) {
+            if (!(entry.flags & (1u << bit)))
+                continue;
+            if (!flags.empty())
+                flags += '|';
+            flags += kFlagNames[bit];
+        }
+        text += flags.empty() ? "-" : flags;
+        text += " <- ";
+        text += causeName(entry.cause);
+        text += '\n';
+    }
+    return text;
+}
+
+const char* DirtyTrace::causeName(DirtyCause cause) {
+    switch (cause) {
+        case DirtyCause::None:       return "none";
+        case DirtyCause::Created:    return "created";
+        case DirtyCause::Explicit:   return "explicit";
+        case DirtyCause::Position:   return "position";
+        case DirtyCause::Size:       return "size";
+        case DirtyCause::Rotation:   return "rotation";
+        case DirtyCause::Scale:      return "scale";
+        case DirtyCause::Visibility: return "visibility";
+        case DirtyCause::State:      return "state";
+        case DirtyCause::Style:      return "style";
+        case DirtyCause::Theme:      return "theme";
+        case DirtyCause::Reparent:   return "reparent";
+        case DirtyCause::Children:   return "children";
+        case DirtyCause::Ancestor:   return "ancestor";
+        case DirtyCause::Descendant: return "descendant";
+    }
+    return "";
+}
+
+Widget::Widget()
+    : position_()
+    , size_()
+    , rotation_(0.0f)
+    , scale_(1.0f, 1.0f)
+    , visible_(true)
+    , enabled_(true)
+    , focused_(false)
+    , hovered_(false) {}
+
+Widget::~Widget() {
+    if (layerOwner_)
+        layerOwner_->remove(*this);
+    if (store_)
+        store_->detach(storeHandle_);
+}
+
+void Widget::update(float deltaTime) {
+    (void)deltaTime;
+}
+
+void Widget::render() const {}
+
+void Widget::handleEvent(const Event& event) {
+    const Event::Type type = event.getType();
+    if (type == Event::Type::MouseEnter || type == Event::Type::MouseLeave) {
+        const bool hovered = type == Event::Type::MouseEnter;
+        if (hovered_ != hovered) {
+            hovered_ = hovered;
+            syncStoreFlags();
+            updateState();
+            markDirty(PaintDirty, DirtyCause::State);
+        }
+    }
+
+    if (const EventCallback* handler = findEventHandler(type)) {
+        DispatchScope scope;
+        (*handler)(event);
+    }
+}
+
+const EventCallback* Widget::findEventHandler(Event::Type type) const {
+    const uint16_t bit = static_cast<uint16_t>(1u << static_cast<unsigned int>(type));
+    if (!(handlerMask_ & bit))
+        return nullptr;
+    return &handlers_[countHandlers(handlerMask_ & (bit - 1))];
+}
+
+// Массив слотов перестраивается только при назначении или снятии типа
+void Widget::setEventHandler(Event::Type type, EventCallback callback) {
+    const uint16_t bit = static_cast<uint16_t>(1u << static_cast<unsigned int>(type));
+    const bool dispatching = t_dispatchDepth > 0;
+    if ((handlerMask_ & bit) && callback && !dispatching) {
+        handlers_[countHandlers(handlerMask_ & (bit - 1))] = std::move(callback);
+        return;
+    }
+    if (!(handlerMask_ & bit) && !callback)
+        return;
+
+    const uint16_t mask = callback ? (handlerMask_ | bit) : (handlerMask_ & ~bit);
+    const size_t count = countHandlers(mask);
+    std::unique_ptr<EventCallback[]> handlers = count ? std::make_unique<EventCallback[]>(count) : nullptr;
+    size_t from = 0;
+    size_t to = 0;
+    for (uint16_t current = 1; current != 0 && current <= (handlerMask_ | bit); current <<= 1) {
+        const bool had = handlerMask_ & current;
+        if (current == bit) {
+            if (callback)
+                handlers[to++] = std::move(callback);
+        } else if (had) {
+            if (dispatching)
+                handlers[to] = handlers_[from];
+            else
+                handlers[to] = std::move(handlers_[from]);
+            ++to;
+        }
+        if (had)
+            ++from;
+    }
+
+    if (dispatching && handlers_)
+        t_retiredHandlers.push_back(std::move(handlers_));
+    handlers_ = std::move(handlers);
+    handlerMask_ = mask;
+}
+
+void Widget::paint() const {
+    Renderer* target = Renderer::current();
+    if (!target || !visible_)
+        return;
+
+    // Поддерево целиком за пределами отсечения не записывается и не воспроизводится
+    const Rect bounds = getPaintBounds();
+    if (!bounds.isEmpty() && target->testClip(bounds) == ClipTest::Outside) {
+        target->recordCulledWidget();
+        return;
+    }
+
+    if (!paintValid_ || !displayList_) {
+        recordDisplayList(*target);
+        target->addCullStats(displayList_->getCullStats());
+    }
+
+    if (layerMode_ != LayerMode::Never) {
+        LayerCache* layers = findLayerCache();
+        if (layers && layers->paint(*this, *target, bounds))
+            return;
+    }
+    displayList_->replay(*target);
+}
+
+LayerCache* Widget::findLayerCache() const {
+    for (const Widget* widget = this; widget; widget = widget->parent_) {
+        if (widget->layerCache_)
+            return widget->layerCache_;
+    }
+    return nullptr;
+}
+
+// Запись зависит только от поддерева и рендерера измерения, поэтому
+// независимые поддеревья можно записывать на разных потоках
+void Widget::recordDisplayList(Renderer& measure) const {
+    if (g_dirtyTrace)
+        g_dirtyTrace->add(this, PaintDirty, paintCause_);
+    if (!displayList_)
+        displayList_ = std::make_unique<CommandBuffer>();
+    displayList_->reset();
+    displayList_->setMeasureRenderer(&measure);
+    ++recordGeneration_;
+    {
+        Renderer::ScopedBinding binding(*displayList_);
+        const Affine& local = getLocalTransform();
+        const bool transformed = !local.isIdentity();
+        if (transformed)
+            displayList_->pushTransform(local);
+        render();
+        if (transformed)
+            displayList_->popTransform();
+    }
+    paintValid_ = true;
+}
+
+void Widget::invalidatePaint() {
+    invalidatePaint(getLocalPaintBounds());
+}
+
+// Повреждённая область переводится в координаты корня по пути вверх
+void Widget::invalidatePaint(const Rect& area) {
+    Rect damaged = area;
+    Widget* root = this;
+    for (;;) {
+        if (root->paintValid_)
+            root->paintCause_ = root == this ? DirtyCause::Explicit : DirtyCause::Descendant;
+        root->paintValid_ = false;
+        root->paintBoundsValid_ = false;
+        const Affine& local = root->getLocalTransform();
+        if (!local.isIdentity())
+            damaged = local.mapRect(damaged);
+        if (!root->parent_)
+            break;
+        root = root->parent_;
+    }
+
+    if (root->damageTracker_)
+        root->damageTracker_->add(damaged);
+}
+
+// Геометрия и позиционирование
+const Rect& Widget::getLocalPaintBounds() const {
+    if (!paintBoundsValid_) {
+        paintBounds_ = computePaintBounds();
+        paintBoundsValid_ = true;
+    }
+    return paintBounds_;
+}
+
+Rect Widget::getPaintBounds() const {
+    const Affine& local = getLocalTransform();
+    return local.isIdentity() ? getLocalPaintBounds() : local.mapRect(getLocalPaintBounds());
+}
+
+// Описанный прямоугольник повёрнутой области шире её самой, поэтому
+// повёрнутый виджет не считается закрывающим
+Rect Widget::getOpaqueBounds() const {
+    if (!visible_)
+        return Rect();
+    const Rect opaque = computeOpaqueBounds();
+    if (opaque.isEmpty())
+        return opaque;
+    const Affine& local = getLocalTransform();
+    if (local.isIdentity())
+        return opaque;
+    return local.isAxisAligned() ? local.mapRect(opaque) : Rect();
+}
+
+const Affine& Widget::getLocalTransform() const {
+    if (!transformValid_) {
+        if (rotation_ == 0.0f && scale_.x == 1.0f && scale_.y == 1.0f) {
+            localTransform_ = Affine();
+        } else {
+            localTransform_ = Affine::translation(position_.x, position_.y) *
+                              Transform(Vector2f(), scale_, rotation_).toMatrix() *
+                              Affine::translation(-position_.x, -position_.y);
+        }
+        transformValid_ = true;
+    }
+    return localTransform_;
+}
+
+// Кэш действителен, пока ни виджет, ни его предки не отмечены TransformDirty:
+// отметка сбрасывает кэш всего поддерева сразу, а заполняет его только проход
+Affine Widget::getWorldTransform() const {
+    if (worldValid_)
+        return worldTransform_;
+    Affine world = getLocalTransform();
+    for (const Widget* widget = parent_; widget; widget = widget->parent_) {
+        world = widget->getLocalTransform() * world;
+    }
+    return world;
+}
+
+// Перемещение повреждает и старое, и новое место
+void Widget::setPosition(const Vector2f& pos) {
+    invalidatePaint();
+    position_ = pos;
+    transformValid_ = false;
+    syncStoreGeometry();
+    markDirty(TransformDirty | PaintDirty, DirtyCause::Position);
+}
+
+void Widget::setSize(const Vector2f& size) {
+    invalidatePaint();
+    size_ = size;
+    syncStoreGeometry();
+    markDirty(LayoutDirty | PaintDirty, DirtyCause::Size);
+}
+
+void Widget::setRotation(float rotation) {
+    invalidatePaint();
+    rotation_ = rotation;
+    transformValid_ = false;
+    syncStoreGeometry();
+    markDirty(TransformDirty | PaintDirty, DirtyCause::Rotation);
+}
+
+void Widget::setScale(const Vector2f& scale) {
+    invalidatePaint();
+    scale_ = scale;
+    transformValid_ = false;
+    syncStoreGeometry();
+    markDirty(TransformDirty | PaintDirty, DirtyCause::Scale);
+}
+
+Vector2f Widget::getPosition() const { return position_; }
+Vector2f Widget::getSize() const { return size_; }
+float Widget::getRotation() const { return rotation_; }
+Vector2f Widget::getScale() const { return scale_; }
+
+// Состояние и видимость
+void Widget::setVisible(bool visible) {
+    if (visible_ == visible)
+        return;
+    visible_ = visible;
+    syncStoreFlags();
+    markDirty(PaintDirty, DirtyCause::Visibility);
+}
+
+void Widget::setEnabled(bool enabled) {
+    if (enabled_ == enabled)
+        return;
+    enabled_ = enabled;
+    syncStoreFlags();
+    updateState();
+    markDirty(PaintDirty, DirtyCause::State);
+}
+
+void Widget::setFocused(bool focused) {
+    if (focused_ == focused)
+        return;
+    focused_ = focused;
+    syncStoreFlags();
+    updateState();
+    markDirty(PaintDirty, DirtyCause::State);
+}
+
+// Список родителя содержит либо слой, либо команды виджета, поэтому перезаписывается
+void Widget::setLayerMode(LayerMode mode) {
+    if (layerMode_ == mode)
+        return;
+    layerMode_ = mode;
+    if (mode == LayerMode::Never && layerOwner_)
+        layerOwner_->remove(*this);
+    invalidatePaint();
+}
+
+void Widget::setWidgetStore(WidgetStore* store) {
+    bindStore(store);
+}
+
+// Слот в хранилище родителя становится последним ребёнком его слота,
+// поэтому порядок детей в хранилище совпадает с порядком отрисовки
+void Widget::bindStore(WidgetStore* store) {
+    if (store_)
+        store_->detach(storeHandle_);
+    store_ = store;
+    storeHandle_ = WidgetStore::Handle();
+    if (!store_)
+        return;
+    const bool parentBound = parent_ && parent_->store_ == store_;
+    storeHandle_ = store_->attach(*this, parentBound ? parent_->storeHandle_ : WidgetStore::Handle());
+    syncStoreGeometry();
+    syncStoreFlags();
+}
+
+void Widget::syncStoreGeometry() {
+    if (store_)
+        store_->setGeometry(storeHandle_, position_, size_, rotation_, scale_);
+}
+
+void Widget::syncStoreFlags() {
+    if (!store_)
+        return;
+    uint8_t flags = 0;
+    if (visible_)
+        flags |= WidgetStore::Visible;
+    if (enabled_)
+        flags |= WidgetStore::Enabled;
+    if (focused_)
+        flags |= WidgetStore::Focused;
+    if (hovered_)
+        flags |= WidgetStore::Hovered;
+    store_->setFlags(storeHandle_, flags);
+}
+
+bool Widget::isVisible() const { return visible_; }
+bool Widget::isEnabled() const { return enabled_; }
+bool Widget::isFocused() const { return focused_; }
+
+// Обработчики событий
+void Widget::setOnMouseEnter(EventCallback callback) { setEventHandler(Event::Type::MouseEnter, std::move(callback)); }
+void Widget::setOnMouseLeave(EventCallback callback) { setEventHandler(Event::Type::MouseLeave, std::move(callback)); }
+void Widget::setOnMousePress(EventCallback callback) { setEventHandler(Event::Type::MousePress, std::move(callback)); }
+void Widget::setOnMouseRelease(EventCallback callback) { setEventHandler(Event::Type::MouseRelease, std::move(callback)); }
+void Widget::setOnKeyPress(EventCallback callback) { setEventHandler(Event::Type::KeyPress, std::move(callback)); }
+void Widget::setOnKeyRelease(EventCallback callback) { setEventHandler(Event::Type::KeyRelease, std::move(callback)); }
+
+// Стили и темы
+void Widget::setTheme(std::shared_ptr<Theme> theme) {
+    theme_ = std::move(theme);
+    markDirty(StyleDirty | PaintDirty, DirtyCause::Theme);
+}
+
+// Свойств у виджета единицы, поэтому линейный поиск по указателю быстрее дерева
+void Widget::setCustomStyle(const std::string& property, const std::string& value) {
+    const std::string* name = internStyleName(property);
+    for (StyleProperty& entry : customStyles_) {
+        if (entry.name != name)
+            continue;
+        if (entry.value == value)
+            return;
+        entry.value = value;
+        markDirty(StyleDirty | PaintDirty, DirtyCause::Style);
+        return;
+    }
+    customStyles_.push_back(StyleProperty{name, value});
+    markDirty(StyleDirty | PaintDirty, DirtyCause::Style);
+}
+
+const std::string& Widget::getCustomStyle(const std::string& property) const {
+    static const std::string empty;
+    if (customStyles_.empty())
+        return empty;
+    return getCustomStyle(findStyleName(property));
+}
+
+const std::string& Widget::getCustomStyle(const std::string* property) const {
+    static const std::string empty;
+    for (const StyleProperty& entry : customStyles_) {
+        if (entry.name == property)
+            return entry.value;
+    }
+    return empty;
+}
+
+const std::string* Widget::internStyleName(const std::string& property) {
+    if (const std::string* name = findStyleName(property))
+        return name;
+    StyleNames& pool = styleNames();
+    std::unique_lock<std::shared_mutex> lock(pool.mutex);
+    return &*pool.names.insert(property).first;
+}
+
+// Предки получают только отметку «есть устаревший потомок»: подъём
+// останавливается на первом уже отмеченном
+void Widget::markDirty(uint8_t flags, DirtyCause cause) {
+    if (flags & PaintDirty) {
+        invalidatePaint();
+        paintCause_ = cause;
+    }
+    flags &= static_cast<uint8_t>(~PaintDirty);
+    if (!flags)
+        return;
+    if (flags & TransformDirty)
+        invalidateWorldTransform();
+    dirty_ |= flags;
+    dirtyCause_ = cause;
+    for (Widget* ancestor = parent_; ancestor && !ancestor->descendantsDirty_; ancestor = ancestor->parent_) {
+        ancestor->descendantsDirty_ = true;
+    }
+}
+
+void Widget::updateDirty() {
+    processDirty(0);
+}
+
+// Отметки снимаются до вызова хуков: отметки, поставленные хуками,
+// обрабатываются в этом же проходе, если лежат ниже, иначе в следующем кадре.
+// Порядок: стиль может изменить размеры, раскладка — позиции
+void Widget::processDirty(uint8_t inherited) {
+    const uint8_t flags = dirty_ | inherited;
+    if (!flags && !descendantsDirty_)
+        return;
+
+    if (g_dirtyTrace) {
+        const DirtyCause cause = dirty_ ? dirtyCause_ : (inherited ? DirtyCause::Ancestor : DirtyCause::Descendant);
+        g_dirtyTrace->add(this, flags, cause);
+    }
+    dirty_ = 0;
+    descendantsDirty_ = false;
+    dirtyCause_ = DirtyCause::None;
+
+    if (flags & StyleDirty)
+        onThemeChanged();
+    if (flags & LayoutDirty)
+        updateLayout();
+    if (flags & TransformDirty) {
+        worldTransform_ = parent_ ? parent_->getWorldTransform() * getLocalTransform() : getLocalTransform();
+        worldValid_ = true;
+    }
+    updateDirtyChildren(flags & (StyleDirty | TransformDirty));
+}
+
+void Widget::updateDirtyChildren(uint8_t inherited) {
+    (void)inherited;
+}
+
+void Widget::invalidateWorldTransform() {
+    worldValid_ = false;
+}
+
+void Widget::setDirtyTrace(DirtyTrace* trace) {
+    g_dirtyTrace = trace;
+}
+
+DirtyTrace* Widget::getDirtyTrace() {
+    return g_dirtyTrace;
+}
+
+void Widget::onThemeChanged() {}
+void Widget::updateLayout() {}
+void Widget::updateState() {}
+
+} // namespace gui
\ No newline at end of file
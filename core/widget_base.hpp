@@ -1,19 +1,73 @@
 #pragma once
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <functional>
+#include <vector>
 #include "math_types.hpp"
 #include "event_types.hpp"
+#include "widget_store.hpp"
+#include "../utils/small_function.hpp"
 
 namespace gui {
 
 class Event;
 class Widget;
 class Theme;
+class Container;
+class CommandBuffer;
+class DamageTracker;
+class LayerCache;
+class Renderer;
 
-using EventCallback = std::function<void(const Event&)>;
+// Обработчик хранится на месте; лямбда с несколькими захватами не выделяет память
+using EventCallback = utils::SmallFunction<void(const Event&)>;
 using RenderCallback = std::function<void(const Widget&)>;
 
+// Почему виджет отмечен устаревшим
+enum class DirtyCause : uint8_t {
+    None,
+    Created,
+    Explicit,       // markDirty() или invalidatePaint() без причины
+    Position,
+    Size,
+    Rotation,
+    Scale,
+    Visibility,
+    State,          // включение, фокус, наведение
+    Style,          // setCustomStyle()
+    Theme,
+    Reparent,       // виджет добавлен в контейнер или снят с него
+    Children,       // у контейнера изменился состав детей
+    Ancestor,       // отметка унаследована от предка
+    Descendant      // посещён по пути к устаревшему потомку
+};
+
+// Журнал посещений: какой виджет и почему попал в проход updateDirty()
+// или перезаписал список команд. Пишется и с потоков пула записи
+class DirtyTrace {
+public:
+    struct Entry {
+        const Widget* widget;
+        uint8_t flags;      // Widget::DirtyFlag
+        DirtyCause cause;
+    };
+
+    void add(const Widget* widget, uint8_t flags, DirtyCause cause);
+    std::vector<Entry> getEntries() const;
+    size_t size() const;
+    void clear();
+    // По строке на запись: «0x... layout|paint <- size»
+    std::string format() const;
+
+    static const char* causeName(DirtyCause cause);
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<Entry> entries_;
+};
+
 // Базовый класс для всех событий
 class Event {
 public:
@@ -44,14 +98,85 @@ private:
 // Базовый класс для всех виджетов
 class Widget {
 public:
+    // Вывод поддерева через слой кэша слоёв (LayerCache): Always — всегда,
+    // Auto — когда кэш решит, что поддерево давно не менялось, Never — никогда
+    enum class LayerMode {
+        Auto,
+        Always,
+        Never
+    };
+
     Widget();
-    virtual ~Widget() = default;
+    virtual ~Widget();
 
     // Основные функции жизненного цикла
     virtual void update(float deltaTime);
     virtual void render() const;
     virtual void handleEvent(const Event& event);
 
+    // Отрисовка через кэш: render() записывается в список команд только после
+    // invalidatePaint(), в остальных кадрах список воспроизводится в Renderer::current().
+    // Список родителя включает списки детей, поэтому сброс поднимается к корню.
+    void paint() const;
+    void invalidatePaint();
+    // Сброс с повреждением только части виджета, например мигающего курсора;
+    // area задаётся в координатах виджета, до его поворота и масштаба
+    void invalidatePaint(const Rect& area);
+    bool isPaintValid() const { return paintValid_; }
+
+    Widget* getParent() const { return parent_; }
+
+    // Область, которую занимает отрисовка виджета вместе с потомками, в координатах
+    // родителя. Кэшируется до invalidatePaint(); пустая область означает
+    // «неизвестно» и не отсекается.
+    Rect getPaintBounds() const;
+    // Область в координатах родителя, которую собственная отрисовка виджета
+    // закрывает непрозрачно; пустая, если такой нет или виджет повёрнут
+    Rect getOpaqueBounds() const;
+
+    // Поворот и масштаб вокруг позиции виджета; применяются ко всему поддереву
+    const Affine& getLocalTransform() const;
+    // Из координат виджета в координаты корня; после updateDirty() берётся из кэша
+    Affine getWorldTransform() const;
+
+    // Отметки устаревания. Сеттеры не вызывают updateLayout() и onThemeChanged()
+    // сразу, а отмечают виджет; проход updateDirty() от корня спускается только
+    // в поддеревья с отметками. Стиль и преобразование наследуются потомками,
+    // перерисовка поднимается к корню (см. invalidatePaint())
+    enum DirtyFlag : uint8_t {
+        LayoutDirty = 1 << 0,       // updateLayout()
+        PaintDirty = 1 << 1,        // перезапись списка команд
+        TransformDirty = 1 << 2,    // мировое преобразование
+        StyleDirty = 1 << 3         // onThemeChanged()
+    };
+
+    void markDirty(uint8_t flags, DirtyCause cause = DirtyCause::Explicit);
+    uint8_t getDirtyFlags() const { return dirty_ | (paintValid_ ? 0 : PaintDirty); }
+    bool hasDirtyDescendants() const { return descendantsDirty_; }
+    // Вызывается для корня раз в кадр до paint(): стиль, раскладка, преобразования
+    void updateDirty();
+
+    // Журнал посещений для всех деревьев; nullptr отключает запись
+    static void setDirtyTrace(DirtyTrace* trace);
+    static DirtyTrace* getDirtyTrace();
+
+    // Корень дерева передаёт повреждённые области в этот трекер
+    void setDamageTracker(DamageTracker* tracker) { damageTracker_ = tracker; }
+    // Кэш слоёв корня действует на всё дерево; без него слои не строятся
+    void setLayerCache(LayerCache* cache) { layerCache_ = cache; }
+
+    void setLayerMode(LayerMode mode);
+    LayerMode getLayerMode() const { return layerMode_; }
+
+    // Режим хранения структурой массивов: геометрия и флаги поддерева
+    // дублируются в store, где проходы обновления, отсечения и поиска под
+    // курсором идут линейно (см. WidgetStore). Дети, добавленные позже,
+    // привязываются автоматически; nullptr отвязывает поддерево.
+    // Хранилище должно пережить привязанные виджеты
+    void setWidgetStore(WidgetStore* store);
+    WidgetStore* getWidgetStore() const { return store_; }
+    WidgetStore::Handle getStoreHandle() const { return storeHandle_; }
+
     // Геометрия и позиционирование
     void setPosition(const Vector2f& pos);
     void setSize(const Vector2f& size);
@@ -83,6 +208,13 @@ public:
     // Стили и темы
     void setTheme(std::shared_ptr<Theme> theme);
     void setCustomStyle(const std::string& property, const std::string& value);
+    // Пустая строка, если свойство не задано
+    const std::string& getCustomStyle(const std::string& property) const;
+    // Для частых запросов: имя, заранее полученное из internStyleName(),
+    // сравнивается по указателю без обращения к общему пулу имён
+    const std::string& getCustomStyle(const std::string* property) const;
+    // Единственный экземпляр имени свойства; действителен до конца работы программы
+    static const std::string* internStyleName(const std::string& property);
 
 protected:
     Vector2f position_;
@@ -94,14 +226,71 @@ protected:
     bool enabled_;
     bool focused_;
     bool hovered_;
+    uint16_t handlerMask_ = 0;
 
     std::shared_ptr<Theme> theme_;
-    std::map<std::string, std::string> customStyles_;
-    std::map<Event::Type, EventCallback> eventHandlers_;
+    // Имя свойства интернировано и сравнивается по указателю
+    struct StyleProperty {
+        const std::string* name;
+        std::string value;
+    };
+    std::vector<StyleProperty> customStyles_;
+    // Слоты только назначенных типов событий: бит типа в handlerMask_,
+    // индекс слота — число назначенных типов с меньшим номером
+    std::unique_ptr<EventCallback[]> handlers_;
+
+    Widget* parent_ = nullptr;
+    DamageTracker* damageTracker_ = nullptr;
+    LayerCache* layerCache_ = nullptr;
+    LayerMode layerMode_ = LayerMode::Auto;
+    WidgetStore* store_ = nullptr;
+    WidgetStore::Handle storeHandle_;
+    mutable std::unique_ptr<CommandBuffer> displayList_;
+    mutable uint64_t recordGeneration_ = 0;     // растёт при каждой записи displayList_
+    mutable LayerCache* layerOwner_ = nullptr;  // кэш, который помнит виджет
+    mutable bool paintValid_ = false;
+    mutable Rect paintBounds_;
+    mutable bool paintBoundsValid_ = false;
+    mutable Affine localTransform_;
+    mutable bool transformValid_ = false;
+    Affine worldTransform_;
+    bool worldValid_ = false;
+    uint8_t dirty_ = LayoutDirty | TransformDirty | StyleDirty;
+    bool descendantsDirty_ = false;
+    DirtyCause dirtyCause_ = DirtyCause::Created;
+    DirtyCause paintCause_ = DirtyCause::Created;
+
+    // Виджеты, рисующие за пределами своего прямоугольника, расширяют область здесь
+    virtual Rect computePaintBounds() const { return Rect(position_, size_); }
+    // Виджеты с непрозрачным фоном сообщают его здесь, в координатах виджета;
+    // render() обязан закрасить эту область при любом состоянии виджета
+    virtual Rect computeOpaqueBounds() const { return Rect(); }
+
+    // Привязка к хранилищу; контейнер привязывает и детей
+    virtual void bindStore(WidgetStore* store);
+    // Контейнер продолжает проход и сброс кэша преобразований в детях
+    virtual void updateDirtyChildren(uint8_t inherited);
+    virtual void invalidateWorldTransform();
 
     virtual void onThemeChanged();
     virtual void updateLayout();
     virtual void updateState();
+
+private:
+    friend class Container;
+    friend class LayerCache;
+
+    const Rect& getLocalPaintBounds() const;
+    LayerCache* findLayerCache() const;
+    // Запись render() в displayList_ без воспроизведения; measure отвечает
+    // на измерения текста и изображений во время записи
+    void recordDisplayList(Renderer& measure) const;
+    void syncStoreGeometry();
+    void syncStoreFlags();
+    void setEventHandler(Event::Type type, EventCallback callback);
+    const EventCallback* findEventHandler(Event::Type type) const;
+    // inherited — отметки, пришедшие от предка
+    void processDirty(uint8_t inherited);
 };
 
 } // namespace gui
\ No newline at end of file
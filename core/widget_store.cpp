@@ -0,0 +1,231 @@
+#include "widget_store.hpp"
+
+namespace gui {
+
+WidgetStore::Handle WidgetStore::attach(Widget& widget, Handle parent) {
+    uint32_t index;
+    if (!freeSlots_.empty()) {
+        index = freeSlots_.back();
+        freeSlots_.pop_back();
+    } else {
+        index = static_cast<uint32_t>(widgets_.size());
+        positions_.emplace_back();
+        sizes_.emplace_back();
+        rotations_.push_back(0.0f);
+        scales_.emplace_back(1.0f, 1.0f);
+        flags_.push_back(0);
+        widgets_.push_back(nullptr);
+        parents_.push_back(kNone);
+        firstChildren_.push_back(kNone);
+        lastChildren_.push_back(kNone);
+        nextSiblings_.push_back(kNone);
+        prevSiblings_.push_back(kNone);
+        worldTransforms_.emplace_back();
+        worldBounds_.emplace_back();
+        effectiveVisible_.push_back(0);
+        dirty_.push_back(0);
+        generations_.push_back(0);
+    }
+
+    widgets_[index] = &widget;
+    positions_[index] = Vector2f();
+    sizes_[index] = Vector2f();
+    rotations_[index] = 0.0f;
+    scales_[index] = Vector2f(1.0f, 1.0f);
+    flags_[index] = Visible | Enabled;
+    worldTransforms_[index] = Affine();
+    worldBounds_[index] = Rect();
+    effectiveVisible_[index] = 0;
+    dirty_[index] = 1;
+    ++widgetCount_;
+
+    link(index, isValid(parent) ? parent.index : kNone);
+    return makeHandle(index);
+}
+
+void WidgetStore::detach(Handle handle) {
+    if (!isValid(handle))
+        return;
+    const uint32_t index = handle.index;
+    unlink(index);
+
+    for (uint32_t child = firstChildren_[index]; child != kNone;) {
+        const uint32_t next = nextSiblings_[child];
+        parents_[child] = kNone;
+        nextSiblings_[child] = kNone;
+        prevSiblings_[child] = kNone;
+        dirty_[child] = 1;
+        child = next;
+    }
+    firstChildren_[index] = kNone;
+    lastChildren_[index] = kNone;
+
+    widgets_[index] = nullptr;
+    ++generations_[index];
+    freeSlots_.push_back(index);
+    --widgetCount_;
+    orderValid_ = false;
+}
+
+void WidgetStore::link(uint32_t index, uint32_t parent) {
+    parents_[index] = parent;
+    nextSiblings_[index] = kNone;
+    prevSiblings_[index] = kNone;
+    if (parent != kNone) {
+        const uint32_t last = lastChildren_[parent];
+        prevSiblings_[index] = last;
+        if (last != kNone)
+            nextSiblings_[last] = index;
+        else
+            firstChildren_[parent] = index;
+        lastChildren_[parent] = index;
+    }
+    orderValid_ = false;
+}
+
+void WidgetStore::unlink(uint32_t index) {
+    const uint32_t parent = parents_[index];
+    const uint32_t prev = prevSiblings_[index];
+    const uint32_t next = nextSiblings_[index];
+    if (parent != kNone) {
+        if (prev != kNone)
+            nextSiblings_[prev] = next;
+        else
+            firstChildren_[parent] = next;
+        if (next != kNone)
+            prevSiblings_[next] = prev;
+        else
+            lastChildren_[parent] = prev;
+    }
+    parents_[index] = kNone;
+    nextSiblings_[index] = kNone;
+    prevSiblings_[index] = kNone;
+    orderValid_ = false;
+}
+
+void WidgetStore::setGeometry(Handle handle, const Vector2f& position, const Vector2f& size, float rotation,
+                              const Vector2f& scale) {
+    if (!isValid(handle))
+        return;
+    const uint32_t index = handle.index;
+    positions_[index] = position;
+    sizes_[index] = size;
+    rotations_[index] = rotation;
+    scales_[index] = scale;
+    dirty_[index] = 1;
+}
+
+void WidgetStore::setFlags(Handle handle, uint8_t flags) {
+    if (!isValid(handle) || flags_[handle.index] == flags)
+        return;
+    // Видимость наследуется потомками, остальные флаги — нет
+    if ((flags_[handle.index] ^ flags) & Visible)
+        dirty_[handle.index] = 1;
+    flags_[handle.index] = flags;
+}
+
+// Прямой обход без стека: вниз к первому ребёнку, иначе к следующему
+// соседу ближайшего предка, у которого он есть
+void WidgetStore::rebuildOrder() const {
+    order_.clear();
+    order_.reserve(widgetCount_);
+    for (uint32_t root = 0; root < widgets_.size(); ++root) {
+        if (!widgets_[root] || parents_[root] != kNone)
+            continue;
+        uint32_t index = root;
+        for (;;) {
+            order_.push_back(index);
+            if (firstChildren_[index] != kNone) {
+                index = firstChildren_[index];
+                continue;
+            }
+            while (index != root && nextSiblings_[index] == kNone)
+                index = parents_[index];
+            if (index == root)
+                break;
+            index = nextSiblings_[index];
+        }
+    }
+    orderValid_ = true;
+}
+
+// Локальное преобразование то же, что у Widget::getLocalTransform():
+// поворот и масштаб вокруг позиции виджета
+void WidgetStore::updateTransforms() {
+    if (!orderValid_)
+        rebuildOrder();
+    changed_.resize(widgets_.size());
+    transformsUpdated_ = 0;
+
+    for (uint32_t index : order_) {
+        const uint32_t parent = parents_[index];
+        const bool parentChanged = parent != kNone && changed_[parent];
+        if (!dirty_[index] && !parentChanged) {
+            changed_[index] = 0;
+            continue;
+        }
+
+        const Vector2f& position = positions_[index];
+        const Vector2f& scale = scales_[index];
+        const float rotation = rotations_[index];
+        Affine world = parent != kNone ? worldTransforms_[parent] : Affine();
+        if (rotation != 0.0f || scale.x != 1.0f || scale.y != 1.0f) {
+            world = world * Affine::translation(position.x, position.y) *
+                    Transform(Vector2f(), scale, rotation).toMatrix() *
+                    Affine::translation(-position.x, -position.y);
+        }
+        worldTransforms_[index] = world;
+        worldBounds_[index] = world.mapRect(Rect(position, sizes_[index]));
+        effectiveVisible_[index] = (flags_[index] & Visible) && (parent == kNone || effectiveVisible_[parent]);
+        dirty_[index] = 0;
+        changed_[index] = 1;
+        ++transformsUpdated_;
+    }
+}
+
+// Детям не нужно лежать внутри родителя, поэтому проверяется каждый виджет,
+// а не поддерево целиком
+size_t WidgetStore::cull(const Rect& view, std::vector<Handle>& visible) const {
+    if (!orderValid_)
+        rebuildOrder();
+    const size_t before = visible.size();
+    for (uint32_t index : order_) {
+        if (effectiveVisible_[index] && worldBounds_[index].intersects(view))
+            visible.push_back(makeHandle(index));
+    }
+    return visible.size() - before;
+}
+
+// Позже нарисованный виджет лежит сверху, поэтому обход идёт с конца;
+// повёрнутый виджет проверяется в своих координатах
+WidgetStore::Handle WidgetStore::hitTest(const Vector2f& point, bool enabledOnly) const {
+    if (!orderValid_)
+        rebuildOrder();
+    for (size_t i = order_.size(); i-- > 0;) {
+        const uint32_t index = order_[i];
+        if (!effectiveVisible_[index] || (enabledOnly && !(flags_[index] & Enabled)))
+            continue;
+        if (!worldBounds_[index].contains(point))
+            continue;
+        const Affine& world = worldTransforms_[index];
+        if (!world.isAxisAligned() &&
+            !Rect(positions_[index], sizes_[index]).contains(world.inverse().apply(point)))
+            continue;
+        return makeHandle(index);
+    }
+    return Handle();
+}
+
+WidgetStore::Stats WidgetStore::getStats() const {
+    Stats stats;
+    stats.widgetCount = widgetCount_;
+    stats.slotCount = widgets_.size();
+    const size_t perSlot = sizeof(Vector2f) * 3 + sizeof(float) + sizeof(uint8_t) * 3 + sizeof(Widget*) +
+                           sizeof(uint32_t) * 6 + sizeof(Affine) + sizeof(Rect);
+    stats.bytes = perSlot * widgets_.size() + sizeof(uint32_t) * (freeSlots_.size() + order_.size()) +
+                  changed_.size();
+    stats.transformsUpdated = transformsUpdated_;
+    return stats;
+}
+
+} // namespace gui
\ No newline at end of file
@@ -0,0 +1,131 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "math_types.hpp"
+
+namespace gui {
+
+class Widget;
+
+// Хранилище геометрии, флагов и преобразований виджетов структурой массивов.
+// Каждое поле лежит в своём непрерывном массиве, индекс — слот дескриптора,
+// поэтому проходы по тысячам виджетов (пересчёт мировых преобразований,
+// отсечение, поиск под курсором) идут по плотным данным без виртуальных
+// вызовов и обхода shared_ptr детей. Виджет, привязанный через
+// Widget::setWidgetStore(), дублирует сюда каждое изменение своих полей.
+// Не потокобезопасно.
+class WidgetStore {
+public:
+    // Стабильный дескриптор слота; поколение отсекает устаревшие дескрипторы
+    // при повторном использовании слота
+    struct Handle {
+        uint32_t index = InvalidIndex;
+        uint32_t generation = 0;
+
+        static constexpr uint32_t InvalidIndex = 0xFFFFFFFFu;
+
+        bool isValid() const { return index != InvalidIndex; }
+        explicit operator bool() const { return isValid(); }
+
+        bool operator==(const Handle& other) const {
+            return index == other.index && generation == other.generation;
+        }
+        bool operator!=(const Handle& other) const { return !(*this == other); }
+    };
+
+    enum Flag : uint8_t {
+        Visible = 1 << 0,
+        Enabled = 1 << 1,
+        Focused = 1 << 2,
+        Hovered = 1 << 3
+    };
+
+    struct Stats {
+        size_t widgetCount = 0;
+        size_t slotCount = 0;           // вместе со свободными слотами
+        size_t bytes = 0;               // память массивов
+        size_t transformsUpdated = 0;   // за последний updateTransforms()
+    };
+
+    // Новый слот становится последним ребёнком parent; без parent или
+    // с невалидным parent — корнем
+    Handle attach(Widget& widget) { return attach(widget, Handle()); }
+    Handle attach(Widget& widget, Handle parent);
+    // Дети снятого слота становятся корнями
+    void detach(Handle handle);
+
+    bool isValid(Handle handle) const {
+        return handle.index < generations_.size() && generations_[handle.index] == handle.generation &&
+               widgets_[handle.index] != nullptr;
+    }
+    Widget* getWidget(Handle handle) const { return isValid(handle) ? widgets_[handle.index] : nullptr; }
+
+    // Запись со стороны виджета; отмечает слот к пересчёту
+    void setGeometry(Handle handle, const Vector2f& position, const Vector2f& size, float rotation,
+                     const Vector2f& scale);
+    void setFlags(Handle handle, uint8_t flags);
+    uint8_t getFlags(Handle handle) const { return isValid(handle) ? flags_[handle.index] : 0; }
+
+    // Результаты updateTransforms(): из координат виджета в координаты корня
+    // и мировой прямоугольник виджета; дескриптор должен быть валиден
+    const Affine& getWorldTransform(Handle handle) const { return worldTransforms_[handle.index]; }
+    const Rect& getWorldBounds(Handle handle) const { return worldBounds_[handle.index]; }
+    // Виден сам виджет и все его предки
+    bool isEffectivelyVisible(Handle handle) const { return isValid(handle) && effectiveVisible_[handle.index]; }
+
+    // Линейный проход в порядке отрисовки: пересчитываются только отмеченные
+    // слоты и их потомки
+    void updateTransforms();
+    // Дописывает в visible виджеты, чей мировой прямоугольник пересекает view,
+    // в порядке отрисовки; возвращает их число
+    size_t cull(const Rect& view, std::vector<Handle>& visible) const;
+    // Верхний по порядку отрисовки видимый виджет под точкой корня.
+    // enabledOnly пропускает выключенные виджеты
+    Handle hitTest(const Vector2f& point, bool enabledOnly = true) const;
+
+    Stats getStats() const;
+
+private:
+    static constexpr uint32_t kNone = Handle::InvalidIndex;
+
+    Handle makeHandle(uint32_t index) const { return Handle{index, generations_[index]}; }
+    void link(uint32_t index, uint32_t parent);
+    void unlink(uint32_t index);
+    void rebuildOrder() const;
+
+    // Поля виджетов
+    std::vector<Vector2f> positions_;
+    std::vector<Vector2f> sizes_;
+    std::vector<float> rotations_;
+    std::vector<Vector2f> scales_;
+    std::vector<uint8_t> flags_;
+    std::vector<Widget*> widgets_;
+
+    // Иерархия: родитель и соседи по порядку детей контейнера
+    std::vector<uint32_t> parents_;
+    std::vector<uint32_t> firstChildren_;
+    std::vector<uint32_t> lastChildren_;
+    std::vector<uint32_t> nextSiblings_;
+    std::vector<uint32_t> prevSiblings_;
+
+    // Производные данные
+    std::vector<Affine> worldTransforms_;
+    std::vector<Rect> worldBounds_;
+    std::vector<uint8_t> effectiveVisible_;
+    std::vector<uint8_t> dirty_;
+
+    std::vector<uint32_t> generations_;
+    std::vector<uint32_t> freeSlots_;
+    size_t widgetCount_ = 0;
+    size_t transformsUpdated_ = 0;
+
+    // Слоты в порядке отрисовки (прямой обход дерева); строится заново
+    // после изменения иерархии. Пока дерево собирается сверху вниз, совпадает
+    // с порядком слотов, и проходы читают массивы подряд
+    mutable std::vector<uint32_t> order_;
+    mutable bool orderValid_ = true;
+    std::vector<uint8_t> changed_;
+};
+
+} // namespace gui
\ No newline at end of file
@@ -0,0 +1,329 @@
+#include "containers.hpp"
+#include "../core/renderer.hpp"
+#include "../render/command_buffer.hpp"
+#include "../themes/style_system.hpp"
+#include <algorithm>
+
+namespace gui {
+
+namespace {
+utils::ThreadPool* g_recordingPool = nullptr;
+size_t g_minParallelChildren = 16;
+bool g_occlusionCulling = true;
+
+// Сглаживание края закрывающей области может пропустить часть соседнего пикселя
+constexpr float kOcclusionMargin = 1.0f;
+// Проверка против каждого закрывающего соседа; ограничение держит обход линейным
+constexpr size_t kMaxOccluders = 16;
+
+thread_local std::vector<Rect> t_occluders;
+
+Color withOpacity(Color color, float opacity) {
+    color.a *= opacity;
+    return color;
+}
+}
+
+void Container::setRecordingPool(utils::ThreadPool* pool, size_t minChildren) {
+    g_recordingPool = pool;
+    g_minParallelChildren = std::max<size_t>(minChildren, 2);
+}
+
+utils::ThreadPool* Container::getRecordingPool() {
+    return g_recordingPool;
+}
+
+void Container::setOcclusionCulling(bool enabled) {
+    g_occlusionCulling = enabled;
+}
+
+bool Container::isOcclusionCulling() {
+    return g_occlusionCulling;
+}
+
+void Container::addChild(std::shared_ptr<Widget> child) {
+    if (!child || child.get() == this)
+        return;
+
+    child->parent_ = this;
+    children_.push_back(child);
+    if (store_ || child->store_)
+        child->bindStore(store_);
+    child->markDirty(TransformDirty | StyleDirty, DirtyCause::Reparent);
+    markDirty(LayoutDirty, DirtyCause::Children);
+    onChildAdded(child);
+    invalidatePaint(child->getPaintBounds());
+}
+
+void Container::removeChild(std::shared_ptr<Widget> child) {
+    auto it = std::find(children_.begin(), children_.end(), child);
+    if (it == children_.end())
+        return;
+
+    children_.erase(it);
+    child->parent_ = nullptr;
+    if (child->store_)
+        child->bindStore(nullptr);
+    child->markDirty(TransformDirty, DirtyCause::Reparent);
+    markDirty(LayoutDirty, DirtyCause::Children);
+    onChildRemoved(child);
+    invalidatePaint(child->getPaintBounds());
+}
+
+void Container::clearChildren() {
+    std::vector<std::shared_ptr<Widget>> removed;
+    removed.swap(children_);
+    for (auto& child : removed) {
+        child->parent_ = nullptr;
+        if (child->store_)
+            child->bindStore(nullptr);
+        child->markDirty(TransformDirty, DirtyCause::Reparent);
+        onChildRemoved(child);
+        invalidatePaint(child->getPaintBounds());
+    }
+    if (!removed.empty())
+        markDirty(LayoutDirty, DirtyCause::Children);
+}
+
+const std::vector<std::shared_ptr<Widget>>& Container::getChildren() const {
+    return children_;
+}
+
+void Container::update(float deltaTime) {
+    Widget::update(deltaTime);
+    for (auto& child : children_) {
+        child->update(deltaTime);
+    }
+}
+
+// Дети рисуются через paint(): неизменённые поддеревья воспроизводят
+// свои списки команд без повторного обхода, а поддеревья вне текущего
+// отсечения пропускаются целиком
+void Container::render() const {
+    std::vector<uint8_t> occluded;
+    findOccludedChildren(occluded);
+    recordStaleChildren(occluded);
+
+    Renderer* target = Renderer::current();
+    for (size_t i = 0; i < children_.size(); ++i) {
+        if (!occluded.empty() && occluded[i]) {
+            if (target)
+                target->recordOccludedWidget();
+            continue;
+        }
+        children_[i]->paint();
+    }
+}
+
+// Дети обходятся сверху вниз, накапливая непрозрачные области уже пройденных.
+// Перекрытый ребёнок сам ничего не добавляет: его область уже закрыта.
+void Container::findOccludedChildren(std::vector<uint8_t>& occluded) const {
+    if (!g_occlusionCulling || children_.size() < 2)
+        return;
+
+    std::vector<Rect>& occluders = t_occluders;
+    occluders.clear();
+    for (size_t i = children_.size(); i-- > 0;) {
+        const Widget& child = *children_[i];
+        if (!child.isVisible())
+            continue;
+
+        if (!occluders.empty()) {
+            const Rect bounds = child.getPaintBounds();
+            const bool covered = !bounds.isEmpty() &&
+                std::any_of(occluders.begin(), occluders.end(),
+                            [&bounds](const Rect& occluder) { return occluder.contains(bounds); });
+            if (covered) {
+                if (occluded.empty())
+                    occluded.assign(children_.size(), 0);
+                occluded[i] = 1;
+                continue;
+            }
+        }
+
+        if (occluders.size() >= kMaxOccluders)
+            continue;
+        const Rect opaque = child.getOpaqueBounds();
+        if (opaque.size.x > kOcclusionMargin * 2.0f && opaque.size.y > kOcclusionMargin * 2.0f) {
+            occluders.emplace_back(opaque.position + Vector2f(kOcclusionMargin, kOcclusionMargin),
+                                   opaque.size - Vector2f(kOcclusionMargin * 2.0f, kOcclusionMargin * 2.0f));
+        }
+    }
+}
+
+// Списки детей записываются на потоках пула, каждый в свой буфер; последующий
+// paint() только воспроизводит их по порядку, сохраняя порядок отрисовки,
+// отсечение и преобразования родителя
+void Container::recordStaleChildren(const std::vector<uint8_t>& occluded) const {
+    Renderer* target = Renderer::current();
+    if (!g_recordingPool || !target || children_.size() < g_minParallelChildren ||
+        !target->isMeasureThreadSafe())
+        return;
+
+    std::vector<const Widget*> stale;
+    for (size_t i = 0; i < children_.size(); ++i) {
+        const auto& child = children_[i];
+        if (!child->isVisible() || (child->paintValid_ && child->displayList_))
+            continue;
+        if (!occluded.empty() && occluded[i])
+            continue;
+        const Rect bounds = child->getPaintBounds();
+        if (!bounds.isEmpty() && target->testClip(bounds) == ClipTest::Outside)
+            continue;
+        stale.push_back(child.get());
+    }
+    if (stale.size() < g_minParallelChildren)
+        return;
+
+    g_recordingPool->parallelFor(stale.size(), [&stale, target](size_t i) {
+        stale[i]->recordDisplayList(*target);
+    });
+    for (const Widget* child : stale) {
+        target->addCullStats(child->displayList_->getCullStats());
+    }
+}
+
+Rect Container::computePaintBounds() const {
+    Rect bounds = Widget::computePaintBounds();
+    for (const auto& child : children_) {
+        if (child->isVisible())
+            bounds = bounds.united(child->getPaintBounds());
+    }
+    return bounds;
+}
+
+void Container::bindStore(WidgetStore* store) {
+    Widget::bindStore(store);
+    for (auto& child : children_) {
+        child->bindStore(store);
+    }
+}
+
+// Чистые дети без унаследованных отметок возвращаются сразу
+void Container::updateDirtyChildren(uint8_t inherited) {
+    for (auto& child : children_) {
+        child->processDirty(inherited);
+    }
+}
+
+// Сброс не спускается в поддерево, кэш которого уже сброшен
+void Container::invalidateWorldTransform() {
+    if (!worldValid_)
+        return;
+    Widget::invalidateWorldTransform();
+    for (auto& child : children_) {
+        child->invalidateWorldTransform();
+    }
+}
+
+void Container::handleEvent(const Event& event) {
+    Widget::handleEvent(event);
+    for (auto& child : children_) {
+        child->handleEvent(event);
+    }
+}
+
+void Container::onChildAdded(std::shared_ptr<Widget> child) {
+    (void)child;
+}
+
+void Container::onChildRemoved(std::shared_ptr<Widget> child) {
+    (void)child;
+}
+
+void Panel::setBorderVisible(bool visible) {
+    borderVisible_ = visible;
+    invalidatePaint();
+}
+
+void Panel::setBackgroundColor(const Color& color) {
+    backgroundColor_ = color;
+    invalidatePaint();
+}
+
+void Panel::setBorderColor(const Color& color) {
+    borderColor_ = color;
+    invalidatePaint();
+}
+
+void Panel::setBorderThickness(float thickness) {
+    borderThickness_ = thickness;
+    invalidatePaint();
+}
+
+void Panel::setCornerRadius(float radius) {
+    cornerRadius_ = radius;
+    invalidatePaint();
+}
+
+void Panel::setOpacity(float opacity) {
+    opacity_ = std::clamp(opacity, 0.0f, 1.0f);
+    invalidatePaint();
+}
+
+void Panel::applyStyle(const Style& style) {
+    backgroundColor_ = style.backgroundColor;
+    borderColor_ = style.borderColor;
+    borderThickness_ = style.borderWidth;
+    cornerRadius_ = style.borderRadius;
+    opacity_ = std::clamp(style.opacity, 0.0f, 1.0f);
+    setShadow(style.shadow.enabled ? style.shadow.color : Color::transparent(), style.shadow.offset,
+              style.shadow.blur);
+}
+
+// Тень расширяет область отрисовки: повреждаются старая и новая области
+void Panel::setShadow(const Color& color, const Vector2f& offset, float blur) {
+    invalidatePaint();
+    shadowColor_ = color;
+    shadowOffset_ = offset;
+    shadowBlur_ = std::max(blur, 0.0f);
+    invalidatePaint();
+}
+
+void Panel::setSkin(const std::string& imagePath, const NineSlice& slice) {
+    skinPath_ = imagePath;
+    skinSlice_ = slice;
+    invalidatePaint();
+}
+
+// Фон, рамка и тень выводятся одной фигурой: без швов между примитивами
+// и с одним проходом по пикселям
+ShapeStyle Panel::makeShapeStyle() const {
+    ShapeStyle style;
+    style.fill = withOpacity(backgroundColor_, opacity_);
+    if (borderVisible_ && borderThickness_ > 0.0f) {
+        style.border = withOpacity(borderColor_, opacity_);
+        style.borderWidth = borderThickness_;
+    }
+    style.setRadius(cornerRadius_);
+    style.shadow = withOpacity(shadowColor_, opacity_);
+    style.shadowOffset = shadowOffset_;
+    style.shadowBlur = shadowBlur_;
+    return style;
+}
+
+void Panel::render() const {
+    Renderer* renderer = Renderer::current();
+    if (!renderer)
+        return;
+
+    const ShapeStyle style = makeShapeStyle();
+    if (style.fill.a > 0.0f || style.border.a > 0.0f || style.shadow.a > 0.0f)
+        renderer->drawShape(Rect(position_, size_), style);
+    if (!skinPath_.empty() && opacity_ > 0.0f) {
+        const ImageHandle skin = renderer->resolveImage(skinPath_);
+        if (skin)
+            renderer->drawNineSlice(skin, Rect(position_, size_), skinSlice_, withOpacity(Color::white(), opacity_));
+    }
+    Container::render();
+}
+
+Rect Panel::computePaintBounds() const {
+    return Container::computePaintBounds().united(shapeBounds(Rect(position_, size_), makeShapeStyle()));
+}
+
+Rect Panel::computeOpaqueBounds() const {
+    return opaqueFillArea(Rect(position_, size_), backgroundColor_, opacity_, cornerRadius_);
+}
+
+} // namespace gui
\ No newline at end of file
@@ -2,9 +2,13 @@
 #include <vector>
 #include <string>
 #include "../core/widget_base.hpp"
+#include "../core/renderer.hpp"
+#include "../utils/thread_pool.hpp"
 
 namespace gui {
 
+class Style;
+
 class Container : public Widget {
 public:
     void addChild(std::shared_ptr<Widget> child);
@@ -17,12 +21,39 @@ public:
     void render() const override;
     void handleEvent(const Event& event) override;
 
+    // Параллельная запись поддеревьев. Если у контейнера не меньше minChildren
+    // детей с устаревшими списками команд, они записываются в пуле, а затем
+    // воспроизводятся по порядку, так что результат совпадает с последовательным.
+    // Включается, только если рендерер измерения потокобезопасен; render()
+    // виджетов не должен менять состояние за пределами своего поддерева.
+    // nullptr отключает режим.
+    static void setRecordingPool(utils::ThreadPool* pool, size_t minChildren = 16);
+    static utils::ThreadPool* getRecordingPool();
+
+    // Отсечение перекрытых детей: ребёнок, чьё поддерево целиком лежит под
+    // непрозрачной областью более позднего соседа (getOpaqueBounds()), не рисуется.
+    // Учитываются только соседи, поэтому решение остаётся верным для кэша
+    // списка команд контейнера. Включено по умолчанию.
+    static void setOcclusionCulling(bool enabled);
+    static bool isOcclusionCulling();
+
 protected:
+    Rect computePaintBounds() const override;
+    void bindStore(WidgetStore* store) override;
+    void updateDirtyChildren(uint8_t inherited) override;
+    void invalidateWorldTransform() override;
+    // occluded — флаги детей, которые не рисуются; пустой — рисуются все
+    void recordStaleChildren(const std::vector<uint8_t>& occluded = {}) const;
+    // Заполняет occluded, только если перекрыт хотя бы один ребёнок
+    void findOccludedChildren(std::vector<uint8_t>& occluded) const;
+
     std::vector<std::shared_ptr<Widget>> children_;
     virtual void onChildAdded(std::shared_ptr<Widget> child);
     virtual void onChildRemoved(std::shared_ptr<Widget> child);
 };
 
+// Контейнер с фоном и рамкой. По умолчанию фон и рамка прозрачны.
+// Непрозрачный фон закрывает соседей под панелью (см. setOcclusionCulling).
 class Panel : public Container {
 public:
     void setBorderVisible(bool visible);
@@ -30,13 +61,35 @@ public:
     void setBorderColor(const Color& color);
     void setBorderThickness(float thickness);
     void setCornerRadius(float radius);
+    // Умножает альфу фона и рамки; на детей не влияет
+    void setOpacity(float opacity);
+    // Тень под фоном; прозрачный цвет отключает её
+    void setShadow(const Color& color, const Vector2f& offset, float blur);
+    // Скин поверх фона: изображение растягивается по панели девятью частями,
+    // углы сохраняют исходный размер. Пустой путь убирает скин
+    void setSkin(const std::string& imagePath, const NineSlice& slice);
+    // Фон, рамка, скругление, тень и прозрачность из стиля
+    void applyStyle(const Style& style);
+
+protected:
+    void render() const override;
+    Rect computePaintBounds() const override;
+    Rect computeOpaqueBounds() const override;
 
 private:
+    ShapeStyle makeShapeStyle() const;
+
     bool borderVisible_ = true;
-    Color backgroundColor_;
-    Color borderColor_;
+    Color backgroundColor_ = Color::transparent();
+    Color borderColor_ = Color::transparent();
     float borderThickness_ = 1.0f;
     float cornerRadius_ = 0.0f;
+    float opacity_ = 1.0f;
+    Color shadowColor_ = Color::transparent();
+    Vector2f shadowOffset_;
+    float shadowBlur_ = 0.0f;
+    std::string skinPath_;
+    NineSlice skinSlice_;
 };
 
 class Window : public Panel {
@@ -0,0 +1,157 @@
+#include "visuals.hpp"
+#include <algorithm>
+#include <cstdio>
+
+namespace gui {
+
+namespace {
+
+const char* metricName(RenderStatsOverlay::Metric metric) {
+    switch (metric) {
+        case RenderStatsOverlay::Metric::FrameTime:    return "frame ms";
+        case RenderStatsOverlay::Metric::DrawCalls:    return "draw calls";
+        case RenderStatsOverlay::Metric::Primitives:   return "primitives";
+        case RenderStatsOverlay::Metric::StateChanges: return "state changes";
+        case RenderStatsOverlay::Metric::ClipPushes:   return "clip pushes";
+        case RenderStatsOverlay::Metric::PixelsFilled: return "pixels";
+    }
+    return "";
+}
+
+} // namespace
+
+RenderStatsOverlay::RenderStatsOverlay(const Renderer* source)
+    : source_(source)
+    , backgroundColor_(0.0f, 0.0f, 0.0f, 0.6f)
+    , graphColor_(0.3f, 0.8f, 0.4f, 1.0f)
+    , textColor_(Color::white()) {
+    size_ = Vector2f(240.0f, 80.0f);
+}
+
+void RenderStatsOverlay::setSource(const Renderer* source) {
+    source_ = source;
+    sampledFrames_ = 0;
+    samples_.clear();
+    average_ = RenderStats();
+    invalidatePaint();
+}
+
+void RenderStatsOverlay::setMetric(Metric metric) {
+    metric_ = metric;
+    invalidatePaint();
+}
+
+void RenderStatsOverlay::setBackgroundColor(const Color& color) {
+    backgroundColor_ = color;
+    invalidatePaint();
+}
+
+void RenderStatsOverlay::setGraphColor(const Color& color) {
+    graphColor_ = color;
+    invalidatePaint();
+}
+
+void RenderStatsOverlay::setTextColor(const Color& color) {
+    textColor_ = color;
+    invalidatePaint();
+}
+
+void RenderStatsOverlay::setFontSize(float size) {
+    fontSize_ = size;
+    invalidatePaint();
+}
+
+double RenderStatsOverlay::getMetricValue(const RenderStats& stats, Metric metric) {
+    switch (metric) {
+        case Metric::FrameTime:    return stats.frameTimeMs;
+        case Metric::DrawCalls:    return static_cast<double>(stats.drawCalls);
+        case Metric::Primitives:   return static_cast<double>(stats.primitives);
+        case Metric::StateChanges: return static_cast<double>(stats.stateChanges);
+        case Metric::ClipPushes:   return static_cast<double>(stats.clipPushes);
+        case Metric::PixelsFilled: return static_cast<double>(stats.pixelsFilled);
+    }
+    return 0.0;
+}
+
+// Окно копируется только после нового кадра, иначе наложение не перерисовывается
+void RenderStatsOverlay::update(float deltaTime) {
+    Widget::update(deltaTime);
+    if (!source_)
+        return;
+
+    const RenderStatsHistory& history = source_->getRenderStatsHistory();
+    if (history.getFrameCount() == sampledFrames_)
+        return;
+
+    sampledFrames_ = history.getFrameCount();
+    samples_.resize(history.size());
+    for (size_t i = 0; i < history.size(); ++i) {
+        samples_[i] = history.at(i);
+    }
+    average_ = history.average();
+    invalidatePaint();
+}
+
+void RenderStatsOverlay::render() const {
+    Renderer* renderer = Renderer::current();
+    if (!renderer)
+        return;
+
+    const Rect bounds(position_, size_);
+    renderer->fillRect(bounds, backgroundColor_);
+    if (samples_.empty())
+        return;
+
+    const RenderStats& last = samples_.back();
+    const float padding = 4.0f;
+    const float lineHeight = fontSize_ + 2.0f;
+    char line[128];
+
+    std::snprintf(line, sizeof(line), "draw %llu  prim %llu  state %llu  clip %llu",
+                  static_cast<unsigned long long>(last.drawCalls),
+                  static_cast<unsigned long long>(last.primitives),
+                  static_cast<unsigned long long>(last.stateChanges),
+                  static_cast<unsigned long long>(last.clipPushes));
+    renderer->drawText(line, position_ + Vector2f(padding, padding), "", fontSize_, textColor_);
+
+    std::snprintf(line, sizeof(line), "px %.2fM  %.2f ms  avg %.2f ms",
+                  static_cast<double>(last.pixelsFilled) / 1.0e6, last.frameTimeMs, average_.frameTimeMs);
+    renderer->drawText(line, position_ + Vector2f(padding, padding + lineHeight), "", fontSize_, textColor_);
+
+    const double averageValue = getMetricValue(average_, metric_);
+    std::snprintf(line, sizeof(line), "%s  avg %.1f", metricName(metric_), averageValue);
+    renderer->drawText(line, position_ + Vector2f(padding, padding + lineHeight * 2.0f), "", fontSize_, textColor_);
+
+    // График занимает остаток под текстом; столбец на кадр, последний кадр справа
+    const float graphTop = position_.y + padding + lineHeight * 3.0f;
+    const float graphBottom = position_.y + size_.y - padding;
+    const float graphHeight = graphBottom - graphTop;
+    const float graphWidth = size_.x - padding * 2.0f;
+    if (graphHeight <= 0.0f || graphWidth <= 0.0f)
+        return;
+
+    double peak = 0.0;
+    for (const RenderStats& sample : samples_) {
+        peak = std::max(peak, getMetricValue(sample, metric_));
+    }
+    if (peak <= 0.0)
+        return;
+
+    const size_t count = samples_.size();
+    const float barWidth = graphWidth / static_cast<float>(count);
+    const float scale = graphHeight / static_cast<float>(peak);
+    for (size_t i = 0; i < count; ++i) {
+        const float height = static_cast<float>(getMetricValue(samples_[i], metric_)) * scale;
+        if (height <= 0.0f)
+            continue;
+        const float x = position_.x + padding + barWidth * static_cast<float>(i);
+        renderer->fillRect(Rect(Vector2f(x, graphBottom - height), Vector2f(std::max(barWidth - 1.0f, 1.0f), height)),
+                           graphColor_);
+    }
+
+    const float averageY = graphBottom - static_cast<float>(averageValue) * scale;
+    renderer->drawLine(Vector2f(position_.x + padding, averageY), Vector2f(position_.x + padding + graphWidth, averageY),
+                       textColor_, 1.0f);
+}
+
+} // namespace gui
\ No newline at end of file
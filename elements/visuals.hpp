@@ -2,6 +2,7 @@
 #include <memory>
 #include <string>
 #include <vector>
+#include "../core/renderer.hpp"
 #include "../core/widget_base.hpp"
 
 namespace gui {
@@ -136,4 +137,46 @@ private:
     float thickness_ = 1.0f;
 };
 
+// Наложение со статистикой рендерера: текущие значения со средними за окно
+// и столбчатый график выбранной метрики. Источник опрашивается в update(),
+// поэтому он не должен в это время рисовать на другом потоке.
+class RenderStatsOverlay : public Widget {
+public:
+    enum class Metric {
+        FrameTime,
+        DrawCalls,
+        Primitives,
+        StateChanges,
+        ClipPushes,
+        PixelsFilled
+    };
+
+    explicit RenderStatsOverlay(const Renderer* source = nullptr);
+
+    void setSource(const Renderer* source);
+    void setMetric(Metric metric);
+    void setBackgroundColor(const Color& color);
+    void setGraphColor(const Color& color);
+    void setTextColor(const Color& color);
+    void setFontSize(float size);
+
+    void update(float deltaTime) override;
+
+    static double getMetricValue(const RenderStats& stats, Metric metric);
+
+protected:
+    void render() const override;
+
+private:
+    const Renderer* source_;
+    uint64_t sampledFrames_ = 0;
+    std::vector<RenderStats> samples_;  // от старых кадров к новым
+    RenderStats average_;
+    Metric metric_ = Metric::FrameTime;
+    Color backgroundColor_;
+    Color graphColor_;
+    Color textColor_;
+    float fontSize_ = 8.0f;
+};
+
 } // namespace gui
\ No newline at end of file
@@ -0,0 +1,450 @@
+#include "command_buffer.hpp"
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+namespace gui {
+
+namespace {
+
+// Параметры команд. Все поля — float/uint32_t, поэтому записи остаются
+// выровненными по 4 байта и читаются простым memcpy.
+struct ColorPayload { Color color; };
+struct RectPayload { Rect rect; Color color; float thickness; };
+struct RoundedRectPayload { Rect rect; float radius; Color color; float thickness; };
+struct ShapePayload { Rect rect; ShapeStyle style; };
+struct CirclePayload { Vector2f center; float radius; Color color; float thickness; };
+struct LinePayload { Vector2f start; Vector2f end; Color color; float thickness; };
+struct TrianglePayload { Vector2f p1; Vector2f p2; Vector2f p3; Color color; float thickness; };
+struct TextPayload { uint32_t text; uint32_t font; Vector2f position; float size; Color color; };
+struct ImagePayload { uint32_t path; Rect destRect; Color tint; };
+struct ImageHandlePayload { uint32_t image; Rect destRect; Color tint; };
+struct FillPathPayload { uint32_t path; Color color; FillRule rule; };
+struct StrokePathPayload { uint32_t path; Color color; StrokeStyle stroke; };
+struct NineSlicePayload { uint32_t image; Rect destRect; NineSlice slice; Color tint; };
+struct ClipPayload { Rect rect; };
+struct TransformPayload { Transform transform; };
+struct MatrixPayload { Affine matrix; };
+struct ValuePayload { uint32_t value; };
+
+template<typename Payload>
+Payload read(const uint8_t*& cursor) {
+    static_assert(std::is_trivially_copyable<Payload>::value, "полезная нагрузка команды должна копироваться побайтно");
+    Payload payload;
+    std::memcpy(&payload, cursor, sizeof(Payload));
+    cursor += sizeof(Payload);
+    return payload;
+}
+
+Rect inflate(const Rect& rect, float amount) {
+    return Rect(rect.position - Vector2f(amount, amount), rect.size + Vector2f(amount * 2.0f, amount * 2.0f));
+}
+
+Rect circleBounds(const Vector2f& center, float radius) {
+    return Rect(center - Vector2f(radius, radius), Vector2f(radius * 2.0f, radius * 2.0f));
+}
+
+Rect pointBounds(const Vector2f* points, size_t count) {
+    Vector2f minPoint = points[0], maxPoint = points[0];
+    for (size_t i = 1; i < count; ++i) {
+        minPoint = Vector2f(std::min(minPoint.x, points[i].x), std::min(minPoint.y, points[i].y));
+        maxPoint = Vector2f(std::max(maxPoint.x, points[i].x), std::max(maxPoint.y, points[i].y));
+    }
+    return Rect(minPoint, maxPoint - minPoint);
+}
+
+} // namespace
+
+CommandBuffer::CommandBuffer(Renderer* measure) : measure_(measure) {}
+
+void CommandBuffer::write(Opcode op) {
+    const size_t offset = data_.size();
+    data_.resize(offset + sizeof(Opcode));
+    std::memcpy(data_.data() + offset, &op, sizeof(Opcode));
+    ++commandCount_;
+
+    switch (op) {
+        case Opcode::PushClipRect:
+            recordClipPush();
+            break;
+        case Opcode::PopClipRect:
+            break;
+        case Opcode::PushTransform:
+        case Opcode::PopTransform:
+        case Opcode::PushMatrix:
+        case Opcode::SetBlendMode:
+        case Opcode::SetAntialiasing:
+        case Opcode::SetViewport:
+            recordStateChange();
+            break;
+        default:
+            recordDrawCall();
+            recordPrimitives(1);
+            break;
+    }
+}
+
+template<typename Payload>
+void CommandBuffer::write(Opcode op, const Payload& payload) {
+    static_assert(std::is_trivially_copyable<Payload>::value, "полезная нагрузка команды должна копироваться побайтно");
+    static_assert(sizeof(Payload) % 4 == 0, "размер полезной нагрузки должен быть кратен 4 байтам");
+    write(op);
+    const size_t offset = data_.size();
+    data_.resize(offset + sizeof(Payload));
+    std::memcpy(data_.data() + offset, &payload, sizeof(Payload));
+}
+
+uint32_t CommandBuffer::intern(const std::string& value) {
+    auto it = stringIndex_.find(value);
+    if (it != stringIndex_.end())
+        return it->second;
+
+    const uint32_t index = static_cast<uint32_t>(strings_.size());
+    strings_.push_back(value);
+    stringIndex_.emplace(value, index);
+    return index;
+}
+
+void CommandBuffer::reset() {
+    data_.clear();
+    strings_.clear();
+    stringIndex_.clear();
+    paths_.clear();
+    commandCount_ = 0;
+    hasImageHandles_ = false;
+    clips_.reset();
+    resetCullStats();
+}
+
+bool CommandBuffer::rejects(const Rect& bounds) {
+    if (clips_.test(bounds) != ClipTest::Outside)
+        return false;
+    ++cullStats_.culledDraws;
+    return true;
+}
+
+void CommandBuffer::clear(const Color& color) {
+    write(Opcode::Clear, ColorPayload{color});
+}
+
+// Границы обводок расширяются на толщину: бэкенды по-разному располагают
+// линию относительно контура
+void CommandBuffer::drawRect(const Rect& rect, const Color& color, float thickness) {
+    if (rejects(inflate(rect, thickness)))
+        return;
+    write(Opcode::DrawRect, RectPayload{rect, color, thickness});
+}
+
+void CommandBuffer::fillRect(const Rect& rect, const Color& color) {
+    if (rejects(rect))
+        return;
+    write(Opcode::FillRect, RectPayload{rect, color, 0.0f});
+}
+
+void CommandBuffer::drawCircle(const Vector2f& center, float radius, const Color& color, float thickness) {
+    if (rejects(circleBounds(center, radius + thickness)))
+        return;
+    write(Opcode::DrawCircle, CirclePayload{center, radius, color, thickness});
+}
+
+void CommandBuffer::fillCircle(const Vector2f& center, float radius, const Color& color) {
+    if (rejects(circleBounds(center, radius)))
+        return;
+    write(Opcode::FillCircle, CirclePayload{center, radius, color, 0.0f});
+}
+
+void CommandBuffer::drawLine(const Vector2f& start, const Vector2f& end, const Color& color, float thickness) {
+    const Vector2f points[2] = {start, end};
+    if (rejects(inflate(pointBounds(points, 2), thickness)))
+        return;
+    write(Opcode::DrawLine, LinePayload{start, end, color, thickness});
+}
+
+void CommandBuffer::drawTriangle(const Vector2f& p1, const Vector2f& p2, const Vector2f& p3,
+                                 const Color& color, float thickness) {
+    const Vector2f points[3] = {p1, p2, p3};
+    if (rejects(inflate(pointBounds(points, 3), thickness)))
+        return;
+    write(Opcode::DrawTriangle, TrianglePayload{p1, p2, p3, color, thickness});
+}
+
+void CommandBuffer::fillTriangle(const Vector2f& p1, const Vector2f& p2, const Vector2f& p3, const Color& color) {
+    const Vector2f points[3] = {p1, p2, p3};
+    if (rejects(pointBounds(points, 3)))
+        return;
+    write(Opcode::FillTriangle, TrianglePayload{p1, p2, p3, color, 0.0f});
+}
+
+void CommandBuffer::fillRoundedRect(const Rect& rect, float radius, const Color& color) {
+    if (rejects(rect))
+        return;
+    write(Opcode::FillRoundedRect, RoundedRectPayload{rect, radius, color, 0.0f});
+}
+
+void CommandBuffer::drawRoundedRect(const Rect& rect, float radius, const Color& color, float thickness) {
+    if (rejects(rect))
+        return;
+    write(Opcode::DrawRoundedRect, RoundedRectPayload{rect, radius, color, thickness});
+}
+
+void CommandBuffer::drawShape(const Rect& rect, const ShapeStyle& style) {
+    if (rejects(shapeBounds(rect, style)))
+        return;
+    write(Opcode::DrawShape, ShapePayload{rect, style});
+}
+
+void CommandBuffer::fillPath(const Path& path, const Color& color, FillRule rule) {
+    if (path.isEmpty() || rejects(path.getBounds()))
+        return;
+    paths_.push_back(path);
+    write(Opcode::FillPath, FillPathPayload{static_cast<uint32_t>(paths_.size() - 1), color, rule});
+}
+
+void CommandBuffer::strokePath(const Path& path, const Color& color, const StrokeStyle& stroke) {
+    if (path.isEmpty() || rejects(strokeBounds(path.getBounds(), stroke)))
+        return;
+    paths_.push_back(path);
+    write(Opcode::StrokePath, StrokePathPayload{static_cast<uint32_t>(paths_.size() - 1), color, stroke});
+}
+
+// Текст отбрасывается, только если есть рендерер для измерения
+void CommandBuffer::drawText(const std::string& text, const Vector2f& position,
+                             const std::string& font, float size, const Color& color) {
+    if (measure_ && rejects(inflate(Rect(position, measure_->getTextSize(text, font, size)), size * 0.5f)))
+        return;
+    write(Opcode::DrawText, TextPayload{intern(text), intern(font), position, size, color});
+}
+
+void CommandBuffer::drawImage(const std::string& imagePath, const Rect& destRect, const Color& tint) {
+    if (rejects(destRect))
+        return;
+    write(Opcode::DrawImage, ImagePayload{intern(imagePath), destRect, tint});
+}
+
+ImageHandle CommandBuffer::resolveImage(const std::string& imagePath) {
+    return measure_ ? measure_->resolveImage(imagePath) : ImageHandle();
+}
+
+ImageHandle CommandBuffer::resolveImageRegion(ImageHandle image, const Rect& sourceRect) {
+    return measure_ ? measure_->resolveImageRegion(image, sourceRect) : ImageHandle();
+}
+
+ImageHandle CommandBuffer::createImage(const std::string& name, const utils::Image& image) {
+    return measure_ ? measure_->createImage(name, image) : ImageHandle();
+}
+
+ImageHandle CommandBuffer::updateImage(ImageHandle image, const utils::Image& pixels) {
+    return measure_ ? measure_->updateImage(image, pixels) : ImageHandle();
+}
+
+void CommandBuffer::releaseImage(ImageHandle image) {
+    if (measure_)
+        measure_->releaseImage(image);
+}
+
+void CommandBuffer::drawImage(ImageHandle image, const Rect& destRect, const Color& tint) {
+    if (!image || rejects(destRect))
+        return;
+    hasImageHandles_ = true;
+    write(Opcode::DrawImageHandle, ImageHandlePayload{image.index, destRect, tint});
+}
+
+void CommandBuffer::drawNineSlice(ImageHandle image, const Rect& destRect, const NineSlice& slice,
+                                  const Color& tint) {
+    if (!image || rejects(destRect))
+        return;
+    hasImageHandles_ = true;
+    write(Opcode::DrawNineSlice, NineSlicePayload{image.index, destRect, slice, tint});
+}
+
+void CommandBuffer::pushClipRect(const Rect& rect) {
+    clips_.pushClip(rect);
+    write(Opcode::PushClipRect, ClipPayload{rect});
+}
+
+void CommandBuffer::popClipRect() {
+    clips_.popClip();
+    write(Opcode::PopClipRect);
+}
+
+void CommandBuffer::pushTransform(const Transform& transform) {
+    clips_.pushTransform(transform);
+    write(Opcode::PushTransform, TransformPayload{transform});
+}
+
+void CommandBuffer::pushTransform(const Affine& matrix) {
+    clips_.pushTransform(matrix);
+    write(Opcode::PushMatrix, MatrixPayload{matrix});
+}
+
+void CommandBuffer::popTransform() {
+    clips_.popTransform();
+    write(Opcode::PopTransform);
+}
+
+void CommandBuffer::setBlendMode(BlendMode mode) {
+    write(Opcode::SetBlendMode, ValuePayload{static_cast<uint32_t>(mode)});
+}
+
+void CommandBuffer::setAntialiasing(bool enabled) {
+    write(Opcode::SetAntialiasing, ValuePayload{enabled ? 1u : 0u});
+}
+
+// Смена вьюпорта сбрасывает стеки цели, а её размеры здесь не известны
+void CommandBuffer::setViewport(const Rect& viewport) {
+    clips_.reset();
+    write(Opcode::SetViewport, ClipPayload{viewport});
+}
+
+Vector2f CommandBuffer::getTextSize(const std::string& text, const std::string& font, float size) {
+    return measure_ ? measure_->getTextSize(text, font, size) : Vector2f();
+}
+
+Vector2f CommandBuffer::getImageSize(const std::string& imagePath) {
+    return measure_ ? measure_->getImageSize(imagePath) : Vector2f();
+}
+
+Vector2f CommandBuffer::getImageSize(ImageHandle image) {
+    return measure_ ? measure_->getImageSize(image) : Vector2f();
+}
+
+void CommandBuffer::replay(Renderer& target, size_t beginOffset, size_t endOffset) const {
+    endOffset = std::min(endOffset, data_.size());
+    if (beginOffset >= endOffset)
+        return;
+
+    const uint8_t* cursor = data_.data() + beginOffset;
+    const uint8_t* end = data_.data() + endOffset;
+
+    while (cursor < end) {
+        const Opcode op = read<Opcode>(cursor);
+        switch (op) {
+            case Opcode::Clear: {
+                const auto p = read<ColorPayload>(cursor);
+                target.clear(p.color);
+                break;
+            }
+            case Opcode::DrawRect: {
+                const auto p = read<RectPayload>(cursor);
+                target.drawRect(p.rect, p.color, p.thickness);
+                break;
+            }
+            case Opcode::FillRect: {
+                const auto p = read<RectPayload>(cursor);
+                target.fillRect(p.rect, p.color);
+                break;
+            }
+            case Opcode::DrawCircle: {
+                const auto p = read<CirclePayload>(cursor);
+                target.drawCircle(p.center, p.radius, p.color, p.thickness);
+                break;
+            }
+            case Opcode::FillCircle: {
+                const auto p = read<CirclePayload>(cursor);
+                target.fillCircle(p.center, p.radius, p.color);
+                break;
+            }
+            case Opcode::DrawLine: {
+                const auto p = read<LinePayload>(cursor);
+                target.drawLine(p.start, p.end, p.color, p.thickness);
+                break;
+            }
+            case Opcode::DrawTriangle: {
+                const auto p = read<TrianglePayload>(cursor);
+                target.drawTriangle(p.p1, p.p2, p.p3, p.color, p.thickness);
+                break;
+            }
+            case Opcode::FillTriangle: {
+                const auto p = read<TrianglePayload>(cursor);
+                target.fillTriangle(p.p1, p.p2, p.p3, p.color);
+                break;
+            }
+            case Opcode::FillRoundedRect: {
+                const auto p = read<RoundedRectPayload>(cursor);
+                target.fillRoundedRect(p.rect, p.radius, p.color);
+                break;
+            }
+            case Opcode::DrawRoundedRect: {
+                const auto p = read<RoundedRectPayload>(cursor);
+                target.drawRoundedRect(p.rect, p.radius, p.color, p.thickness);
+                break;
+            }
+            case Opcode::DrawShape: {
+                const auto p = read<ShapePayload>(cursor);
+                target.drawShape(p.rect, p.style);
+                break;
+            }
+            case Opcode::FillPath: {
+                const auto p = read<FillPathPayload>(cursor);
+                target.fillPath(paths_[p.path], p.color, p.rule);
+                break;
+            }
+            case Opcode::StrokePath: {
+                const auto p = read<StrokePathPayload>(cursor);
+                target.strokePath(paths_[p.path], p.color, p.stroke);
+                break;
+            }
+            case Opcode::DrawText: {
+                const auto p = read<TextPayload>(cursor);
+                target.drawText(strings_[p.text], p.position, strings_[p.font], p.size, p.color);
+                break;
+            }
+            case Opcode::DrawImage: {
+                const auto p = read<ImagePayload>(cursor);
+                target.drawImage(strings_[p.path], p.destRect, p.tint);
+                break;
+            }
+            case Opcode::DrawImageHandle: {
+                const auto p = read<ImageHandlePayload>(cursor);
+                target.drawImage(ImageHandle{p.image}, p.destRect, p.tint);
+                break;
+            }
+            case Opcode::DrawNineSlice: {
+                const auto p = read<NineSlicePayload>(cursor);
+                target.drawNineSlice(ImageHandle{p.image}, p.destRect, p.slice, p.tint);
+                break;
+            }
+            case Opcode::PushClipRect: {
+                const auto p = read<ClipPayload>(cursor);
+                target.pushClipRect(p.rect);
+                break;
+            }
+            case Opcode::PopClipRect:
+                target.popClipRect();
+                break;
+            case Opcode::PushTransform: {
+                const auto p = read<TransformPayload>(cursor);
+                target.pushTransform(p.transform);
+                break;
+            }
+            case Opcode::PushMatrix: {
+                const auto p = read<MatrixPayload>(cursor);
+                target.pushTransform(p.matrix);
+                break;
+            }
+            case Opcode::PopTransform:
+                target.popTransform();
+                break;
+            case Opcode::SetBlendMode: {
+                const auto p = read<ValuePayload>(cursor);
+                target.setBlendMode(static_cast<BlendMode>(p.value));
+                break;
+            }
+            case Opcode::SetAntialiasing: {
+                const auto p = read<ValuePayload>(cursor);
+                target.setAntialiasing(p.value != 0);
+                break;
+            }
+            case Opcode::SetViewport: {
+                const auto p = read<ClipPayload>(cursor);
+                target.setViewport(p.rect);
+                break;
+            }
+            default:
+                // Повреждённый буфер: дальнейшие смещения недостоверны
+                return;
+        }
+    }
+}
+
+} // namespace gui
\ No newline at end of file
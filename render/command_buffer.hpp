@@ -0,0 +1,148 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../core/renderer.hpp"
+
+namespace gui {
+
+// Записанный список команд рендеринга (display list).
+// Сам реализует Renderer: вызовы примитивов не рисуют, а кодируются в линейный
+// буфер — заголовок с кодом команды и POD-параметры, строки интернируются в таблицу.
+// Буфер самодостаточен, поэтому его можно записать один раз, воспроизводить многократно
+// и передавать на другой поток для отправки в бэкенд.
+// Области отсечения, записанные в буфер, отслеживаются: примитивы целиком
+// за их пределами не записываются. Отсечение цели воспроизведения не известно
+// при записи и учитывается уже ею.
+class CommandBuffer : public Renderer {
+public:
+    enum class Opcode : uint32_t {
+        Clear,
+        DrawRect,
+        FillRect,
+        DrawCircle,
+        FillCircle,
+        DrawLine,
+        DrawTriangle,
+        FillTriangle,
+        DrawText,
+        DrawImage,
+        PushClipRect,
+        PopClipRect,
+        PushTransform,
+        PopTransform,
+        SetBlendMode,
+        SetAntialiasing,
+        SetViewport,
+        PushMatrix,
+        DrawImageHandle,
+        FillRoundedRect,
+        DrawRoundedRect,
+        DrawShape,
+        DrawNineSlice,
+        FillPath,
+        StrokePath
+    };
+
+    // measure — рендерер для getTextSize/getImageSize во время записи (может быть nullptr)
+    explicit CommandBuffer(Renderer* measure = nullptr);
+
+    // Инициализация и очистка
+    bool initialize() override { return true; }
+    void shutdown() override { reset(); }
+
+    // beginFrame() начинает запись заново, endFrame() ничего не записывает:
+    // рамку кадра задаёт тот, кто воспроизводит буфер. Статистика рендеринга
+    // считает записанные команды.
+    void beginFrame() override { reset(); beginRenderStats(); }
+    void endFrame() override { endRenderStats(); }
+    void clear(const Color& color) override;
+
+    // Примитивы рендеринга
+    void drawRect(const Rect& rect, const Color& color, float thickness = 1.0f) override;
+    void fillRect(const Rect& rect, const Color& color) override;
+    void drawCircle(const Vector2f& center, float radius, const Color& color, float thickness = 1.0f) override;
+    void fillCircle(const Vector2f& center, float radius, const Color& color) override;
+    void drawLine(const Vector2f& start, const Vector2f& end, const Color& color, float thickness = 1.0f) override;
+    void drawTriangle(const Vector2f& p1, const Vector2f& p2, const Vector2f& p3,
+                      const Color& color, float thickness = 1.0f) override;
+    void fillTriangle(const Vector2f& p1, const Vector2f& p2, const Vector2f& p3, const Color& color) override;
+    void fillRoundedRect(const Rect& rect, float radius, const Color& color) override;
+    void drawRoundedRect(const Rect& rect, float radius, const Color& color, float thickness = 1.0f) override;
+    void drawShape(const Rect& rect, const ShapeStyle& style) override;
+    // Путь копируется в буфер вместе с хэшем, и воспроизведение попадает в кэш геометрии
+    void fillPath(const Path& path, const Color& color, FillRule rule = FillRule::NonZero) override;
+    void strokePath(const Path& path, const Color& color, const StrokeStyle& stroke = StrokeStyle()) override;
+
+    // Текст и изображения
+    void drawText(const std::string& text, const Vector2f& position,
+                  const std::string& font, float size, const Color& color) override;
+    void drawImage(const std::string& imagePath, const Rect& destRect,
+                   const Color& tint = Color::white()) override;
+
+    // Дескрипторы разрешает рендерер измерения: записанный по ним буфер
+    // воспроизводится в него или в обёртку над ним
+    ImageHandle resolveImage(const std::string& imagePath) override;
+    ImageHandle resolveImageRegion(ImageHandle image, const Rect& sourceRect) override;
+    ImageHandle createImage(const std::string& name, const utils::Image& image) override;
+    ImageHandle updateImage(ImageHandle image, const utils::Image& pixels) override;
+    void releaseImage(ImageHandle image) override;
+    Renderer& getImageOwner() override { return measure_ ? measure_->getImageOwner() : *this; }
+    void drawImage(ImageHandle image, const Rect& destRect, const Color& tint = Color::white()) override;
+    void drawNineSlice(ImageHandle image, const Rect& destRect, const NineSlice& slice,
+                       const Color& tint = Color::white()) override;
+
+    // Продвинутые функции рендеринга
+    void pushClipRect(const Rect& rect) override;
+    void popClipRect() override;
+    void pushTransform(const Transform& transform) override;
+    void pushTransform(const Affine& matrix) override;
+    void popTransform() override;
+
+    // Управление состоянием
+    void setBlendMode(BlendMode mode) override;
+    void setAntialiasing(bool enabled) override;
+    void setViewport(const Rect& viewport) override;
+
+    // Вспомогательные функции
+    Vector2f getTextSize(const std::string& text, const std::string& font, float size) override;
+    Vector2f getImageSize(const std::string& imagePath) override;
+    Vector2f getImageSize(ImageHandle image) override;
+    ClipTest testClip(const Rect& bounds) const override { return clips_.test(bounds); }
+    float getDeviceScale() const override { return clips_.getMatrix().scaleFactor(); }
+    bool isMeasureThreadSafe() const override { return measure_ && measure_->isMeasureThreadSafe(); }
+
+    // Воспроизведение записанных команд в любой бэкенд
+    void replay(Renderer& target) const { replay(target, 0, data_.size()); }
+    // Воспроизведение части буфера; смещения берутся из getByteSize() во время записи
+    void replay(Renderer& target, size_t beginOffset, size_t endOffset) const;
+
+    void reset();
+    void setMeasureRenderer(Renderer* measure) { measure_ = measure; }
+
+    bool empty() const { return commandCount_ == 0; }
+    size_t getCommandCount() const { return commandCount_; }
+    // Буфер с дескрипторами воспроизводится только в рендерер, который их выдал
+    bool hasImageHandles() const { return hasImageHandles_; }
+    size_t getByteSize() const { return data_.size(); }
+    size_t getStringCount() const { return strings_.size(); }
+
+private:
+    template<typename Payload>
+    void write(Opcode op, const Payload& payload);
+    void write(Opcode op);
+    uint32_t intern(const std::string& value);
+    bool rejects(const Rect& bounds);
+
+    Renderer* measure_;
+    std::vector<uint8_t> data_;
+    std::vector<std::string> strings_;
+    std::unordered_map<std::string, uint32_t> stringIndex_;
+    std::vector<Path> paths_;
+    size_t commandCount_ = 0;
+    bool hasImageHandles_ = false;
+    ClipStack clips_;
+};
+
+} // namespace gui
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "damage_tracker.hpp"
+#include <algorithm>
+
+namespace gui {
+
+DamageTracker::DamageTracker(size_t maxRegions)
+    : maxRegions_(maxRegions > 0 ? maxRegions : 1) {}
+
+void DamageTracker::setBounds(const Rect& bounds) {
+    bounds_ = bounds;
+    addAll();
+}
+
+void DamageTracker::add(const Rect& rect) {
+    if (full_)
+        return;
+
+    const Rect area = bounds_.isEmpty() ? rect : rect.intersected(bounds_);
+    if (area.isEmpty())
+        return;
+
+    for (const Rect& region : regions_) {
+        if (region.contains(area))
+            return;
+    }
+    regions_.erase(std::remove_if(regions_.begin(), regions_.end(),
+                                  [&area](const Rect& region) { return area.contains(region); }),
+                   regions_.end());
+    regions_.push_back(area);
+
+    mergeOverlapping();
+    reduceToLimit();
+
+    if (!bounds_.isEmpty() && getDamagedArea() >= bounds_.area() * fullThreshold_)
+        addAll();
+}
+
+void DamageTracker::addAll() {
+    full_ = true;
+    regions_.assign(1, bounds_);
+}
+
+void DamageTracker::clear() {
+    full_ = false;
+    regions_.clear();
+}
+
+float DamageTracker::getDamagedArea() const {
+    float total = 0.0f;
+    for (const Rect& region : regions_) {
+        total += region.area();
+    }
+    return total;
+}
+
+// Пересекающиеся области сливаются, если объединение не добавляет лишней площади
+void DamageTracker::mergeOverlapping() {
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < regions_.size() && !merged; ++i) {
+            for (size_t j = i + 1; j < regions_.size(); ++j) {
+                if (!regions_[i].intersects(regions_[j]))
+                    continue;
+
+                const Rect united = regions_[i].united(regions_[j]);
+                if (united.area() <= regions_[i].area() + regions_[j].area()) {
+                    regions_[i] = united;
+                    regions_.erase(regions_.begin() + j);
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// Сверх лимита сливается пара, объединение которой добавляет меньше всего площади
+void DamageTracker::reduceToLimit() {
+    while (regions_.size() > maxRegions_) {
+        size_t bestI = 0, bestJ = 1;
+        float bestCost = -1.0f;
+        for (size_t i = 0; i < regions_.size(); ++i) {
+            for (size_t j = i + 1; j < regions_.size(); ++j) {
+                const float cost = regions_[i].united(regions_[j]).area() -
+                                   regions_[i].area() - regions_[j].area();
+                if (bestCost < 0.0f || cost < bestCost) {
+                    bestCost = cost;
+                    bestI = i;
+                    bestJ = j;
+                }
+            }
+        }
+        regions_[bestI] = regions_[bestI].united(regions_[bestJ]);
+        regions_.erase(regions_.begin() + bestJ);
+        mergeOverlapping();
+    }
+}
+
+} // namespace gui
\ No newline at end of file
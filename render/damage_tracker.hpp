@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "../core/math_types.hpp"
+
+namespace gui {
+
+// Накопитель повреждённых областей кадра.
+// Виджеты сообщают прямоугольники, которые нужно перерисовать; трекер объединяет
+// их в небольшой набор прямоугольников отсечения. Когда области занимают
+// большую часть окна, кадр помечается как полностью повреждённый.
+class DamageTracker {
+public:
+    explicit DamageTracker(size_t maxRegions = 8);
+
+    // Область окна: всё, что за её пределами, отбрасывается
+    void setBounds(const Rect& bounds);
+    const Rect& getBounds() const { return bounds_; }
+
+    void add(const Rect& rect);
+    void addAll();
+    void clear();
+
+    bool empty() const { return !full_ && regions_.empty(); }
+    bool isFull() const { return full_; }
+
+    // При isFull() возвращает одну область, равную границам окна
+    const std::vector<Rect>& getRegions() const { return regions_; }
+    float getDamagedArea() const;
+
+    void setMaxRegions(size_t count) { maxRegions_ = count > 0 ? count : 1; }
+    size_t getMaxRegions() const { return maxRegions_; }
+
+    // Доля площади окна, после которой выгоднее перерисовать всё
+    void setFullThreshold(float fraction) { fullThreshold_ = fraction; }
+
+private:
+    void mergeOverlapping();
+    void reduceToLimit();
+
+    std::vector<Rect> regions_;
+    Rect bounds_;
+    size_t maxRegions_;
+    float fullThreshold_ = 0.7f;
+    bool full_ = false;
+};
+
+} // namespace gui
\ No newline at end of file
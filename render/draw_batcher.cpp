@@ -0,0 +1,581 @@
+#include "draw_batcher.hpp"
+#include <algorithm>
+
+namespace gui {
+
+namespace {
+
+Rect unite(const Rect& a, const Rect& b) {
+    const float x0 = std::min(a.position.x, b.position.x);
+    const float y0 = std::min(a.position.y, b.position.y);
+    const float x1 = std::max(a.position.x + a.size.x, b.position.x + b.size.x);
+    const float y1 = std::max(a.position.y + a.size.y, b.position.y + b.size.y);
+    return Rect(Vector2f(x0, y0), Vector2f(x1 - x0, y1 - y0));
+}
+
+bool sameRect(const Rect& a, const Rect& b) {
+    return a.position.x == b.position.x && a.position.y == b.position.y &&
+           a.size.x == b.size.x && a.size.y == b.size.y;
+}
+
+Rect pointBounds(const Vector2f* points, size_t count, float margin) {
+    float x0 = points[0].x, y0 = points[0].y, x1 = points[0].x, y1 = points[0].y;
+    for (size_t i = 1; i < count; ++i) {
+        x0 = std::min(x0, points[i].x);
+        y0 = std::min(y0, points[i].y);
+        x1 = std::max(x1, points[i].x);
+        y1 = std::max(y1, points[i].y);
+    }
+    return Rect(Vector2f(x0 - margin, y0 - margin),
+                Vector2f(x1 - x0 + margin * 2.0f, y1 - y0 + margin * 2.0f));
+}
+
+// Сглаживание краёв может задеть соседний пиксель
+constexpr float kBoundsMargin = 1.0f;
+
+// Ключ текстуры пакета для изображений по дескриптору
+constexpr uint32_t kImageHandleBit = 0x80000000u;
+
+Rect inflate(const Rect& rect, float margin) {
+    return Rect(rect.position - Vector2f(margin, margin),
+                rect.size + Vector2f(margin * 2.0f, margin * 2.0f));
+}
+
+} // namespace
+
+DrawBatcher::DrawBatcher(Renderer& target)
+    : target_(target), deferred_(&target) {
+    clipStates_.emplace_back();
+}
+
+void DrawBatcher::beginFrame() {
+    beginRenderStats();
+    target_.beginFrame();
+
+    batches_.clear();
+    items_.clear();
+    meshPoints_.clear();
+    deferred_.reset();
+    textures_.clear();
+    textureIndex_.clear();
+    logicalClips_.clear();
+    targetClips_.clear();
+    clipStates_.assign(1, {});
+    currentClipState_ = 0;
+    segmentClipDepth_ = 0;
+    blendMode_ = targetBlendMode_ = BlendMode::Alpha;
+    clipTracker_.reset();
+    resetCullStats();
+    frameStats_ = Stats();
+}
+
+void DrawBatcher::endFrame() {
+    flush();
+    syncClip({});
+    target_.endFrame();
+    lastFrameStats_ = frameStats_;
+    endRenderStats();
+}
+
+uint32_t DrawBatcher::internClipState() {
+    for (uint32_t i = 0; i < clipStates_.size(); ++i) {
+        const auto& state = clipStates_[i];
+        if (state.size() == logicalClips_.size() &&
+            std::equal(state.begin(), state.end(), logicalClips_.begin(), sameRect))
+            return i;
+    }
+    clipStates_.push_back(logicalClips_);
+    return static_cast<uint32_t>(clipStates_.size() - 1);
+}
+
+uint32_t DrawBatcher::internTexture(const std::string& path) {
+    auto it = textureIndex_.find(path);
+    if (it != textureIndex_.end())
+        return it->second;
+
+    textures_.push_back(path);
+    const uint32_t id = static_cast<uint32_t>(textures_.size());
+    textureIndex_.emplace(path, id);
+    return id;
+}
+
+void DrawBatcher::addItem(Item& item, uint32_t texture, const Rect& bounds) {
+    ++frameStats_.rawCalls;
+    recordDrawCall();
+    switch (item.kind) {
+        case ItemKind::Rect:
+        case ItemKind::Image:    recordPrimitives(2); break;
+        case ItemKind::Triangle: recordPrimitives(1); break;
+        case ItemKind::Mesh:     recordPrimitives(item.meshCount / 3); break;
+    }
+
+    // Ищем назад пакет с тем же состоянием, не перепрыгивая через пересекающиеся
+    const size_t last = batches_.size();
+    for (size_t i = last, steps = 0; i > 0 && steps < reorderWindow_; --i, ++steps) {
+        Batch& candidate = batches_[i - 1];
+        if (candidate.geometry && candidate.blend == blendMode_ &&
+            candidate.clipState == currentClipState_ && candidate.texture == texture) {
+            item.batch = static_cast<uint32_t>(i - 1);
+            candidate.bounds = unite(candidate.bounds, bounds);
+            ++candidate.itemCount;
+            items_.push_back(item);
+            if (i != last)
+                ++frameStats_.reorderedCalls;
+            return;
+        }
+        if (candidate.bounds.intersects(bounds))
+            break;
+    }
+
+    Batch batch;
+    batch.blend = blendMode_;
+    batch.clipState = currentClipState_;
+    batch.texture = texture;
+    batch.bounds = bounds;
+    batch.itemCount = 1;
+    item.batch = static_cast<uint32_t>(batches_.size());
+    batches_.push_back(batch);
+    items_.push_back(item);
+}
+
+void DrawBatcher::addDeferred(size_t begin, const Rect& bounds) {
+    ++frameStats_.rawCalls;
+    recordDrawCall();
+    recordPrimitives(1);
+
+    Batch batch;
+    batch.geometry = false;
+    batch.blend = blendMode_;
+    batch.clipState = currentClipState_;
+    batch.bounds = bounds;
+    batch.deferredBegin = begin;
+    batch.deferredEnd = deferred_.getByteSize();
+    batches_.push_back(batch);
+}
+
+void DrawBatcher::clear(const Color& color) {
+    recordDrawCall();
+    recordPrimitives(1);
+    barrier();
+    target_.clear(color);
+}
+
+void DrawBatcher::fillRect(const Rect& rect, const Color& color) {
+    Item item;
+    item.kind = ItemKind::Rect;
+    item.rect = rect;
+    item.color = color;
+    addItem(item, 0, inflate(rect, kBoundsMargin));
+}
+
+void DrawBatcher::fillTriangle(const Vector2f& p1, const Vector2f& p2, const Vector2f& p3, const Color& color) {
+    Item item;
+    item.kind = ItemKind::Triangle;
+    item.points[0] = p1;
+    item.points[1] = p2;
+    item.points[2] = p3;
+    item.color = color;
+    addItem(item, 0, pointBounds(item.points, 3, kBoundsMargin));
+}
+
+void DrawBatcher::drawImage(const std::string& imagePath, const Rect& destRect, const Color& tint) {
+    Item item;
+    item.kind = ItemKind::Image;
+    item.rect = destRect;
+    item.color = tint;
+    addItem(item, internTexture(imagePath), inflate(destRect, kBoundsMargin));
+}
+
+void DrawBatcher::drawImage(ImageHandle image, const Rect& destRect, const Color& tint) {
+    if (!image)
+        return;
+    Item item;
+    item.kind = ItemKind::Image;
+    item.rect = destRect;
+    item.color = tint;
+    addItem(item, kImageHandleBit | image.index, inflate(destRect, kBoundsMargin));
+}
+
+// Бэкенд выводит девять частей одной командой, пакет из них не собирается
+void DrawBatcher::drawNineSlice(ImageHandle image, const Rect& destRect, const NineSlice& slice,
+                                const Color& tint) {
+    const size_t begin = deferred_.getByteSize();
+    deferred_.drawNineSlice(image, destRect, slice, tint);
+    addDeferred(begin, inflate(destRect, kBoundsMargin));
+}
+
+ImageHandle DrawBatcher::resolveImage(const std::string& imagePath) {
+    return target_.resolveImage(imagePath);
+}
+
+ImageHandle DrawBatcher::resolveImageRegion(ImageHandle image, const Rect& sourceRect) {
+    return target_.resolveImageRegion(image, sourceRect);
+}
+
+ImageHandle DrawBatcher::createImage(const std::string& name, const utils::Image& image) {
+    return target_.createImage(name, image);
+}
+
+// Отложенные команды разрешают дескриптор при сбросе, поэтому они уходят в цель
+// до замены пикселей
+ImageHandle DrawBatcher::updateImage(ImageHandle image, const utils::Image& pixels) {
+    flush();
+    return target_.updateImage(image, pixels);
+}
+
+void DrawBatcher::releaseImage(ImageHandle image) {
+    flush();
+    target_.releaseImage(image);
+}
+
+void DrawBatcher::drawRect(const Rect& rect, const Color& color, float thickness) {
+    const size_t begin = deferred_.getByteSize();
+    deferred_.drawRect(rect, color, thickness);
+    addDeferred(begin, inflate(rect, thickness + kBoundsMargin));
+}
+
+void DrawBatcher::addMesh(size_t begin, const Color& color, const Rect& bounds) {
+    if (meshPoints_.size() == begin)
+        return;
+    Item item;
+    item.kind = ItemKind::Mesh;
+    item.color = color;
+    item.meshBegin = static_cast<uint32_t>(begin);
+    item.meshCount = static_cast<uint32_t>(meshPoints_.size() - begin);
+    addItem(item, 0, bounds);
+}
+
+void DrawBatcher::fillRoundedRect(const Rect& rect, float radius, const Color& color) {
+    if (!target_.supportsTriangleBatches()) {
+        const size_t begin = deferred_.getByteSize();
+        deferred_.fillRoundedRect(rect, radius, color);
+        addDeferred(begin, inflate(rect, kBoundsMargin));
+        return;
+    }
+    const size_t begin = meshPoints_.size();
+    tessellation_.appendRoundedRect(meshPoints_, rect, radius);
+    addMesh(begin, color, inflate(rect, kBoundsMargin));
+}
+
+void DrawBatcher::drawRoundedRect(const Rect& rect, float radius, const Color& color, float thickness) {
+    if (!target_.supportsTriangleBatches()) {
+        const size_t begin = deferred_.getByteSize();
+        deferred_.drawRoundedRect(rect, radius, color, thickness);
+        addDeferred(begin, inflate(rect, kBoundsMargin));
+        return;
+    }
+    if (thickness <= 0.0f)
+        return;
+    const size_t begin = meshPoints_.size();
+    tessellation_.appendRoundedRect(meshPoints_, rect, radius, thickness);
+    addMesh(begin, color, inflate(rect, kBoundsMargin));
+}
+
+void DrawBatcher::fillPath(const Path& path, const Color& color, FillRule rule) {
+    if (!target_.supportsTriangleBatches()) {
+        const size_t begin = deferred_.getByteSize();
+        deferred_.fillPath(path, color, rule);
+        addDeferred(begin, inflate(path.getBounds(), kBoundsMargin));
+        return;
+    }
+    const PathCache::Geometry& geometry = paths_.getFill(path, rule, getDeviceScale(), true);
+    const size_t begin = meshPoints_.size();
+    meshPoints_.insert(meshPoints_.end(), geometry.triangles.begin(), geometry.triangles.end());
+    addMesh(begin, color, inflate(geometry.bounds, kBoundsMargin));
+}
+
+void DrawBatcher::strokePath(const Path& path, const Color& color, const StrokeStyle& stroke) {
+    if (!target_.supportsTriangleBatches()) {
+        const size_t begin = deferred_.getByteSize();
+        deferred_.strokePath(path, color, stroke);
+        addDeferred(begin, inflate(strokeBounds(path.getBounds(), stroke), kBoundsMargin));
+        return;
+    }
+    const PathCache::Geometry& geometry = paths_.getStroke(path, stroke, getDeviceScale(), true);
+    const size_t begin = meshPoints_.size();
+    meshPoints_.insert(meshPoints_.end(), geometry.triangles.begin(), geometry.triangles.end());
+    addMesh(begin, color, inflate(geometry.bounds, kBoundsMargin));
+}
+
+void DrawBatcher::drawShape(const Rect& rect, const ShapeStyle& style) {
+    const size_t begin = deferred_.getByteSize();
+    deferred_.drawShape(rect, style);
+    addDeferred(begin, inflate(shapeBounds(rect, style), kBoundsMargin));
+}
+
+void DrawBatcher::drawCircle(const Vector2f& center, float radius, const Color& color, float thickness) {
+    const float extent = radius + thickness + kBoundsMargin;
+    const Rect bounds(center - Vector2f(extent, extent), Vector2f(extent * 2.0f, extent * 2.0f));
+    if (target_.supportsTriangleBatches()) {
+        if (thickness <= 0.0f)
+            return;
+        const size_t begin = meshPoints_.size();
+        tessellation_.appendCircle(meshPoints_, center, radius, thickness);
+        addMesh(begin, color, bounds);
+        return;
+    }
+
+    const size_t begin = deferred_.getByteSize();
+    deferred_.drawCircle(center, radius, color, thickness);
+    addDeferred(begin, bounds);
+}
+
+void DrawBatcher::fillCircle(const Vector2f& center, float radius, const Color& color) {
+    const float extent = radius + kBoundsMargin;
+    const Rect bounds(center - Vector2f(extent, extent), Vector2f(extent * 2.0f, extent * 2.0f));
+    if (target_.supportsTriangleBatches()) {
+        const size_t begin = meshPoints_.size();
+        tessellation_.appendCircle(meshPoints_, center, radius);
+        addMesh(begin, color, bounds);
+        return;
+    }
+
+    const size_t begin = deferred_.getByteSize();
+    deferred_.fillCircle(center, radius, color);
+    addDeferred(begin, bounds);
+}
+
+void DrawBatcher::drawLine(const Vector2f& start, const Vector2f& end, const Color& color, float thickness) {
+    const size_t begin = deferred_.getByteSize();
+    deferred_.drawLine(start, end, color, thickness);
+    const Vector2f points[2] = {start, end};
+    addDeferred(begin, pointBounds(points, 2, thickness + kBoundsMargin));
+}
+
+void DrawBatcher::drawTriangle(const Vector2f& p1, const Vector2f& p2, const Vector2f& p3,
+                               const Color& color, float thickness) {
+    const size_t begin = deferred_.getByteSize();
+    deferred_.drawTriangle(p1, p2, p3, color, thickness);
+    const Vector2f points[3] = {p1, p2, p3};
+    addDeferred(begin, pointBounds(points, 3, thickness + kBoundsMargin));
+}
+
+void DrawBatcher::drawText(const std::string& text, const Vector2f& position,
+                           const std::string& font, float size, const Color& color) {
+    const size_t begin = deferred_.getByteSize();
+    deferred_.drawText(text, position, font, size, color);
+    // Запас на выносные элементы и курсив, которые метрика может не учитывать
+    const Vector2f extent = target_.getTextSize(text, font, size);
+    addDeferred(begin, inflate(Rect(position, extent), size * 0.5f + kBoundsMargin));
+}
+
+void DrawBatcher::pushClipRect(const Rect& rect) {
+    recordClipPush();
+    clipTracker_.pushClip(rect);
+    logicalClips_.push_back(rect);
+    currentClipState_ = internClipState();
+}
+
+void DrawBatcher::popClipRect() {
+    if (logicalClips_.empty())
+        return;
+    clipTracker_.popClip();
+
+    // Область, заданная до начала сегмента, могла быть в другой системе координат,
+    // поэтому её снятие сразу отражается в бэкенде
+    if (logicalClips_.size() <= segmentClipDepth_) {
+        flush();
+        logicalClips_.pop_back();
+        syncClip(logicalClips_);
+        segmentClipDepth_ = logicalClips_.size();
+    } else {
+        logicalClips_.pop_back();
+    }
+    currentClipState_ = internClipState();
+}
+
+void DrawBatcher::pushTransform(const Transform& transform) {
+    recordStateChange();
+    barrier();
+    clipTracker_.pushTransform(transform);
+    target_.pushTransform(transform);
+}
+
+void DrawBatcher::pushTransform(const Affine& matrix) {
+    recordStateChange();
+    barrier();
+    clipTracker_.pushTransform(matrix);
+    target_.pushTransform(matrix);
+}
+
+void DrawBatcher::popTransform() {
+    recordStateChange();
+    barrier();
+    clipTracker_.popTransform();
+    target_.popTransform();
+}
+
+void DrawBatcher::setBlendMode(BlendMode mode) {
+    if (blendMode_ != mode)
+        recordStateChange();
+    blendMode_ = mode;
+}
+
+void DrawBatcher::setAntialiasing(bool enabled) {
+    recordStateChange();
+    barrier();
+    target_.setAntialiasing(enabled);
+}
+
+void DrawBatcher::setViewport(const Rect& viewport) {
+    recordStateChange();
+    barrier();
+    clipTracker_.reset();
+    target_.setViewport(viewport);
+}
+
+Vector2f DrawBatcher::getTextSize(const std::string& text, const std::string& font, float size) {
+    return target_.getTextSize(text, font, size);
+}
+
+Vector2f DrawBatcher::getImageSize(const std::string& imagePath) {
+    return target_.getImageSize(imagePath);
+}
+
+Vector2f DrawBatcher::getImageSize(ImageHandle image) {
+    return target_.getImageSize(image);
+}
+
+void DrawBatcher::barrier() {
+    flush();
+    syncClip(logicalClips_);
+    syncBlend(blendMode_);
+}
+
+void DrawBatcher::syncClip(const std::vector<Rect>& stack) {
+    size_t common = 0;
+    const size_t limit = std::min(stack.size(), targetClips_.size());
+    while (common < limit && sameRect(stack[common], targetClips_[common])) {
+        ++common;
+    }
+
+    while (targetClips_.size() > common) {
+        target_.popClipRect();
+        targetClips_.pop_back();
+    }
+    for (size_t i = common; i < stack.size(); ++i) {
+        target_.pushClipRect(stack[i]);
+        targetClips_.push_back(stack[i]);
+    }
+}
+
+void DrawBatcher::syncBlend(BlendMode mode) {
+    if (mode != targetBlendMode_) {
+        target_.setBlendMode(mode);
+        targetBlendMode_ = mode;
+    }
+}
+
+void DrawBatcher::flush() {
+    if (batches_.empty())
+        return;
+
+    // Группируем элементы по пакетам подсчётом, сохраняя порядок внутри пакета
+    std::vector<size_t> offsets(batches_.size() + 1, 0);
+    for (size_t i = 0; i < batches_.size(); ++i) {
+        offsets[i + 1] = batches_[i].itemCount;
+    }
+    for (size_t i = 1; i < offsets.size(); ++i) {
+        offsets[i] += offsets[i - 1];
+    }
+    itemOrder_.resize(items_.size());
+    {
+        std::vector<size_t> cursor(offsets.begin(), offsets.end() - 1);
+        for (uint32_t i = 0; i < items_.size(); ++i) {
+            itemOrder_[cursor[items_[i].batch]++] = i;
+        }
+    }
+
+    for (size_t i = 0; i < batches_.size(); ++i) {
+        const Batch& batch = batches_[i];
+        syncClip(clipStates_[batch.clipState]);
+        syncBlend(batch.blend);
+
+        if (batch.geometry) {
+            emitGeometry(batch, itemOrder_.data() + offsets[i], offsets[i + 1] - offsets[i]);
+        } else {
+            deferred_.replay(target_, batch.deferredBegin, batch.deferredEnd);
+            ++frameStats_.batches;
+            ++frameStats_.submissions;
+        }
+    }
+
+    batches_.clear();
+    items_.clear();
+    meshPoints_.clear();
+    deferred_.reset();
+    clipStates_.assign(1, logicalClips_);
+    currentClipState_ = 0;
+    segmentClipDepth_ = logicalClips_.size();
+}
+
+void DrawBatcher::emitGeometry(const Batch& batch, const uint32_t* items, size_t count) {
+    const bool handle = (batch.texture & kImageHandleBit) != 0;
+    const std::string empty;
+    const std::string& texture = batch.texture && !handle ? textures_[batch.texture - 1] : empty;
+
+    // Пакет треугольников адресует текстуру путём, поэтому дескрипторы
+    // (в том числе регионы атласа) отправляются по одному
+    if (!target_.supportsTriangleBatches() || handle) {
+        // Бэкенд без пакетной отправки получает исходные вызовы в новом порядке
+        for (size_t i = 0; i < count; ++i) {
+            const Item& item = items_[items[i]];
+            switch (item.kind) {
+                case ItemKind::Rect:
+                    target_.fillRect(item.rect, item.color);
+                    break;
+                case ItemKind::Triangle:
+                    target_.fillTriangle(item.points[0], item.points[1], item.points[2], item.color);
+                    break;
+                case ItemKind::Mesh:
+                    for (uint32_t p = item.meshBegin; p + 2 < item.meshBegin + item.meshCount; p += 3) {
+                        target_.fillTriangle(meshPoints_[p], meshPoints_[p + 1], meshPoints_[p + 2], item.color);
+                    }
+                    break;
+                case ItemKind::Image:
+                    if (handle)
+                        target_.drawImage(ImageHandle{batch.texture & ~kImageHandleBit}, item.rect, item.color);
+                    else
+                        target_.drawImage(texture, item.rect, item.color);
+                    break;
+            }
+        }
+        ++frameStats_.batches;
+        frameStats_.submissions += count;
+        return;
+    }
+
+    vertices_.clear();
+    for (size_t i = 0; i < count; ++i) {
+        const Item& item = items_[items[i]];
+        if (item.kind == ItemKind::Mesh) {
+            for (uint32_t p = item.meshBegin; p < item.meshBegin + item.meshCount; ++p) {
+                vertices_.push_back(Vertex{meshPoints_[p], Vector2f(), item.color});
+            }
+            continue;
+        }
+        if (item.kind == ItemKind::Triangle) {
+            for (const Vector2f& point : item.points) {
+                vertices_.push_back(Vertex{point, Vector2f(), item.color});
+            }
+            continue;
+        }
+
+        const Vector2f p0 = item.rect.position;
+        const Vector2f p2 = item.rect.position + item.rect.size;
+        const Vector2f p1(p2.x, p0.y);
+        const Vector2f p3(p0.x, p2.y);
+        vertices_.push_back(Vertex{p0, Vector2f(0.0f, 0.0f), item.color});
+        vertices_.push_back(Vertex{p1, Vector2f(1.0f, 0.0f), item.color});
+        vertices_.push_back(Vertex{p2, Vector2f(1.0f, 1.0f), item.color});
+        vertices_.push_back(Vertex{p0, Vector2f(0.0f, 0.0f), item.color});
+        vertices_.push_back(Vertex{p2, Vector2f(1.0f, 1.0f), item.color});
+        vertices_.push_back(Vertex{p3, Vector2f(0.0f, 1.0f), item.color});
+    }
+
+    target_.drawTriangles(vertices_.data(), vertices_.size(), texture);
+    ++frameStats_.batches;
+    ++frameStats_.submissions;
+}
+
+} // namespace gui
\ No newline at end of file
@@ -0,0 +1,179 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../core/renderer.hpp"
+#include "command_buffer.hpp"
+#include "path_cache.hpp"
+#include "tessellation_cache.hpp"
+
+namespace gui {
+
+// Слой пакетирования перед рендерером.
+// fillRect, fillTriangle и drawImage, совпадающие по режиму наложения, области
+// отсечения и текстуре, сливаются в один поток вершин и уходят в бэкенд одним
+// вызовом drawTriangles(). Вызов может быть перенесён назад к более раннему
+// подходящему пакету, если он не пересекается ни с чем, что нарисовано между ними.
+// Смена трансформации, вьюпорта и clear() завершают текущий сегмент пакетов.
+// Для бэкендов с drawTriangles() круги и скруглённые прямоугольники тоже
+// пакетируются: их сетки берутся из кэша тесселяции и переносятся на место.
+class DrawBatcher : public Renderer {
+public:
+    struct Stats {
+        size_t rawCalls = 0;        // вызовы рисования, пришедшие в слой
+        size_t batches = 0;         // пакеты после слияния и переупорядочивания
+        size_t submissions = 0;     // фактические вызовы бэкенда; без drawTriangles — по вызову на элемент
+        size_t reorderedCalls = 0;  // вызовы, перенесённые к более раннему пакету
+    };
+
+    explicit DrawBatcher(Renderer& target);
+
+    // Инициализация и очистка
+    bool initialize() override { return target_.initialize(); }
+    void shutdown() override { target_.shutdown(); }
+
+    // Основные операции рендеринга
+    void beginFrame() override;
+    void endFrame() override;
+    void clear(const Color& color) override;
+
+    // Пакетируемые примитивы
+    void fillRect(const Rect& rect, const Color& color) override;
+    void fillTriangle(const Vector2f& p1, const Vector2f& p2, const Vector2f& p3, const Color& color) override;
+    void drawImage(const std::string& imagePath, const Rect& destRect,
+                   const Color& tint = Color::white()) override;
+
+    // Дескрипторы принадлежат целевому рендереру
+    ImageHandle resolveImage(const std::string& imagePath) override;
+    ImageHandle resolveImageRegion(ImageHandle image, const Rect& sourceRect) override;
+    ImageHandle createImage(const std::string& name, const utils::Image& image) override;
+    ImageHandle updateImage(ImageHandle image, const utils::Image& pixels) override;
+    void releaseImage(ImageHandle image) override;
+    Renderer& getImageOwner() override { return target_.getImageOwner(); }
+    void drawImage(ImageHandle image, const Rect& destRect, const Color& tint = Color::white()) override;
+    void drawNineSlice(ImageHandle image, const Rect& destRect, const NineSlice& slice,
+                       const Color& tint = Color::white()) override;
+
+    // Пакетируются, только если бэкенд принимает drawTriangles()
+    void drawCircle(const Vector2f& center, float radius, const Color& color, float thickness = 1.0f) override;
+    void fillCircle(const Vector2f& center, float radius, const Color& color) override;
+    void fillRoundedRect(const Rect& rect, float radius, const Color& color) override;
+    void drawRoundedRect(const Rect& rect, float radius, const Color& color, float thickness = 1.0f) override;
+    // Цели с пакетами треугольников получают тесселяцию из кэша путей для
+    // текущего масштаба устройства (getDeviceScale()), остальные — исходный вызов
+    void fillPath(const Path& path, const Color& color, FillRule rule = FillRule::NonZero) override;
+    void strokePath(const Path& path, const Color& color, const StrokeStyle& stroke = StrokeStyle()) override;
+    // Не пакетируется: бэкенд рисует фигуру целиком сам
+    void drawShape(const Rect& rect, const ShapeStyle& style) override;
+
+    // Остальные примитивы сохраняют порядок, но не сливаются
+    void drawRect(const Rect& rect, const Color& color, float thickness = 1.0f) override;
+    void drawLine(const Vector2f& start, const Vector2f& end, const Color& color, float thickness = 1.0f) override;
+    void drawTriangle(const Vector2f& p1, const Vector2f& p2, const Vector2f& p3,
+                      const Color& color, float thickness = 1.0f) override;
+    void drawText(const std::string& text, const Vector2f& position,
+                  const std::string& font, float size, const Color& color) override;
+
+    // Продвинутые функции рендеринга
+    void pushClipRect(const Rect& rect) override;
+    void popClipRect() override;
+    void pushTransform(const Transform& transform) override;
+    void pushTransform(const Affine& matrix) override;
+    void popTransform() override;
+
+    // Управление состоянием
+    void setBlendMode(BlendMode mode) override;
+    void setAntialiasing(bool enabled) override;
+    void setViewport(const Rect& viewport) override;
+
+    // Вспомогательные функции
+    Vector2f getTextSize(const std::string& text, const std::string& font, float size) override;
+    Vector2f getImageSize(const std::string& imagePath) override;
+    Vector2f getImageSize(ImageHandle image) override;
+    bool isMeasureThreadSafe() const override { return target_.isMeasureThreadSafe(); }
+    // Отсечение бэкенда синхронизируется лениво, поэтому проверка идёт по своему стеку
+    ClipTest testClip(const Rect& bounds) const override { return clipTracker_.test(bounds); }
+    float getDeviceScale() const override { return clipTracker_.getMatrix().scaleFactor(); }
+
+    // Отправляет накопленные пакеты, не завершая кадр
+    void flush();
+
+    // Статистика последнего завершённого кадра
+    const Stats& getFrameStats() const { return lastFrameStats_; }
+    const TessellationCache::Stats& getTessellationStats() const { return tessellation_.getStats(); }
+
+    // Сколько пакетов назад разрешено переносить вызов
+    void setReorderWindow(size_t batches) { reorderWindow_ = batches; }
+
+private:
+    enum class ItemKind : uint8_t {
+        Rect,
+        Triangle,
+        Image,
+        Mesh
+    };
+
+    struct Item {
+        ItemKind kind;
+        uint32_t batch;
+        Rect rect;
+        Vector2f points[3];
+        Color color;
+        uint32_t meshBegin = 0;     // Mesh: диапазон треугольников в meshPoints_
+        uint32_t meshCount = 0;
+    };
+
+    struct Batch {
+        bool geometry = true;
+        BlendMode blend = BlendMode::Alpha;
+        uint32_t clipState = 0;
+        uint32_t texture = 0;        // 0 — без текстуры, иначе индекс в textures_ + 1
+                                     // или дескриптор с флагом kImageHandleBit
+        Rect bounds;
+        uint32_t itemCount = 0;
+        size_t deferredBegin = 0;    // для непакетируемых вызовов — диапазон в deferred_
+        size_t deferredEnd = 0;
+    };
+
+    void addItem(Item& item, uint32_t texture, const Rect& bounds);
+    void addMesh(size_t begin, const Color& color, const Rect& bounds);
+    void addDeferred(size_t begin, const Rect& bounds);
+    void emitGeometry(const Batch& batch, const uint32_t* items, size_t count);
+    void barrier();
+    void syncClip(const std::vector<Rect>& stack);
+    void syncBlend(BlendMode mode);
+    uint32_t internClipState();
+    uint32_t internTexture(const std::string& path);
+
+    Renderer& target_;
+    size_t reorderWindow_ = 32;
+
+    std::vector<Batch> batches_;
+    std::vector<Item> items_;
+    std::vector<uint32_t> itemOrder_;
+    std::vector<Vertex> vertices_;
+    std::vector<Vector2f> meshPoints_;
+    TessellationCache tessellation_;
+    PathCache paths_;
+    CommandBuffer deferred_;
+
+    std::vector<std::string> textures_;
+    std::unordered_map<std::string, uint32_t> textureIndex_;
+
+    // Стек отсечения, как его видит вызывающий код, и как он сейчас выставлен в бэкенде
+    std::vector<Rect> logicalClips_;
+    std::vector<Rect> targetClips_;
+    std::vector<std::vector<Rect>> clipStates_;
+    uint32_t currentClipState_ = 0;
+    size_t segmentClipDepth_ = 0;
+    ClipStack clipTracker_;
+
+    BlendMode blendMode_ = BlendMode::Alpha;
+    BlendMode targetBlendMode_ = BlendMode::Alpha;
+
+    Stats frameStats_;
+    Stats lastFrameStats_;
+};
+
+} // namespace gui
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include "glyph_cache.hpp"
+#include <cstring>
+
+namespace gui {
+
+namespace {
+
+inline uint64_t mix64(uint64_t v) {
+    v ^= v >> 33;
+    v *= 0xff51afd7ed558ccdULL;
+    v ^= v >> 33;
+    v *= 0xc4ceb9fe1a85ec53ULL;
+    v ^= v >> 33;
+    return v;
+}
+
+} // namespace
+
+GlyphRunCache::GlyphRunCache(size_t capacity) : cache_(capacity) {}
+
+uint64_t GlyphRunCache::makeKey(const std::string& text, const std::string& font, float size) {
+    uint32_t sizeBits;
+    std::memcpy(&sizeBits, &size, sizeof(sizeBits));
+
+    uint64_t key = mix64(std::hash<std::string>()(text));
+    key ^= mix64(std::hash<std::string>()(font) + 0x9E3779B97F4A7C15ULL);
+    key ^= mix64(sizeBits);
+    return key;
+}
+
+const GlyphRun& GlyphRunCache::get(const std::string& text, const std::string& font, float size,
+                                   const Shaper& shaper) {
+    bool created = false;
+    Entry& entry = cache_.lookup(
+        makeKey(text, font, size),
+        [&](const Entry& cached) { return cached.size == size && cached.text == text && cached.font == font; },
+        created);
+    if (created) {
+        entry.text = text;
+        entry.font = font;
+        entry.size = size;
+        shaper(text, font, size, entry.run);
+    }
+    return entry.run;
+}
+
+} // namespace gui
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "../core/math_types.hpp"
+#include "lru_cache.hpp"
+
+namespace gui {
+
+// Глиф, размещённый относительно левого верхнего угла строки текста
+struct PositionedGlyph {
+    uint32_t glyph = 0;     // индекс глифа в шрифте бэкенда
+    Vector2f position;
+};
+
+struct GlyphLine {
+    uint32_t firstGlyph = 0;
+    uint32_t glyphCount = 0;
+    float offsetY = 0.0f;   // смещение строки от начала текста
+    float width = 0.0f;
+};
+
+// Результат шейпинга: глифы по строкам и общий размер текста
+struct GlyphRun {
+    std::vector<PositionedGlyph> glyphs;
+    std::vector<GlyphLine> lines;
+    Vector2f size;
+};
+
+// LRU-кэш результатов шейпинга по ключу (хэш текста, шрифт, размер).
+// Один экземпляр обслуживает и измерение, и отрисовку, поэтому текст,
+// измеренный при раскладке, рисуется без повторного шейпинга.
+// Не потокобезопасен: владелец сам защищает вызовы.
+class GlyphRunCache {
+public:
+    using Stats = CacheStats;
+
+    // Заполняет run для текста; вызывается только при промахе
+    using Shaper = std::function<void(const std::string& text, const std::string& font, float size, GlyphRun& run)>;
+
+    explicit GlyphRunCache(size_t capacity = 1024);
+
+    // Ссылка действительна до следующего вызова get() или clear()
+    const GlyphRun& get(const std::string& text, const std::string& font, float size, const Shaper& shaper);
+
+    void clear() { cache_.clear(); }
+    void setCapacity(size_t capacity) { cache_.setCapacity(capacity); }
+    size_t getCapacity() const { return cache_.getCapacity(); }
+
+    const Stats& getStats() const { return cache_.getStats(); }
+    void resetStats() { cache_.resetStats(); }
+
+private:
+    struct Entry {
+        std::string text;
+        std::string font;
+        float size = 0.0f;
+        GlyphRun run;
+    };
+
+    static uint64_t makeKey(const std::string& text, const std::string& font, float size);
+
+    LruCache<Entry> cache_;
+};
+
+} // namespace gui
\ No newline at end of file
@@ -0,0 +1,288 @@
+#include "headless_context.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace gui {
+
+namespace {
+const Color kDamageFlashColor(1.0f, 0.0f, 1.0f, 0.35f);
+}
+
+HeadlessContext::HeadlessContext() : HeadlessContext(Config()) {}
+
+HeadlessContext::HeadlessContext(const Config& config)
+    : config_(config)
+    , renderer_(makeRendererConfig(config))
+    , layers_(makeLayerConfig(config)) {
+    renderer_.initialize();
+    if (config_.showOverdraw)
+        renderer_.setOverdrawMode(SoftwareRenderer::OverdrawMode::Heatmap);
+    updateDamageBounds();
+    if (config_.pipelined)
+        startRenderThread();
+}
+
+HeadlessContext::~HeadlessContext() {
+    stopRenderThread();
+    if (root_) {
+        root_->setDamageTracker(nullptr);
+        root_->setLayerCache(nullptr);
+    }
+}
+
+SoftwareRenderer::Config HeadlessContext::makeRendererConfig(const Config& config) {
+    SoftwareRenderer::Config result;
+    result.width = config.width;
+    result.height = config.height;
+    result.threadCount = config.threadCount;
+    return result;
+}
+
+// Снятый слой может рисовать каждый кадр в полёте и кадр на растеризации
+LayerCache::Config HeadlessContext::makeLayerConfig(const Config& config) {
+    LayerCache::Config result;
+    result.memoryBudget = config.layerBudget;
+    result.promoteAfterFrames = config.layerPromoteFrames;
+    result.scale = config.scale > 0.0f ? config.scale : 1.0f;
+    result.releaseDelay = (config.pipelined ? std::max(config.maxFramesInFlight, 1u) : 0u) + 1u;
+    return result;
+}
+
+void HeadlessContext::updateDamageBounds() {
+    const float scale = config_.scale > 0.0f ? config_.scale : 1.0f;
+    damage_.setBounds(Rect(Vector2f(), Vector2f(config_.width / scale, config_.height / scale)));
+}
+
+// Расширяет область до целых пикселей устройства, чтобы заливка фона
+// и отсечение совпадали без сглаженных краёв
+Rect HeadlessContext::snapToPixels(const Rect& rect) const {
+    const float scale = config_.scale > 0.0f ? config_.scale : 1.0f;
+    const float x0 = std::floor(rect.position.x * scale);
+    const float y0 = std::floor(rect.position.y * scale);
+    const float x1 = std::ceil((rect.position.x + rect.size.x) * scale);
+    const float y1 = std::ceil((rect.position.y + rect.size.y) * scale);
+    return Rect(Vector2f(x0, y0) / scale, Vector2f(x1 - x0, y1 - y0) / scale);
+}
+
+void HeadlessContext::setRoot(std::shared_ptr<Widget> root) {
+    if (root_) {
+        root_->setDamageTracker(nullptr);
+        root_->setLayerCache(nullptr);
+    }
+    root_ = std::move(root);
+    if (root_) {
+        root_->setDamageTracker(&damage_);
+        root_->setLayerCache(&layers_);
+    }
+    damage_.addAll();
+}
+
+void HeadlessContext::resize(unsigned int width, unsigned int height) {
+    finish();
+    config_.width = width;
+    config_.height = height;
+    renderer_.resize(width, height);
+    updateDamageBounds();
+}
+
+void HeadlessContext::setScale(float scale) {
+    config_.scale = scale;
+    layers_.setScale(scale > 0.0f ? scale : 1.0f);
+    updateDamageBounds();
+}
+
+void HeadlessContext::setBackground(const Color& color) {
+    config_.background = color;
+    damage_.addAll();
+}
+
+void HeadlessContext::setPartialRepaint(bool enabled) {
+    config_.partialRepaint = enabled;
+    damage_.addAll();
+}
+
+void HeadlessContext::setShowOverdraw(bool enabled) {
+    finish();
+    config_.showOverdraw = enabled;
+    renderer_.setOverdrawMode(enabled ? SoftwareRenderer::OverdrawMode::Heatmap : SoftwareRenderer::OverdrawMode::Off);
+    damage_.addAll();
+}
+
+void HeadlessContext::update(float deltaTime) {
+    if (root_) {
+        root_->update(deltaTime);
+        root_->updateDirty();
+    }
+}
+
+// Готовит повреждения кадра; false — рисовать нечего
+bool HeadlessContext::prepareFrame() {
+    if (!config_.partialRepaint || config_.showOverdraw)
+        damage_.addAll();
+
+    repainted_.clear();
+    return !damage_.empty() || !flashed_.empty();
+}
+
+// Команды кадра идут в рендерер напрямую или в снимок для потока рендеринга
+void HeadlessContext::recordFrame(Renderer& target) {
+    // Подсвечиваются только настоящие повреждения, а не стирание прошлой вспышки
+    const std::vector<Rect> flashRegions = damage_.getRegions();
+    for (const Rect& region : flashed_) {
+        damage_.add(region);
+    }
+    flashed_.clear();
+
+    Renderer::ScopedBinding binding(target);
+    target.pushTransform(Transform(Vector2f(), Vector2f(config_.scale, config_.scale), 0.0f));
+
+    if (damage_.isFull()) {
+        target.clear(config_.background);
+        if (root_)
+            root_->paint();
+        repainted_.push_back(damage_.getBounds());
+    } else {
+        for (const Rect& region : damage_.getRegions()) {
+            const Rect area = snapToPixels(region);
+            target.pushClipRect(area);
+            target.setBlendMode(BlendMode::None);
+            target.fillRect(area, config_.background);
+            target.setBlendMode(BlendMode::Alpha);
+            if (root_)
+                root_->paint();
+            target.popClipRect();
+            repainted_.push_back(area);
+        }
+    }
+
+    if (config_.flashDamage) {
+        for (const Rect& region : flashRegions) {
+            target.fillRect(snapToPixels(region), kDamageFlashColor);
+            flashed_.push_back(region);
+        }
+    }
+
+    target.popTransform();
+    damage_.clear();
+}
+
+const utils::Image& HeadlessContext::render() {
+    submitFrame();
+    return finish();
+}
+
+// Отметки, поставленные после update(), снимаются до записи кадра
+bool HeadlessContext::submitFrame() {
+    if (root_)
+        root_->updateDirty();
+    layers_.beginFrame();
+    if (!prepareFrame())
+        return false;
+
+    if (!config_.pipelined) {
+        renderer_.beginFrame();
+        recordFrame(renderer_);
+        renderer_.endFrame();
+        return true;
+    }
+
+    // Буфер берётся без ожидания: запись перекрывается с растеризацией
+    std::unique_ptr<CommandBuffer> frame;
+    {
+        std::lock_guard<std::mutex> lock(pipelineMutex_);
+        if (!freeFrames_.empty()) {
+            frame = std::move(freeFrames_.back());
+            freeFrames_.pop_back();
+        }
+    }
+    if (!frame)
+        frame = std::make_unique<CommandBuffer>();
+    frame->reset();
+    frame->setMeasureRenderer(&renderer_);
+    recordFrame(*frame);
+
+    std::unique_lock<std::mutex> lock(pipelineMutex_);
+    const size_t limit = config_.maxFramesInFlight > 0 ? config_.maxFramesInFlight : 1;
+    frameDone_.wait(lock, [this, limit]() { return framesInFlight_ < limit; });
+    pendingFrames_.push_back(std::move(frame));
+    ++framesInFlight_;
+    lock.unlock();
+    frameQueued_.notify_one();
+    return true;
+}
+
+const utils::Image& HeadlessContext::finish() {
+    std::unique_lock<std::mutex> lock(pipelineMutex_);
+    frameDone_.wait(lock, [this]() { return framesInFlight_ == 0; });
+    return renderer_.getTarget();
+}
+
+void HeadlessContext::setPipelined(bool enabled, unsigned int maxFramesInFlight) {
+    config_.maxFramesInFlight = maxFramesInFlight;
+    if (enabled != config_.pipelined) {
+        config_.pipelined = enabled;
+        if (enabled)
+            startRenderThread();
+        else
+            stopRenderThread();
+    }
+    layers_.setReleaseDelay(makeLayerConfig(config_).releaseDelay);
+}
+
+void HeadlessContext::startRenderThread() {
+    if (renderThread_.joinable())
+        return;
+    stopping_ = false;
+    renderThread_ = std::thread([this]() { renderLoop(); });
+}
+
+// Отправленные кадры дорисовываются до остановки
+void HeadlessContext::stopRenderThread() {
+    if (!renderThread_.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(pipelineMutex_);
+        stopping_ = true;
+    }
+    frameQueued_.notify_all();
+    renderThread_.join();
+}
+
+void HeadlessContext::renderLoop() {
+    for (;;) {
+        std::unique_ptr<CommandBuffer> frame;
+        {
+            std::unique_lock<std::mutex> lock(pipelineMutex_);
+            frameQueued_.wait(lock, [this]() { return stopping_ || !pendingFrames_.empty(); });
+            if (pendingFrames_.empty())
+                return;
+            frame = std::move(pendingFrames_.front());
+            pendingFrames_.pop_front();
+        }
+
+        renderer_.beginFrame();
+        renderer_.addCullStats(frame->getCullStats());
+        frame->replay(renderer_);
+        renderer_.endFrame();
+
+        {
+            std::lock_guard<std::mutex> lock(pipelineMutex_);
+            freeFrames_.push_back(std::move(frame));
+            --framesInFlight_;
+        }
+        frameDone_.notify_all();
+    }
+}
+
+bool HeadlessContext::saveSnapshot(const std::string& path) {
+    return render().saveToFile(path);
+}
+
+void HeadlessContext::renderAll(const std::vector<HeadlessContext*>& contexts, utils::ThreadPool& pool) {
+    pool.parallelFor(contexts.size(), [&contexts](size_t i) {
+        if (contexts[i])
+            contexts[i]->render();
+    });
+}
+
+} // namespace gui
\ No newline at end of file
@@ -0,0 +1,134 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../core/widget_base.hpp"
+#include "../utils/thread_pool.hpp"
+#include "command_buffer.hpp"
+#include "damage_tracker.hpp"
+#include "layer_cache.hpp"
+#include "software_renderer.hpp"
+
+namespace gui {
+
+// Контекст без окна: дерево виджетов рисуется программным рендерером в Image.
+// Используется для генерации миниатюр на сервере и визуальных тестов в CI.
+// Результат побайтно одинаков между запусками и не зависит от числа потоков.
+// Между кадрами перерисовываются только повреждённые области: изображение
+// сохраняется, а дерево воспроизводится под отсечением по каждой области.
+//
+// В конвейерном режиме кадр записывается в неизменяемый снимок (список команд
+// с отсечениями и преобразованиями), который растеризует отдельный поток рендеринга,
+// пока вызывающий поток выполняет update() и запись следующего кадра.
+// maxFramesInFlight ограничивает число снимков, ожидающих растеризации:
+// при 1 запись кадра N+1 перекрывается только с растеризацией кадра N.
+class HeadlessContext {
+public:
+    struct Config {
+        unsigned int width = 800;       // размер изображения в пикселях
+        unsigned int height = 600;
+        float scale = 1.0f;             // логические единицы -> пиксели
+        Color background = Color::transparent();
+        unsigned int threadCount = 1;   // потоки растеризации одного кадра
+        bool partialRepaint = true;     // false — каждый кадр рисуется целиком
+        bool flashDamage = false;       // отладка: подсвечивать перерисованные области
+        bool showOverdraw = false;      // отладка: тепловая карта перерисовки, кадры целиком
+        bool pipelined = false;         // растеризация на отдельном потоке
+        unsigned int maxFramesInFlight = 1;
+        size_t layerBudget = 64u << 20;     // байт пикселей слоёв, см. Widget::setLayerMode
+        unsigned int layerPromoteFrames = 0; // неизменных кадров до слоя Auto; 0 — только Always
+    };
+
+    HeadlessContext();
+    explicit HeadlessContext(const Config& config);
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    ~HeadlessContext();
+
+    void setRoot(std::shared_ptr<Widget> root);
+    std::shared_ptr<Widget> getRoot() const { return root_; }
+
+    // Размер изображения в пикселях; логический размер корня равен ему, делённому на scale
+    void resize(unsigned int width, unsigned int height);
+    void setScale(float scale);
+    void setBackground(const Color& color);
+    void setPartialRepaint(bool enabled);
+    void setFlashDamage(bool enabled) { config_.flashDamage = enabled; }
+    // Карта заменяет изображение, поэтому частичная перерисовка на это время отключается
+    void setShowOverdraw(bool enabled);
+    const Config& getConfig() const { return config_; }
+
+    // Области, накопленные к следующему кадру, в логических единицах
+    DamageTracker& getDamage() { return damage_; }
+    // Области, перерисованные последним render(); пусто, если кадр пропущен
+    const std::vector<Rect>& getRepaintedRegions() const { return repainted_; }
+
+    // update() дерева и проход updateDirty() по устаревшим поддеревьям
+    void update(float deltaTime);
+
+    // Рисует кадр и возвращает результат; изображение живёт до следующего render().
+    // Без повреждений кадр не рисуется и возвращается прежнее изображение.
+    // В конвейерном режиме дожидается растеризации всех отправленных кадров.
+    const utils::Image& render();
+    // В конвейерном режиме изображение можно читать только после finish()
+    const utils::Image& getImage() const { return renderer_.getTarget(); }
+
+    // Записывает кадр и ставит его в очередь потока рендеринга; блокируется,
+    // пока в очереди maxFramesInFlight кадров. Без конвейера рисует сразу.
+    // Возвращает false, если повреждений нет и кадр пропущен.
+    bool submitFrame();
+    // Дожидается растеризации отправленных кадров
+    const utils::Image& finish();
+
+    void setPipelined(bool enabled, unsigned int maxFramesInFlight = 1);
+
+    // Рисует кадр и сохраняет его в PNG
+    bool saveSnapshot(const std::string& path);
+
+    // В конвейерном режиме рендерер занят потоком рендеринга до finish()
+    SoftwareRenderer& getRenderer() { return renderer_; }
+    // Слои строятся в масштабе контекста и освобождаются с учётом кадров в полёте
+    LayerCache& getLayerCache() { return layers_; }
+
+    // Рисует несколько контекстов параллельно, по контексту на задачу пула.
+    // Контексты не должны разделять виджеты между собой.
+    static void renderAll(const std::vector<HeadlessContext*>& contexts, utils::ThreadPool& pool);
+
+private:
+    static SoftwareRenderer::Config makeRendererConfig(const Config& config);
+    static LayerCache::Config makeLayerConfig(const Config& config);
+    void updateDamageBounds();
+    Rect snapToPixels(const Rect& rect) const;
+    bool prepareFrame();
+    void recordFrame(Renderer& target);
+
+    void startRenderThread();
+    void stopRenderThread();
+    void renderLoop();
+
+    Config config_;
+    SoftwareRenderer renderer_;
+    LayerCache layers_;             // освобождает изображения renderer_, поэтому объявлен после него
+    std::shared_ptr<Widget> root_;
+    DamageTracker damage_;
+    std::vector<Rect> repainted_;
+    std::vector<Rect> flashed_;
+
+    // Конвейер: очередь снимков и буферы для повторного использования
+    std::thread renderThread_;
+    std::mutex pipelineMutex_;
+    std::condition_variable frameQueued_;
+    std::condition_variable frameDone_;
+    std::deque<std::unique_ptr<CommandBuffer>> pendingFrames_;
+    std::vector<std::unique_ptr<CommandBuffer>> freeFrames_;
+    size_t framesInFlight_ = 0;     // в очереди и на растеризации
+    bool stopping_ = false;
+};
+
+} // namespace gui
\ No newline at end of file
@@ -0,0 +1,274 @@
+#include "layer_cache.hpp"
+#include "../core/widget_base.hpp"
+#include "command_buffer.hpp"
+#include "software_renderer.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace gui {
+
+namespace {
+
+// Растеризатор слоёв своего потока; тайлы слоя растеризуются на нём же
+SoftwareRenderer& layerRasterizer() {
+    static const SoftwareRenderer::Config config = [] {
+        SoftwareRenderer::Config result;
+        result.width = 0;
+        result.height = 0;
+        result.threadCount = 1;
+        return result;
+    }();
+    thread_local SoftwareRenderer renderer(config);
+    return renderer;
+}
+
+thread_local utils::Image t_layerPixels;
+
+bool sameRect(const Rect& a, const Rect& b) {
+    return a.position.x == b.position.x && a.position.y == b.position.y &&
+           a.size.x == b.size.x && a.size.y == b.size.y;
+}
+
+void rasterizeLayer(const CommandBuffer& list, const Rect& area, float scale, unsigned int width,
+                    unsigned int height, utils::Image& pixels) {
+    pixels.create(width, height, utils::Image::Format::RGBA);
+    SoftwareRenderer& renderer = layerRasterizer();
+    renderer.setTarget(&pixels);
+    renderer.beginFrame();
+    renderer.clear(Color::transparent());
+    renderer.pushTransform(Affine::scaling(scale, scale) * Affine::translation(-area.position.x, -area.position.y));
+    list.replay(renderer);
+    renderer.popTransform();
+    renderer.endFrame();
+}
+
+} // namespace
+
+LayerCache::LayerCache() : LayerCache(Config()) {}
+
+LayerCache::LayerCache(const Config& config) : config_(config) {}
+
+// Рендерер-владелец жив дольше кэша, поэтому пиксели освобождаются сразу
+LayerCache::~LayerCache() {
+    for (auto& item : entries_) {
+        item.first->layerOwner_ = nullptr;
+        if (item.second.image)
+            item.second.owner->releaseImage(item.second.image);
+    }
+    for (const PendingRelease& release : pending_) {
+        release.owner->releaseImage(release.image);
+    }
+}
+
+Rect LayerCache::snapToPixels(const Rect& bounds) const {
+    const float scale = config_.scale;
+    const float x0 = std::floor(bounds.position.x * scale);
+    const float y0 = std::floor(bounds.position.y * scale);
+    const float x1 = std::ceil((bounds.position.x + bounds.size.x) * scale);
+    const float y1 = std::ceil((bounds.position.y + bounds.size.y) * scale);
+    return Rect(Vector2f(x0, y0) / scale, Vector2f(x1 - x0, y1 - y0) / scale);
+}
+
+void LayerCache::retire(Entry& entry) {
+    if (entry.image)
+        pending_.push_back(PendingRelease{entry.owner, entry.image, frame_});
+    bytes_ -= entry.bytes;
+    entry.image = ImageHandle();
+    entry.bytes = 0;
+}
+
+void LayerCache::evict(const Widget* widget, Entry& entry) {
+    if (!entry.image)
+        return;
+    retire(entry);
+    evicted_.push_back(widget);
+}
+
+// Вытесняются только слои Auto, не выведенные в этом кадре, начиная с давних
+bool LayerCache::makeRoom(size_t bytes, const Widget* keep) {
+    if (bytes > config_.memoryBudget)
+        return false;
+
+    while (bytes_ + bytes > config_.memoryBudget) {
+        auto victim = entries_.end();
+        for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+            const Entry& entry = it->second;
+            if (it->first == keep || !entry.image || entry.lastUsed == frame_ ||
+                it->first->layerMode_ != Widget::LayerMode::Auto)
+                continue;
+            if (victim == entries_.end() || entry.lastUsed < victim->second.lastUsed)
+                victim = it;
+        }
+        if (victim == entries_.end())
+            return false;
+        evict(victim->first, victim->second);
+        ++stats_.evictions;
+    }
+    return true;
+}
+
+void LayerCache::beginFrame() {
+    std::vector<const Widget*> evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++frame_;
+        evicted.swap(evicted_);
+
+        auto expired = std::stable_partition(pending_.begin(), pending_.end(),
+                                             [this](const PendingRelease& release) {
+                                                 return frame_ - release.frame < config_.releaseDelay;
+                                             });
+        for (auto it = expired; it != pending_.end(); ++it) {
+            it->owner->releaseImage(it->image);
+        }
+        pending_.erase(expired, pending_.end());
+    }
+
+    // Список родителя ещё рисует снятый слой и должен быть перезаписан
+    for (const Widget* widget : evicted) {
+        const_cast<Widget*>(widget)->invalidatePaint();
+    }
+}
+
+bool LayerCache::paint(const Widget& widget, Renderer& target, const Rect& bounds) {
+    if (widget.layerOwner_ && widget.layerOwner_ != this)
+        widget.layerOwner_->remove(widget);
+
+    const CommandBuffer& list = *widget.displayList_;
+    const bool always = widget.layerMode_ == Widget::LayerMode::Always;
+    const bool eligible = !bounds.isEmpty() && !list.hasImageHandles() &&
+        (always || (config_.promoteAfterFrames > 0 && list.getCommandCount() >= config_.minCommands));
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = entries_.find(&widget);
+    if (!eligible) {
+        if (it != entries_.end()) {
+            retire(it->second);
+            entries_.erase(it);
+            widget.layerOwner_ = nullptr;
+        }
+        return false;
+    }
+
+    if (it == entries_.end()) {
+        it = entries_.emplace(&widget, Entry()).first;
+        it->second.generation = widget.recordGeneration_;
+        it->second.stableSince = frame_;
+        widget.layerOwner_ = this;
+    }
+
+    Entry& entry = it->second;
+    const bool changed = entry.generation != widget.recordGeneration_;
+    if (changed) {
+        entry.generation = widget.recordGeneration_;
+        entry.stableSince = frame_;
+        if (!always && entry.image) {
+            retire(entry);
+            ++stats_.demotions;
+        }
+    }
+    if (!always && !entry.image && frame_ - entry.stableSince < config_.promoteAfterFrames)
+        return false;
+
+    Renderer& owner = target.getImageOwner();
+    const Rect area = snapToPixels(bounds);
+    entry.lastUsed = frame_;
+    if (entry.image && !changed && entry.owner == &owner && sameRect(entry.area, area)) {
+        ++stats_.hits;
+        const ImageHandle image = entry.image;
+        lock.unlock();
+        target.drawImage(image, area, Color::white());
+        return true;
+    }
+
+    const unsigned int width = static_cast<unsigned int>(std::lround(area.size.x * config_.scale));
+    const unsigned int height = static_cast<unsigned int>(std::lround(area.size.y * config_.scale));
+    const size_t bytes = static_cast<size_t>(width) * height * 4;
+    if (entry.owner != &owner)
+        retire(entry);
+    const bool promoted = !entry.image;
+    bytes_ -= entry.bytes;
+    entry.bytes = 0;
+    if (width == 0 || height == 0 || !makeRoom(bytes, &widget)) {
+        retire(entry);
+        entry.stableSince = frame_;
+        return false;
+    }
+    // Место занимается до растеризации, чтобы соседние потоки его не отдали
+    bytes_ += bytes;
+    entry.bytes = bytes;
+    const ImageHandle previous = entry.image;
+    const float scale = config_.scale;
+    lock.unlock();
+
+    rasterizeLayer(list, area, scale, width, height, t_layerPixels);
+    const ImageHandle image = owner.updateImage(previous, t_layerPixels);
+
+    lock.lock();
+    entry.owner = &owner;
+    entry.image = image;
+    entry.area = area;
+    if (!image) {
+        bytes_ -= entry.bytes;
+        entry.bytes = 0;
+        entry.stableSince = frame_;
+        return false;
+    }
+    ++stats_.rebuilds;
+    if (promoted && !always)
+        ++stats_.promotions;
+    lock.unlock();
+
+    target.drawImage(image, area, Color::white());
+    return true;
+}
+
+void LayerCache::remove(const Widget& widget) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(&widget);
+    if (it == entries_.end())
+        return;
+    retire(it->second);
+    entries_.erase(it);
+    evicted_.erase(std::remove(evicted_.begin(), evicted_.end(), &widget), evicted_.end());
+    widget.layerOwner_ = nullptr;
+}
+
+void LayerCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& item : entries_) {
+        evict(item.first, item.second);
+    }
+}
+
+void LayerCache::setConfig(const Config& config) {
+    const bool rescale = config.scale != config_.scale;
+    config_ = config;
+    if (rescale)
+        clear();
+}
+
+void LayerCache::setScale(float scale) {
+    if (scale == config_.scale || scale <= 0.0f)
+        return;
+    config_.scale = scale;
+    clear();
+}
+
+void LayerCache::setReleaseDelay(unsigned int frames) {
+    config_.releaseDelay = frames;
+}
+
+LayerCache::Stats LayerCache::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats = stats_;
+    stats.bytes = bytes_;
+    stats.layers = 0;
+    for (const auto& item : entries_) {
+        if (item.second.image)
+            ++stats.layers;
+    }
+    return stats;
+}
+
+} // namespace gui
\ No newline at end of file
@@ -0,0 +1,108 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "../core/renderer.hpp"
+
+namespace gui {
+
+class Widget;
+
+// Кэш слоёв: поддерево виджета растеризуется программным рендерером в отдельное
+// изображение, и пока список команд виджета не перезаписан, вместо списка
+// выводится одна команда drawImage.
+// Изображения выдаёт рендерер, в который рисует дерево (Renderer::getImageOwner());
+// кэш должен жить не дольше него. Поддерево, которое само рисует изображения
+// по дескрипторам, в том числе вложенные слои, слоем не становится: дескрипторы
+// действительны только у выдавшего их рендерера.
+// Слой, уже записанный в список команд родителя, снимается только в beginFrame():
+// виджет получает invalidatePaint(), а пиксели освобождаются через releaseDelay
+// кадров, когда их не рисует ни один кадр в полёте.
+// Потокобезопасен: слои соседей строятся параллельно при записи поддеревьев.
+class LayerCache {
+public:
+    struct Config {
+        size_t memoryBudget = 64u << 20;    // байт пикселей всех слоёв
+        // Поддерево в режиме Auto становится слоем, если его список команд
+        // не перезаписывался столько кадров; 0 — только явные слои
+        unsigned int promoteAfterFrames = 0;
+        size_t minCommands = 32;            // более простые поддеревья дешевле воспроизвести
+        float scale = 1.0f;                 // пикселей слоя на единицу рисования
+        unsigned int releaseDelay = 2;      // кадров до освобождения пикселей снятого слоя
+    };
+
+    struct Stats {
+        size_t layers = 0;
+        size_t bytes = 0;
+        uint64_t hits = 0;          // слой выведен без перестроения
+        uint64_t rebuilds = 0;      // растеризации поддеревьев
+        uint64_t promotions = 0;    // слои Auto, созданные по числу неизменных кадров
+        uint64_t demotions = 0;     // слои Auto, снятые из-за изменения поддерева
+        uint64_t evictions = 0;     // слои, вытесненные бюджетом
+    };
+
+    LayerCache();
+    explicit LayerCache(const Config& config);
+    ~LayerCache();
+
+    LayerCache(const LayerCache&) = delete;
+    LayerCache& operator=(const LayerCache&) = delete;
+
+    // Вызывается до записи кадра: считает кадры, снимает вытесненные слои
+    void beginFrame();
+    uint64_t getFrame() const { return frame_; }
+
+    // Выводит записанный список команд виджета через слой. false — слой не нужен
+    // или невозможен, и список воспроизводит вызывающий. bounds — область
+    // отрисовки поддерева в координатах его списка команд
+    bool paint(const Widget& widget, Renderer& target, const Rect& bounds);
+
+    // Забывает виджет; его слой снимается как вытесненный
+    void remove(const Widget& widget);
+    // Снимает все слои; они перестраиваются при следующей отрисовке виджетов
+    void clear();
+
+    void setConfig(const Config& config);
+    const Config& getConfig() const { return config_; }
+    // Слои перестраиваются в новом разрешении
+    void setScale(float scale);
+    void setReleaseDelay(unsigned int frames);
+
+    Stats getStats() const;
+
+private:
+    struct Entry {
+        Renderer* owner = nullptr;
+        ImageHandle image;
+        Rect area;                  // область слоя, выровненная по его пикселям
+        size_t bytes = 0;
+        uint64_t generation = 0;    // поколение списка команд, по которому построен слой
+        uint64_t stableSince = 0;   // кадр последней перезаписи списка
+        uint64_t lastUsed = 0;
+    };
+
+    struct PendingRelease {
+        Renderer* owner = nullptr;
+        ImageHandle image;
+        uint64_t frame = 0;
+    };
+
+    Rect snapToPixels(const Rect& bounds) const;
+    // Пиксели слоя уходят в очередь освобождения; вызывается под mutex_
+    void retire(Entry& entry);
+    void evict(const Widget* widget, Entry& entry);
+    bool makeRoom(size_t bytes, const Widget* keep);
+
+    Config config_;
+    mutable std::mutex mutex_;
+    std::unordered_map<const Widget*, Entry> entries_;
+    std::vector<PendingRelease> pending_;
+    std::vector<const Widget*> evicted_;
+    size_t bytes_ = 0;
+    uint64_t frame_ = 0;
+    Stats stats_;
+};
+
+} // namespace gui
\ No newline at end of file
@@ -0,0 +1,107 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+
+namespace gui {
+
+// Счётчики кэшей рендерера
+struct CacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;     // по ёмкости и из-за коллизий ключа
+    size_t entries = 0;
+
+    double hitRate() const {
+        const uint64_t total = hits + misses;
+        return total ? static_cast<double>(hits) / static_cast<double>(total) : 0.0;
+    }
+};
+
+// LRU-кэш записей Value по 64-битному ключу: список в порядке использования
+// и индекс по ключу. Ключ — обычно хэш исходных данных, поэтому попадание
+// сверяется с записью; запись, не прошедшая сверку, вытесняется новой.
+// Не потокобезопасен.
+template<typename Value>
+class LruCache {
+public:
+    explicit LruCache(size_t capacity) : capacity_(capacity > 0 ? capacity : 1) {}
+
+    // Запись по ключу, поднятая в начало списка. matches(const Value&)
+    // подтверждает попадание. При промахе создаётся пустая запись, и
+    // created = true: её заполняет вызывающий. Ссылка действительна
+    // до следующего lookup() или clear()
+    template<typename Matches>
+    Value& lookup(uint64_t key, Matches&& matches, bool& created) {
+        auto found = index_.find(key);
+        if (found != index_.end()) {
+            if (matches(static_cast<const Value&>(found->second->value))) {
+                ++stats_.hits;
+                entries_.splice(entries_.begin(), entries_, found->second);
+                created = false;
+                return found->second->value;
+            }
+            // Коллизия хэша: прежняя запись вытесняется новой
+            entries_.erase(found->second);
+            index_.erase(found);
+            ++stats_.evictions;
+        }
+
+        ++stats_.misses;
+        entries_.emplace_front();
+        entries_.front().key = key;
+        index_.emplace(key, entries_.begin());
+        evictToCapacity();
+        stats_.entries = entries_.size();
+        created = true;
+        return entries_.front().value;
+    }
+
+    // Для ключей, однозначно задающих запись
+    Value& lookup(uint64_t key, bool& created) {
+        return lookup(key, [](const Value&) { return true; }, created);
+    }
+
+    void clear() {
+        entries_.clear();
+        index_.clear();
+        stats_.entries = 0;
+    }
+
+    void setCapacity(size_t capacity) {
+        capacity_ = capacity > 0 ? capacity : 1;
+        evictToCapacity();
+        stats_.entries = entries_.size();
+    }
+    size_t getCapacity() const { return capacity_; }
+    size_t size() const { return entries_.size(); }
+
+    const CacheStats& getStats() const { return stats_; }
+    void resetStats() {
+        stats_ = CacheStats();
+        stats_.entries = entries_.size();
+    }
+
+private:
+    struct Entry {
+        uint64_t key = 0;
+        Value value;
+    };
+
+    void evictToCapacity() {
+        while (entries_.size() > capacity_) {
+            index_.erase(entries_.back().key);
+            entries_.pop_back();
+            ++stats_.evictions;
+        }
+    }
+
+    // Начало списка — последние использованные записи
+    std::list<Entry> entries_;
+    std::unordered_map<uint64_t, typename std::list<Entry>::iterator> index_;
+    size_t capacity_;
+    CacheStats stats_;
+};
+
+} // namespace gui
\ No newline at end of file
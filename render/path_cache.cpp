@@ -0,0 +1,335 @@
+#include "path_cache.hpp"
+#include "tessellation_cache.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace gui {
+
+namespace {
+
+constexpr float kPi = 3.14159265358979323846f;
+constexpr int kMinBucket = -16;
+constexpr int kMaxBucket = 16;
+// Точки ближе этого считаются одной и не дают отрезка обводки
+constexpr float kMinSegmentLength = 1e-4f;
+
+uint64_t mixKey(uint64_t hash, const void* data, size_t size) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Отрезок, пересекающий полосу [y0, y1] целиком, с абсциссами на её границах
+struct BandEdge {
+    float top;
+    float bottom;
+    int winding;
+};
+
+bool isInside(int winding, FillRule rule) {
+    return rule == FillRule::NonZero ? winding != 0 : (winding & 1) != 0;
+}
+
+Vector2f leftNormal(const Vector2f& direction) {
+    return Vector2f(-direction.y, direction.x);
+}
+
+} // namespace
+
+PathCache::PathCache(size_t capacity) : cache_(capacity) {}
+
+int PathCache::zoomBucket(float scale) {
+    if (!(scale > 0.0f))
+        return 0;
+    const int bucket = static_cast<int>(std::ceil(std::log2(scale) * 2.0f - 1e-4f));
+    return std::clamp(bucket, kMinBucket, kMaxBucket);
+}
+
+float PathCache::bucketScale(int bucket) {
+    return std::exp2(static_cast<float>(bucket) * 0.5f);
+}
+
+bool PathCache::matches(const Entry& entry, const Path& path, uint8_t kind, FillRule rule,
+                        const StrokeStyle& stroke, int bucket) {
+    if (entry.kind != kind || entry.bucket != bucket || entry.rule != rule)
+        return false;
+    if (kind == 1 && (entry.stroke.width != stroke.width || entry.stroke.join != stroke.join ||
+                      entry.stroke.cap != stroke.cap || entry.stroke.miterLimit != stroke.miterLimit))
+        return false;
+    const std::vector<Vector2f>& points = path.getPoints();
+    if (entry.verbs != path.getVerbs() || entry.points.size() != points.size())
+        return false;
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (entry.points[i].x != points[i].x || entry.points[i].y != points[i].y)
+            return false;
+    }
+    return true;
+}
+
+PathCache::Geometry& PathCache::lookup(uint64_t key, const Path& path, uint8_t kind, FillRule rule,
+                                       const StrokeStyle& stroke, int bucket, bool& created) {
+    Entry& entry = cache_.lookup(
+        key, [&](const Entry& cached) { return matches(cached, path, kind, rule, stroke, bucket); }, created);
+    if (created) {
+        entry.kind = kind;
+        entry.bucket = bucket;
+        entry.rule = rule;
+        entry.stroke = stroke;
+        entry.verbs = path.getVerbs();
+        entry.points = path.getPoints();
+    }
+    return entry.geometry;
+}
+
+const PathCache::Geometry& PathCache::getFill(const Path& path, FillRule rule, float scale, bool triangulate) {
+    const int bucket = zoomBucket(scale);
+    const uint8_t kind = 0;
+    uint64_t key = mixKey(path.getHash(), &kind, sizeof(kind));
+    key = mixKey(key, &rule, sizeof(rule));
+    key = mixKey(key, &bucket, sizeof(bucket));
+
+    bool created = false;
+    Geometry& geometry = lookup(key, path, kind, rule, StrokeStyle(), bucket, created);
+    if (created) {
+        geometry.rule = rule;
+        buildFill(path, kDefaultTolerance / bucketScale(bucket), geometry);
+    }
+    if (triangulate && !geometry.triangulated)
+        PathCache::triangulate(geometry);
+    return geometry;
+}
+
+const PathCache::Geometry& PathCache::getStroke(const Path& path, const StrokeStyle& stroke, float scale,
+                                                bool triangulate) {
+    const int bucket = zoomBucket(scale);
+    const uint8_t kind = 1;
+    uint64_t key = mixKey(path.getHash(), &kind, sizeof(kind));
+    key = mixKey(key, &stroke.width, sizeof(stroke.width));
+    key = mixKey(key, &stroke.join, sizeof(stroke.join));
+    key = mixKey(key, &stroke.cap, sizeof(stroke.cap));
+    key = mixKey(key, &stroke.miterLimit, sizeof(stroke.miterLimit));
+    key = mixKey(key, &bucket, sizeof(bucket));
+
+    bool created = false;
+    Geometry& geometry = lookup(key, path, kind, FillRule::NonZero, stroke, bucket, created);
+    if (created) {
+        geometry.rule = FillRule::NonZero;
+        buildStroke(path, stroke, kDefaultTolerance / bucketScale(bucket), geometry);
+    }
+    if (triangulate && !geometry.triangulated)
+        PathCache::triangulate(geometry);
+    return geometry;
+}
+
+// Заливка неявно замыкает каждый контур
+void PathCache::buildFill(const Path& path, float tolerance, Geometry& geometry) {
+    path.flatten(tolerance, points_, contourEnds_, closed_);
+    size_t begin = 0;
+    for (uint32_t end : contourEnds_) {
+        if (end - begin >= 3) {
+            for (size_t i = begin; i < end; ++i) {
+                const Vector2f& to = points_[i + 1 < end ? i + 1 : begin];
+                if (points_[i].y != to.y)
+                    geometry.edges.push_back(Edge{points_[i], to});
+            }
+        }
+        begin = end;
+    }
+    geometry.bounds = path.getBounds();
+}
+
+void PathCache::addPolygon(const Vector2f* points, size_t count, Geometry& geometry) {
+    float area = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        area += points[i].cross(points[(i + 1) % count]);
+    }
+    if (area == 0.0f)
+        return;
+    for (size_t i = 0; i < count; ++i) {
+        const size_t next = (i + 1) % count;
+        const Vector2f& from = area > 0.0f ? points[i] : points[next];
+        const Vector2f& to = area > 0.0f ? points[next] : points[i];
+        if (from.y != to.y)
+            geometry.edges.push_back(Edge{from, to});
+    }
+}
+
+void PathCache::addDisc(const Vector2f& center, float radius, float tolerance, Geometry& geometry) {
+    const unsigned int segments = TessellationCache::segmentsFor(radius, tolerance);
+    polygon_.resize(segments);
+    for (unsigned int i = 0; i < segments; ++i) {
+        const float angle = 2.0f * kPi * static_cast<float>(i) / static_cast<float>(segments);
+        polygon_[i] = center + Vector2f(std::cos(angle), std::sin(angle)) * radius;
+    }
+    addPolygon(polygon_.data(), polygon_.size(), geometry);
+}
+
+// Обводка — объединение четырёхугольников отрезков, клиньев соединений и концов;
+// все они обходятся в одну сторону, и заливка NonZero не оставляет швов на стыках
+void PathCache::buildStroke(const Path& path, const StrokeStyle& stroke, float tolerance, Geometry& geometry) {
+    const float half = stroke.width * 0.5f;
+    if (half <= 0.0f)
+        return;
+
+    path.flatten(tolerance, points_, contourEnds_, closed_);
+    std::vector<Vector2f> contour;
+    size_t begin = 0;
+    for (size_t c = 0; c < contourEnds_.size(); ++c) {
+        const size_t end = contourEnds_[c];
+        contour.clear();
+        for (size_t i = begin; i < end; ++i) {
+            if (contour.empty() || (points_[i] - contour.back()).length() > kMinSegmentLength)
+                contour.push_back(points_[i]);
+        }
+        begin = end;
+
+        bool closed = closed_[c] != 0;
+        if (closed && contour.size() > 1 && (contour.front() - contour.back()).length() <= kMinSegmentLength)
+            contour.pop_back();
+        if (closed && contour.size() < 3)
+            closed = false;
+        const size_t count = contour.size();
+        if (count == 0)
+            continue;
+
+        // Точка без отрезков видна только с круглым или квадратным концом
+        if (count == 1) {
+            if (stroke.cap == LineCap::Round) {
+                addDisc(contour[0], half, tolerance, geometry);
+            } else if (stroke.cap == LineCap::Square) {
+                const Vector2f& p = contour[0];
+                const Vector2f square[4] = {p + Vector2f(-half, -half), p + Vector2f(half, -half),
+                                            p + Vector2f(half, half), p + Vector2f(-half, half)};
+                addPolygon(square, 4, geometry);
+            }
+            continue;
+        }
+
+        const size_t segments = closed ? count : count - 1;
+        for (size_t i = 0; i < segments; ++i) {
+            Vector2f from = contour[i];
+            Vector2f to = contour[(i + 1) % count];
+            const Vector2f direction = (to - from).normalized();
+            if (!closed && stroke.cap == LineCap::Square) {
+                if (i == 0)
+                    from = from - direction * half;
+                if (i + 1 == segments)
+                    to = to + direction * half;
+            }
+            const Vector2f offset = leftNormal(direction) * half;
+            const Vector2f quad[4] = {from + offset, to + offset, to - offset, from - offset};
+            addPolygon(quad, 4, geometry);
+        }
+
+        // Соединение в каждой внутренней вершине; у замкнутого контура — во всех
+        const size_t firstJoin = closed ? 0 : 1;
+        const size_t lastJoin = closed ? count : count - 1;
+        for (size_t i = firstJoin; i < lastJoin; ++i) {
+            const Vector2f& p = contour[i];
+            const Vector2f& prev = contour[(i + count - 1) % count];
+            const Vector2f& next = contour[(i + 1) % count];
+            const Vector2f d0 = (p - prev).normalized();
+            const Vector2f d1 = (next - p).normalized();
+            const float turn = d0.cross(d1);
+            if (std::fabs(turn) < 1e-6f && d0.dot(d1) > 0.0f)
+                continue;
+            if (stroke.join == LineJoin::Round) {
+                addDisc(p, half, tolerance, geometry);
+                continue;
+            }
+
+            // Разрыв между отрезками на внешней стороне поворота
+            const float side = turn > 0.0f ? -1.0f : 1.0f;
+            const Vector2f n0 = leftNormal(d0) * side;
+            const Vector2f n1 = leftNormal(d1) * side;
+            const Vector2f a = p + n0 * half;
+            const Vector2f b = p + n1 * half;
+            const Vector2f bisector = n0 + n1;
+            const float cosHalf = bisector.length() * 0.5f;
+            if (stroke.join == LineJoin::Miter && cosHalf > 1e-4f && 1.0f / cosHalf <= stroke.miterLimit) {
+                const Vector2f tip = p + bisector.normalized() * (half / cosHalf);
+                const Vector2f wedge[4] = {p, a, tip, b};
+                addPolygon(wedge, 4, geometry);
+            } else {
+                const Vector2f wedge[3] = {p, a, b};
+                addPolygon(wedge, 3, geometry);
+            }
+        }
+
+        if (!closed && stroke.cap == LineCap::Round) {
+            addDisc(contour.front(), half, tolerance, geometry);
+            addDisc(contour.back(), half, tolerance, geometry);
+        }
+    }
+    geometry.bounds = strokeBounds(path.getBounds(), stroke);
+}
+
+// Плоскость режется на горизонтальные полосы по концам рёбер и точкам их
+// пересечения; внутри полосы рёбра не пересекаются, и каждая закрашенная
+// часть между соседними рёбрами — трапеция из двух треугольников
+void PathCache::triangulate(Geometry& geometry) {
+    geometry.triangles.clear();
+    geometry.triangulated = true;
+
+    std::vector<float> ys;
+    ys.reserve(geometry.edges.size() * 2);
+    for (const Edge& edge : geometry.edges) {
+        ys.push_back(edge.from.y);
+        ys.push_back(edge.to.y);
+    }
+    std::sort(ys.begin(), ys.end());
+    ys.erase(std::unique(ys.begin(), ys.end()), ys.end());
+
+    std::vector<BandEdge> band;
+    for (size_t b = 0; b + 1 < ys.size(); ++b) {
+        float top = ys[b];
+        const float bottom = ys[b + 1];
+        while (top < bottom) {
+            band.clear();
+            for (const Edge& edge : geometry.edges) {
+                const bool down = edge.from.y < edge.to.y;
+                const Vector2f& upper = down ? edge.from : edge.to;
+                const Vector2f& lower = down ? edge.to : edge.from;
+                if (upper.y > top || lower.y < bottom)
+                    continue;
+                const float slope = (lower.x - upper.x) / (lower.y - upper.y);
+                band.push_back(BandEdge{upper.x + (top - upper.y) * slope, upper.x + (bottom - upper.y) * slope,
+                                        down ? 1 : -1});
+            }
+            std::sort(band.begin(), band.end(), [](const BandEdge& l, const BandEdge& r) {
+                return l.top < r.top || (l.top == r.top && l.bottom < r.bottom);
+            });
+
+            // Рёбра упорядочены по верхней кромке, поэтому ближайшее пересечение
+            // приходится на соседнюю пару; оно закрывает полосу
+            float split = bottom;
+            for (size_t i = 0; i + 1 < band.size(); ++i) {
+                const float atTop = band[i + 1].top - band[i].top;
+                const float atBottom = band[i + 1].bottom - band[i].bottom;
+                if (atTop * atBottom < 0.0f)
+                    split = std::min(split, top + (bottom - top) * atTop / (atTop - atBottom));
+            }
+            if (!(split > top))
+                split = bottom;
+            const float t = (split - top) / (bottom - top);
+
+            int winding = 0;
+            for (size_t i = 0; i + 1 < band.size(); ++i) {
+                winding += band[i].winding;
+                if (!isInside(winding, geometry.rule))
+                    continue;
+                const BandEdge& l = band[i];
+                const BandEdge& r = band[i + 1];
+                const Vector2f lt(l.top, top), rt(r.top, top);
+                const Vector2f lb(l.top + (l.bottom - l.top) * t, split);
+                const Vector2f rb(r.top + (r.bottom - r.top) * t, split);
+                geometry.triangles.insert(geometry.triangles.end(), {lt, rt, rb, lt, rb, lb});
+            }
+            top = split;
+        }
+    }
+}
+
+} // namespace gui
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "../core/math_types.hpp"
+#include "../core/path.hpp"
+#include "lru_cache.hpp"
+
+namespace gui {
+
+// Кэш геометрии векторных путей в локальных координатах пути: рёбра заливки
+// и многоугольники обводки с соединениями и концами. Ключ — хэш содержимого
+// пути, стиль и ступень масштаба: ломаная строится с допуском в пикселях
+// устройства, поэтому путь, перерисованный без изменений в том же масштабе,
+// заново не делится и не тесселируется. Запись хранит копию команд и точек
+// пути, и попадание сверяется с ней, чтобы коллизия хэша не подменила
+// геометрию. Не потокобезопасен.
+class PathCache {
+public:
+    // Ориентированное ребро; направление задаёт знак пересечения для правила заполнения
+    struct Edge {
+        Vector2f from;
+        Vector2f to;
+    };
+
+    struct Geometry {
+        std::vector<Edge> edges;
+        // Обводка — объединение многоугольников одного направления,
+        // поэтому всегда заливается по NonZero
+        FillRule rule = FillRule::NonZero;
+        Rect bounds;
+        // Треугольники (по три точки) для бэкендов без собственной заливки путей;
+        // строятся по запросу один раз на запись
+        std::vector<Vector2f> triangles;
+        bool triangulated = false;
+    };
+
+    using Stats = CacheStats;
+
+    // Отклонение хорды от кривой, в пикселях устройства
+    static constexpr float kDefaultTolerance = 0.25f;
+
+    explicit PathCache(size_t capacity = 128);
+
+    // scale — пикселей устройства на единицу пути. Ссылка действительна
+    // до следующего get*() или clear()
+    const Geometry& getFill(const Path& path, FillRule rule, float scale, bool triangulate = false);
+    const Geometry& getStroke(const Path& path, const StrokeStyle& stroke, float scale, bool triangulate = false);
+
+    // Ступень — пол-октавы масштаба; геометрия строится для верхней границы ступени
+    static int zoomBucket(float scale);
+    static float bucketScale(int bucket);
+
+    void clear() { cache_.clear(); }
+    void setCapacity(size_t capacity) { cache_.setCapacity(capacity); }
+    const Stats& getStats() const { return cache_.getStats(); }
+    void resetStats() { cache_.resetStats(); }
+
+private:
+    struct Entry {
+        // Всё, из чего построена геометрия, для сверки при попадании
+        uint8_t kind = 0;
+        int bucket = 0;
+        FillRule rule = FillRule::NonZero;
+        StrokeStyle stroke;
+        std::vector<Path::Verb> verbs;
+        std::vector<Vector2f> points;
+        Geometry geometry;
+    };
+
+    Geometry& lookup(uint64_t key, const Path& path, uint8_t kind, FillRule rule, const StrokeStyle& stroke,
+                     int bucket, bool& created);
+    static bool matches(const Entry& entry, const Path& path, uint8_t kind, FillRule rule,
+                        const StrokeStyle& stroke, int bucket);
+    void buildFill(const Path& path, float tolerance, Geometry& geometry);
+    void buildStroke(const Path& path, const StrokeStyle& stroke, float tolerance, Geometry& geometry);
+    // Многоугольник приводится к положительному обходу, чтобы перекрытия не вычитались
+    void addPolygon(const Vector2f* points, size_t count, Geometry& geometry);
+    void addDisc(const Vector2f& center, float radius, float tolerance, Geometry& geometry);
+    static void triangulate(Geometry& geometry);
+
+    LruCache<Entry> cache_;
+    std::vector<Vector2f> points_;
+    std::vector<uint32_t> contourEnds_;
+    std::vector<uint8_t> closed_;
+    std::vector<Vector2f> polygon_;
+};
+
+} // namespace gui
\ No newline at end of file
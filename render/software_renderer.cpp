@@ -0,0 +1,1900 @@
+#include "software_renderer.hpp"
+#include "glyph_cache.hpp"
+#include "../utils/thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace gui {
+
+namespace {
+
+// Классический растровый шрифт 5x7 для символов 0x20..0x7E.
+// Каждый байт — столбец глифа, младший бит — верхняя строка.
+const uint8_t kFont5x7[95][5] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00},
+    {0x14, 0x7F, 0x14, 0x7F, 0x14}, {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62},
+    {0x36, 0x49, 0x55, 0x22, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00}, {0x00, 0x1C, 0x22, 0x41, 0x00},
+    {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x14, 0x08, 0x3E, 0x08, 0x14}, {0x08, 0x08, 0x3E, 0x08, 0x08},
+    {0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x60, 0x60, 0x00, 0x00},
+    {0x20, 0x10, 0x08, 0x04, 0x02}, {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00},
+    {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4B, 0x31}, {0x18, 0x14, 0x12, 0x7F, 0x10},
+    {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03},
+    {0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x36, 0x36, 0x00, 0x00},
+    {0x00, 0x56, 0x36, 0x00, 0x00}, {0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14},
+    {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06}, {0x32, 0x49, 0x79, 0x41, 0x3E},
+    {0x7E, 0x11, 0x11, 0x11, 0x7E}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22},
+    {0x7F, 0x41, 0x41, 0x22, 0x1C}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x09, 0x01},
+    {0x3E, 0x41, 0x49, 0x49, 0x7A}, {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00},
+    {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41}, {0x7F, 0x40, 0x40, 0x40, 0x40},
+    {0x7F, 0x02, 0x0C, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E},
+    {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46},
+    {0x46, 0x49, 0x49, 0x49, 0x31}, {0x01, 0x01, 0x7F, 0x01, 0x01}, {0x3F, 0x40, 0x40, 0x40, 0x3F},
+    {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x3F, 0x40, 0x38, 0x40, 0x3F}, {0x63, 0x14, 0x08, 0x14, 0x63},
+    {0x07, 0x08, 0x70, 0x08, 0x07}, {0x61, 0x51, 0x49, 0x45, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x00},
+    {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x7F, 0x00}, {0x04, 0x02, 0x01, 0x02, 0x04},
+    {0x40, 0x40, 0x40, 0x40, 0x40}, {0x00, 0x01, 0x02, 0x04, 0x00}, {0x20, 0x54, 0x54, 0x54, 0x78},
+    {0x7F, 0x48, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x20}, {0x38, 0x44, 0x44, 0x48, 0x7F},
+    {0x38, 0x54, 0x54, 0x54, 0x18}, {0x08, 0x7E, 0x09, 0x01, 0x02}, {0x0C, 0x52, 0x52, 0x52, 0x3E},
+    {0x7F, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7D, 0x40, 0x00}, {0x20, 0x40, 0x44, 0x3D, 0x00},
+    {0x7F, 0x10, 0x28, 0x44, 0x00}, {0x00, 0x41, 0x7F, 0x40, 0x00}, {0x7C, 0x04, 0x18, 0x04, 0x78},
+    {0x7C, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38}, {0x7C, 0x14, 0x14, 0x14, 0x08},
+    {0x08, 0x14, 0x14, 0x18, 0x7C}, {0x7C, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x20},
+    {0x04, 0x3F, 0x44, 0x40, 0x20}, {0x3C, 0x40, 0x40, 0x20, 0x7C}, {0x1C, 0x20, 0x40, 0x20, 0x1C},
+    {0x3C, 0x40, 0x30, 0x40, 0x3C}, {0x44, 0x28, 0x10, 0x28, 0x44}, {0x0C, 0x50, 0x50, 0x50, 0x3C},
+    {0x44, 0x64, 0x54, 0x4C, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00}, {0x00, 0x00, 0x7F, 0x00, 0x00},
+    {0x00, 0x41, 0x36, 0x08, 0x00}, {0x10, 0x08, 0x08, 0x10, 0x08}
+};
+
+constexpr float kGlyphCellWidth = 6.0f;
+constexpr float kGlyphCellHeight = 8.0f;
+
+// Индекс глифа в kFont5x7; непечатаемые символы заменяются на '?'
+inline uint8_t glyphIndex(char ch) {
+    unsigned char code = static_cast<unsigned char>(ch);
+    if (code < 0x20 || code > 0x7E)
+        code = '?';
+    return static_cast<uint8_t>(code - 0x20);
+}
+
+// Шейпинг для моноширинного шрифта 5x7: разбиение на строки и индексы глифов
+void shapeText(const std::string& text, const std::string& font, float size, GlyphRun& run) {
+    (void)font;
+    const float scale = size / kGlyphCellHeight;
+    run.glyphs.reserve(text.size());
+
+    float longest = 0.0f;
+    size_t lineStart = 0;
+    while (lineStart <= text.size()) {
+        size_t lineEnd = text.find('\n', lineStart);
+        if (lineEnd == std::string::npos)
+            lineEnd = text.size();
+
+        GlyphLine line;
+        line.firstGlyph = static_cast<uint32_t>(run.glyphs.size());
+        line.glyphCount = static_cast<uint32_t>(lineEnd - lineStart);
+        line.offsetY = run.lines.size() * kGlyphCellHeight * scale;
+        line.width = line.glyphCount * kGlyphCellWidth * scale;
+        for (size_t i = lineStart; i < lineEnd; ++i) {
+            PositionedGlyph glyph;
+            glyph.glyph = glyphIndex(text[i]);
+            glyph.position = Vector2f((i - lineStart) * kGlyphCellWidth * scale, line.offsetY);
+            run.glyphs.push_back(glyph);
+        }
+        run.lines.push_back(line);
+        longest = std::max(longest, line.width);
+        lineStart = lineEnd + 1;
+    }
+
+    run.size = Vector2f(longest, run.lines.size() * kGlyphCellHeight * scale);
+}
+
+// Целочисленный прямоугольник в пикселях устройства, [x0, x1) x [y0, y1)
+struct PixelRect {
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+
+    bool empty() const { return x0 >= x1 || y0 >= y1; }
+
+    bool contains(const PixelRect& other) const {
+        return other.x0 >= x0 && other.y0 >= y0 && other.x1 <= x1 && other.y1 <= y1;
+    }
+
+    PixelRect intersect(const PixelRect& other) const {
+        PixelRect r;
+        r.x0 = std::max(x0, other.x0);
+        r.y0 = std::max(y0, other.y0);
+        r.x1 = std::min(x1, other.x1);
+        r.y1 = std::min(y1, other.y1);
+        return r;
+    }
+
+    static PixelRect fromBounds(float minX, float minY, float maxX, float maxY) {
+        PixelRect r;
+        r.x0 = static_cast<int>(std::floor(minX));
+        r.y0 = static_cast<int>(std::floor(minY));
+        r.x1 = static_cast<int>(std::ceil(maxX));
+        r.y1 = static_cast<int>(std::ceil(maxY));
+        return r;
+    }
+};
+
+// Ребро выпуклого многоугольника: a*x + b*y + c — знаковое расстояние, внутри > 0
+struct Edge {
+    float a = 0.0f, b = 0.0f, c = 0.0f;
+};
+
+enum class CommandKind : uint8_t {
+    Clear,
+    Rect,
+    Polygon,
+    Ring,
+    Image,
+    Text,
+    Shape,
+    Path
+};
+
+struct SoftwareTexture;
+
+struct Command {
+    CommandKind kind = CommandKind::Rect;
+    BlendMode blend = BlendMode::Alpha;
+    bool antialias = true;
+    uint8_t edgeCount = 0;
+    PixelRect bounds;
+    float color[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+    // Rect: x0, y0, x1, y1 в координатах устройства; Image: локальный прямоугольник назначения
+    float rect[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    // Polygon
+    Edge edges[4];
+    // Ring: innerRadius < 0 означает заполненный круг
+    Vector2f center;
+    float outerRadius = 0.0f;
+    float innerRadius = -1.0f;
+    // Image / Text: обратное преобразование из устройства в локальные координаты
+    Affine inverse;
+    const SoftwareTexture* texture = nullptr;
+    // Image: область-источник в пикселях текстуры
+    float source[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    uint32_t textOffset = 0;
+    uint32_t textLength = 0;
+    float glyphScale = 1.0f;
+    // Shape: индекс параметров в списке фигур кадра
+    uint32_t shapeIndex = 0;
+    // Path: индекс диапазона рёбер в списке путей кадра
+    uint32_t pathIndex = 0;
+};
+
+// Параметры фигуры в её локальных координатах. Их больше, чем у остальных команд,
+// поэтому они лежат отдельно, и Command не растёт
+struct ShapeParams {
+    Vector2f center;
+    Vector2f halfSize;
+    float radii[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    float border[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    float shadow[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    float borderWidth = 0.0f;
+    Vector2f shadowOffset;
+    float shadowSigma = 0.0f;
+    float pixelScale = 1.0f;    // пикселей устройства на локальную единицу
+};
+
+// Ребро пути в координатах устройства, сверху вниз; winding — знак исходного направления
+struct PathEdge {
+    float x0;
+    float y0;
+    float y1;
+    float slope;    // приращение x на единицу y
+    int winding;
+};
+
+struct PathParams {
+    uint32_t edgeBegin = 0;
+    uint32_t edgeCount = 0;
+    FillRule rule = FillRule::NonZero;
+};
+
+// Подстрок на строку пикселей при заливке пути
+constexpr int kPathSamples = 4;
+
+struct SoftwareTexture {
+    unsigned int width = 0;
+    unsigned int height = 0;
+    std::vector<uint8_t> rgba;
+};
+
+// Переводит изображение любого поддерживаемого формата в RGBA8
+SoftwareTexture makeTexture(const utils::Image& image) {
+    SoftwareTexture texture;
+    texture.width = image.getWidth();
+    texture.height = image.getHeight();
+    const size_t pixels = static_cast<size_t>(texture.width) * texture.height;
+    texture.rgba.resize(pixels * 4);
+
+    const uint8_t* src = image.getData();
+    uint8_t* dst = texture.rgba.data();
+    for (size_t i = 0; i < pixels; ++i, dst += 4) {
+        switch (image.getFormat()) {
+            case utils::Image::Format::RGBA:
+                std::memcpy(dst, src + i * 4, 4);
+                break;
+            case utils::Image::Format::BGRA:
+                dst[0] = src[i * 4 + 2]; dst[1] = src[i * 4 + 1];
+                dst[2] = src[i * 4];     dst[3] = src[i * 4 + 3];
+                break;
+            case utils::Image::Format::RGB:
+                dst[0] = src[i * 3]; dst[1] = src[i * 3 + 1];
+                dst[2] = src[i * 3 + 2]; dst[3] = 255;
+                break;
+            case utils::Image::Format::BGR:
+                dst[0] = src[i * 3 + 2]; dst[1] = src[i * 3 + 1];
+                dst[2] = src[i * 3];     dst[3] = 255;
+                break;
+            case utils::Image::Format::Grayscale:
+                dst[0] = dst[1] = dst[2] = src[i];
+                dst[3] = 255;
+                break;
+        }
+    }
+    return texture;
+}
+
+// Девятисрезовое изображение в пикселях устройства: границы частей в источнике
+// и границы столбцов и строк собранного изображения
+struct NineSliceKey {
+    const SoftwareTexture* texture = nullptr;
+    float sourceX[4];
+    float sourceY[4];
+    int32_t columns[4];
+    int32_t rows[4];
+
+    bool operator==(const NineSliceKey& other) const {
+        return texture == other.texture &&
+               std::memcmp(sourceX, other.sourceX, sizeof(sourceX)) == 0 &&
+               std::memcmp(sourceY, other.sourceY, sizeof(sourceY)) == 0 &&
+               std::memcmp(columns, other.columns, sizeof(columns)) == 0 &&
+               std::memcmp(rows, other.rows, sizeof(rows)) == 0;
+    }
+};
+
+struct NineSliceKeyHash {
+    size_t operator()(const NineSliceKey& key) const {
+        // FNV-1a по полям ключа; в структуре нет выравнивающих промежутков
+        const auto* bytes = reinterpret_cast<const uint8_t*>(&key);
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < sizeof(NineSliceKey); ++i) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+        return static_cast<size_t>(hash);
+    }
+};
+
+// Для каждого пикселя оси — тексель источника: внутри части отображение линейное,
+// поэтому углы в масштабе 1 копируются без изменений
+void mapSliceAxis(const float* source, const int32_t* bounds, std::vector<uint32_t>& texels) {
+    texels.resize(static_cast<size_t>(bounds[3]));
+    for (int part = 0; part < 3; ++part) {
+        const int32_t begin = bounds[part];
+        const int32_t end = bounds[part + 1];
+        if (end <= begin)
+            continue;
+        const float step = (source[part + 1] - source[part]) / static_cast<float>(end - begin);
+        const float first = std::floor(source[part]);
+        const float last = std::max(first, std::ceil(source[part + 1]) - 1.0f);
+        for (int32_t i = begin; i < end; ++i) {
+            const float texel = std::floor(source[part] + (static_cast<float>(i - begin) + 0.5f) * step);
+            texels[static_cast<size_t>(i)] = static_cast<uint32_t>(std::clamp(texel, first, last));
+        }
+    }
+}
+
+SoftwareTexture composeNineSlice(const NineSliceKey& key) {
+    thread_local std::vector<uint32_t> t_columns;
+    thread_local std::vector<uint32_t> t_rows;
+    mapSliceAxis(key.sourceX, key.columns, t_columns);
+    mapSliceAxis(key.sourceY, key.rows, t_rows);
+
+    const SoftwareTexture& source = *key.texture;
+    SoftwareTexture result;
+    result.width = static_cast<unsigned int>(key.columns[3]);
+    result.height = static_cast<unsigned int>(key.rows[3]);
+    result.rgba.resize(static_cast<size_t>(result.width) * result.height * 4);
+    uint8_t* dst = result.rgba.data();
+    for (unsigned int y = 0; y < result.height; ++y) {
+        const uint8_t* row = &source.rgba[static_cast<size_t>(t_rows[y]) * source.width * 4];
+        for (unsigned int x = 0; x < result.width; ++x, dst += 4) {
+            std::memcpy(dst, row + static_cast<size_t>(t_columns[x]) * 4, 4);
+        }
+    }
+    return result;
+}
+
+inline float clamp01(float v) {
+    return v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+}
+
+inline uint8_t toByte(float v) {
+    return static_cast<uint8_t>(clamp01(v) * 255.0f + 0.5f);
+}
+
+inline void blendPixel(uint8_t* dst, const float* src, float coverage, BlendMode mode) {
+    const float sa = src[3] * coverage;
+    if (sa <= 0.0f && mode != BlendMode::None)
+        return;
+
+    const float inv = 1.0f / 255.0f;
+    const float dr = dst[0] * inv, dg = dst[1] * inv, db = dst[2] * inv, da = dst[3] * inv;
+    float r, g, b, a;
+
+    switch (mode) {
+        case BlendMode::None:
+            r = dr + (src[0] - dr) * coverage;
+            g = dg + (src[1] - dg) * coverage;
+            b = db + (src[2] - db) * coverage;
+            a = da + (src[3] - da) * coverage;
+            break;
+        case BlendMode::Alpha: {
+            a = sa + da * (1.0f - sa);
+            if (a <= 0.0f) {
+                r = g = b = 0.0f;
+                break;
+            }
+            const float dw = da * (1.0f - sa);
+            const float invA = 1.0f / a;
+            r = (src[0] * sa + dr * dw) * invA;
+            g = (src[1] * sa + dg * dw) * invA;
+            b = (src[2] * sa + db * dw) * invA;
+            break;
+        }
+        case BlendMode::Additive:
+            r = dr + src[0] * sa;
+            g = dg + src[1] * sa;
+            b = db + src[2] * sa;
+            a = da + sa;
+            break;
+        case BlendMode::Multiply:
+            r = dr * (1.0f + (src[0] - 1.0f) * sa);
+            g = dg * (1.0f + (src[1] - 1.0f) * sa);
+            b = db * (1.0f + (src[2] - 1.0f) * sa);
+            a = da;
+            break;
+        case BlendMode::Screen:
+            r = 1.0f - (1.0f - dr) * (1.0f - src[0] * sa);
+            g = 1.0f - (1.0f - dg) * (1.0f - src[1] * sa);
+            b = 1.0f - (1.0f - db) * (1.0f - src[2] * sa);
+            a = da + sa * (1.0f - da);
+            break;
+        default:
+            return;
+    }
+
+    dst[0] = toByte(r);
+    dst[1] = toByte(g);
+    dst[2] = toByte(b);
+    dst[3] = toByte(a);
+}
+
+// Знаковое расстояние от точки p до скруглённого прямоугольника с центром в начале
+// координат; отрицательно внутри. Радиус берётся по четверти, в которой лежит точка
+inline float roundedBoxDistance(const Vector2f& p, const Vector2f& halfSize, const float* radii) {
+    const float radius = p.x < 0.0f ? (p.y < 0.0f ? radii[0] : radii[3]) : (p.y < 0.0f ? radii[1] : radii[2]);
+    const float qx = std::fabs(p.x) - halfSize.x + radius;
+    const float qy = std::fabs(p.y) - halfSize.y + radius;
+    const float ox = std::max(qx, 0.0f);
+    const float oy = std::max(qy, 0.0f);
+    return std::min(std::max(qx, qy), 0.0f) + std::sqrt(ox * ox + oy * oy) - radius;
+}
+
+// Тень слабее этой доли не меняет ни одного байта пикселя
+constexpr float kMinShadowAlpha = 1.0f / 512.0f;
+
+// Команда целиком перекрывает пиксель, не смешиваясь с фоном
+inline bool isOpaqueWrite(const Command& cmd) {
+    return cmd.blend == BlendMode::None ||
+           (cmd.blend == BlendMode::Alpha && cmd.color[3] >= 1.0f);
+}
+
+// Цвета тепловой карты перерисовки: индекс — число записей пикселя, последний
+// цвет для всех значений от него и выше
+const uint8_t kOverdrawPalette[7][4] = {
+    {0, 0, 0, 255},         // не рисовался
+    {90, 90, 90, 255},      // записан один раз
+    {40, 90, 230, 255},
+    {40, 200, 70, 255},
+    {240, 220, 40, 255},
+    {245, 130, 30, 255},
+    {230, 30, 30, 255}
+};
+
+inline uint32_t packColor(const float* color) {
+    const uint8_t bytes[4] = {toByte(color[0]), toByte(color[1]), toByte(color[2]), toByte(color[3])};
+    uint32_t packed;
+    std::memcpy(&packed, bytes, sizeof(packed));
+    return packed;
+}
+
+} // namespace
+
+struct SoftwareRenderer::Implementation {
+    Config config;
+    utils::Image ownTarget;
+    utils::Image* target = &ownTarget;
+    std::unique_ptr<utils::ThreadPool> pool;
+
+    std::vector<Command> commands;
+    std::string textArena;
+    std::vector<ShapeParams> shapes;
+    std::vector<PathParams> paths;
+    std::vector<PathEdge> pathEdges;
+    // Геометрия путей в локальных координатах; используется только потоком записи
+    PathCache pathCache;
+    std::vector<Vector2f> pathPoints;
+
+    std::vector<Affine> transformStack;
+    std::vector<PixelRect> clipStack;
+    Affine viewportTransform;
+    PixelRect viewportClip;
+    BlendMode blendMode = BlendMode::Alpha;
+    bool antialiasing = true;
+
+    // Тайловая раскладка
+    unsigned int tilesX = 0;
+    unsigned int tilesY = 0;
+    std::vector<std::vector<uint32_t>> tileBins;
+    std::vector<uint32_t> activeTiles;
+
+    // Таблица дескрипторов: регионы ссылаются на ту же текстуру, что и изображение.
+    // Текстуры не перемещаются, поэтому команды кадра держат указатели на них,
+    // а растеризация не читает таблицу, которую может дополнять поток записи.
+    struct ImageEntry {
+        const SoftwareTexture* texture = nullptr;
+        float source[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    };
+
+    std::vector<std::unique_ptr<SoftwareTexture>> textures;
+    std::vector<ImageEntry> images;
+    // Заменённые и освобождённые текстуры живут до начала следующего кадра
+    std::vector<std::unique_ptr<SoftwareTexture>> retiredTextures;
+    std::unordered_map<std::string, uint32_t> imageIndex;
+
+    Renderer::CullStats* cullStats = nullptr;
+    RenderStats* renderStats = nullptr;
+
+    // Диагностика перерисовки: число записей каждого пикселя за кадр.
+    // overdrawData ненулевой только в кадре, начатом с включённым режимом.
+    // Запрошенный режим читается в beginFrame() и действует до конца кадра,
+    // поэтому смена режима посреди кадра не трогает буфер, в который пишут потоки
+    std::atomic<OverdrawMode> overdrawMode{OverdrawMode::Off};
+    OverdrawMode frameOverdrawMode = OverdrawMode::Off;
+    std::vector<uint32_t> overdraw;
+    uint32_t* overdrawData = nullptr;
+    OverdrawStats overdrawStats;
+
+    // Общий для drawText и getTextSize
+    GlyphRunCache glyphRuns;
+    // Измерения приходят и с потоков параллельной записи поддеревьев
+    std::mutex measureMutex;
+
+    // Собранные девятисрезовые изображения, LRU под measureMutex. Вытесненные
+    // текстуры уходят в retiredTextures: их могут читать команды кадра
+    struct NineSliceEntry {
+        NineSliceKey key;
+        std::unique_ptr<SoftwareTexture> texture;
+    };
+    std::list<NineSliceEntry> nineSlices;
+    std::unordered_map<NineSliceKey, std::list<NineSliceEntry>::iterator, NineSliceKeyHash> nineSliceIndex;
+    size_t nineSliceBudget = 16u << 20;
+    NineSliceCacheStats nineSliceStats;
+
+    explicit Implementation(const Config& cfg) : config(cfg) {
+        if (config.tileSize == 0)
+            config.tileSize = 64;
+
+        unsigned int threads = config.threadCount;
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        if (threads > 1)
+            pool = std::make_unique<utils::ThreadPool>(threads - 1);
+    }
+
+    unsigned int width() const { return target->getWidth(); }
+    unsigned int height() const { return target->getHeight(); }
+
+    void resetState() {
+        transformStack.assign(1, viewportTransform);
+        clipStack.assign(1, viewportClip);
+        blendMode = BlendMode::Alpha;
+    }
+
+    void resetViewport() {
+        viewportTransform = Affine();
+        viewportClip = PixelRect{0, 0, static_cast<int>(width()), static_cast<int>(height())};
+        resetState();
+    }
+
+    void layoutTiles() {
+        tilesX = (width() + config.tileSize - 1) / config.tileSize;
+        tilesY = (height() + config.tileSize - 1) / config.tileSize;
+        tileBins.assign(static_cast<size_t>(tilesX) * tilesY, {});
+    }
+
+    const Affine& currentTransform() const { return transformStack.back(); }
+    const PixelRect& currentClip() const { return clipStack.back(); }
+
+    Command makeCommand(CommandKind kind, const Color& color) const {
+        Command cmd;
+        cmd.kind = kind;
+        cmd.blend = blendMode;
+        cmd.antialias = antialiasing;
+        cmd.color[0] = color.r;
+        cmd.color[1] = color.g;
+        cmd.color[2] = color.b;
+        cmd.color[3] = color.a;
+        return cmd;
+    }
+
+    void submit(Command& cmd, float minX, float minY, float maxX, float maxY) {
+        const PixelRect full = PixelRect::fromBounds(minX, minY, maxX, maxY);
+        cmd.bounds = full.intersect(currentClip());
+        if (cmd.bounds.empty()) {
+            ++cullStats->culledDraws;
+            return;
+        }
+        if (currentClip().contains(full))
+            ++cullStats->acceptedDraws;
+        else
+            ++cullStats->clippedDraws;
+        commands.push_back(cmd);
+        countPixels(cmd.bounds);
+    }
+
+    // Растеризатор проходит каждый пиксель рамки команды ровно один раз
+    void countPixels(const PixelRect& bounds) {
+        ++renderStats->primitives;
+        renderStats->pixelsFilled += static_cast<uint64_t>(bounds.x1 - bounds.x0) *
+                                     static_cast<uint64_t>(bounds.y1 - bounds.y0);
+    }
+
+    // Выпуклый многоугольник из 3 или 4 вершин в координатах устройства
+    void submitPolygon(const Vector2f* points, int count, const Color& color) {
+        Command cmd = makeCommand(CommandKind::Polygon, color);
+
+        // Приводим обход к одному направлению, чтобы «внутри» было положительным
+        float area = 0.0f;
+        for (int i = 0; i < count; ++i) {
+            const Vector2f& p = points[i];
+            const Vector2f& q = points[(i + 1) % count];
+            area += p.x * q.y - q.x * p.y;
+        }
+        if (std::fabs(area) < 1e-6f)
+            return;
+        const float orientation = area > 0.0f ? 1.0f : -1.0f;
+
+        float minX = points[0].x, maxX = points[0].x;
+        float minY = points[0].y, maxY = points[0].y;
+        for (int i = 0; i < count; ++i) {
+            const Vector2f& p = points[i];
+            const Vector2f& q = points[(i + 1) % count];
+            const float ex = q.x - p.x;
+            const float ey = q.y - p.y;
+            const float length = std::sqrt(ex * ex + ey * ey);
+            Edge& edge = cmd.edges[cmd.edgeCount++];
+            if (length > 0.0f) {
+                edge.a = -ey / length * orientation;
+                edge.b = ex / length * orientation;
+                edge.c = -(edge.a * p.x + edge.b * p.y);
+            } else {
+                // Вырожденное ребро не ограничивает область
+                edge.c = 1e9f;
+            }
+
+            minX = std::min(minX, p.x);
+            maxX = std::max(maxX, p.x);
+            minY = std::min(minY, p.y);
+            maxY = std::max(maxY, p.y);
+        }
+
+        submit(cmd, minX - 1.0f, minY - 1.0f, maxX + 1.0f, maxY + 1.0f);
+    }
+
+    // Прямоугольник в локальных координатах; при повороте становится многоугольником
+    void submitLocalRect(float x0, float y0, float x1, float y1, const Color& color) {
+        const Affine& m = currentTransform();
+        if (m.isAxisAligned()) {
+            const Vector2f p0 = m.apply(Vector2f(x0, y0));
+            const Vector2f p1 = m.apply(Vector2f(x1, y1));
+            Command cmd = makeCommand(CommandKind::Rect, color);
+            cmd.rect[0] = std::min(p0.x, p1.x);
+            cmd.rect[1] = std::min(p0.y, p1.y);
+            cmd.rect[2] = std::max(p0.x, p1.x);
+            cmd.rect[3] = std::max(p0.y, p1.y);
+            if (!cmd.antialias) {
+                // Без сглаживания края привязываются к центрам пикселей
+                for (float& edge : cmd.rect) {
+                    edge = std::floor(edge + 0.5f);
+                }
+            }
+            submit(cmd, cmd.rect[0], cmd.rect[1], cmd.rect[2], cmd.rect[3]);
+            return;
+        }
+
+        const Vector2f points[4] = {
+            m.apply(Vector2f(x0, y0)), m.apply(Vector2f(x1, y0)),
+            m.apply(Vector2f(x1, y1)), m.apply(Vector2f(x0, y1))
+        };
+        submitPolygon(points, 4, color);
+    }
+
+    void submitLine(const Vector2f& start, const Vector2f& end, const Color& color, float thickness) {
+        const Vector2f delta = end - start;
+        const float length = delta.length();
+        if (length < 0.0001f)
+            return;
+
+        const Vector2f normal = Vector2f(-delta.y, delta.x) * (thickness * 0.5f / length);
+        const Affine& m = currentTransform();
+        const Vector2f points[4] = {
+            m.apply(start + normal), m.apply(end + normal),
+            m.apply(end - normal), m.apply(start - normal)
+        };
+        submitPolygon(points, 4, color);
+    }
+
+    void submitRing(const Vector2f& center, float outer, float inner, const Color& color) {
+        const Affine& m = currentTransform();
+        Command cmd = makeCommand(CommandKind::Ring, color);
+        cmd.center = m.apply(center);
+        const float scale = m.scaleFactor();
+        cmd.outerRadius = outer * scale;
+        cmd.innerRadius = inner < 0.0f ? -1.0f : inner * scale;
+        if (cmd.outerRadius <= 0.0f)
+            return;
+        submit(cmd, cmd.center.x - cmd.outerRadius - 1.0f, cmd.center.y - cmd.outerRadius - 1.0f,
+               cmd.center.x + cmd.outerRadius + 1.0f, cmd.center.y + cmd.outerRadius + 1.0f);
+    }
+
+    // Тень, заливка и рамка одной командой; растеризатор проходит рамку тени один раз
+    void submitShape(const Rect& rect, const ShapeStyle& style) {
+        if (rect.size.x <= 0.0f || rect.size.y <= 0.0f)
+            return;
+        const float pixelScale = currentTransform().scaleFactor();
+        if (pixelScale <= 0.0f)
+            return;
+
+        ShapeParams shape;
+        shape.halfSize = rect.size * 0.5f;
+        shape.center = rect.position + shape.halfSize;
+        const float limit = std::min(shape.halfSize.x, shape.halfSize.y);
+        for (int i = 0; i < 4; ++i) {
+            shape.radii[i] = std::clamp(style.radii[i], 0.0f, limit);
+        }
+        const Color* colors[2] = {&style.border, &style.shadow};
+        float* targets[2] = {shape.border, shape.shadow};
+        for (int i = 0; i < 2; ++i) {
+            targets[i][0] = colors[i]->r;
+            targets[i][1] = colors[i]->g;
+            targets[i][2] = colors[i]->b;
+            targets[i][3] = colors[i]->a;
+        }
+        shape.borderWidth = std::clamp(style.borderWidth, 0.0f, limit);
+        shape.shadowOffset = style.shadowOffset;
+        shape.shadowSigma = std::max(style.shadowBlur, 0.0f) * 0.5f;
+        shape.pixelScale = pixelScale;
+
+        Command cmd = makeCommand(CommandKind::Shape, style.fill);
+        cmd.shapeIndex = static_cast<uint32_t>(shapes.size());
+        shapes.push_back(shape);
+
+        // Полпикселя сглаживания за контуром
+        const Rect bounds = shapeBounds(rect, style);
+        const float margin = 1.0f / pixelScale;
+        const size_t submitted = commands.size();
+        submitMapped(cmd, bounds.position.x - margin, bounds.position.y - margin,
+                     bounds.position.x + bounds.size.x + margin, bounds.position.y + bounds.size.y + margin);
+        if (commands.size() == submitted)
+            shapes.pop_back();
+    }
+
+    // Рёбра переводятся в устройство и сортируются по верхнему концу: растеризатор
+    // добавляет их в активный список по мере продвижения подстрок
+    void submitPath(const PathCache::Geometry& geometry, const Color& color) {
+        if (geometry.edges.empty())
+            return;
+        const size_t count = geometry.edges.size();
+        pathPoints.resize(count * 2);
+        currentTransform().transformPoints(&geometry.edges[0].from, pathPoints.data(), count * 2);
+
+        PathParams params;
+        params.edgeBegin = static_cast<uint32_t>(pathEdges.size());
+        params.rule = geometry.rule;
+        float minX = pathPoints[0].x, maxX = minX, minY = pathPoints[0].y, maxY = minY;
+        for (size_t i = 0; i < count; ++i) {
+            const Vector2f& from = pathPoints[i * 2];
+            const Vector2f& to = pathPoints[i * 2 + 1];
+            minX = std::min(minX, std::min(from.x, to.x));
+            maxX = std::max(maxX, std::max(from.x, to.x));
+            minY = std::min(minY, std::min(from.y, to.y));
+            maxY = std::max(maxY, std::max(from.y, to.y));
+            if (from.y == to.y)
+                continue;
+            const bool down = from.y < to.y;
+            const Vector2f& upper = down ? from : to;
+            const Vector2f& lower = down ? to : from;
+            pathEdges.push_back(PathEdge{upper.x, upper.y, lower.y, (lower.x - upper.x) / (lower.y - upper.y),
+                                         down ? 1 : -1});
+        }
+        params.edgeCount = static_cast<uint32_t>(pathEdges.size() - params.edgeBegin);
+        std::sort(pathEdges.begin() + params.edgeBegin, pathEdges.end(),
+                  [](const PathEdge& a, const PathEdge& b) { return a.y0 < b.y0; });
+
+        Command cmd = makeCommand(CommandKind::Path, color);
+        cmd.pathIndex = static_cast<uint32_t>(paths.size());
+        paths.push_back(params);
+        const size_t submitted = commands.size();
+        submit(cmd, minX, minY, maxX, maxY);
+        if (commands.size() == submitted) {
+            paths.pop_back();
+            pathEdges.resize(params.edgeBegin);
+        }
+    }
+
+    // Команда, растеризуемая через обратное отображение локального прямоугольника
+    void submitMapped(Command& cmd, float x0, float y0, float x1, float y1) {
+        const Affine& m = currentTransform();
+        cmd.inverse = m.inverse();
+        const Vector2f corners[4] = {
+            m.apply(Vector2f(x0, y0)), m.apply(Vector2f(x1, y0)),
+            m.apply(Vector2f(x1, y1)), m.apply(Vector2f(x0, y1))
+        };
+        float minX = corners[0].x, maxX = corners[0].x;
+        float minY = corners[0].y, maxY = corners[0].y;
+        for (const auto& p : corners) {
+            minX = std::min(minX, p.x);
+            maxX = std::max(maxX, p.x);
+            minY = std::min(minY, p.y);
+            maxY = std::max(maxY, p.y);
+        }
+        submit(cmd, minX, minY, maxX, maxY);
+    }
+
+    ImageHandle addImage(const utils::Image& image) {
+        textures.push_back(std::make_unique<SoftwareTexture>(makeTexture(image)));
+        ImageEntry entry;
+        entry.texture = textures.back().get();
+        entry.source[2] = static_cast<float>(entry.texture->width);
+        entry.source[3] = static_cast<float>(entry.texture->height);
+        images.push_back(entry);
+        return ImageHandle{static_cast<uint32_t>(images.size() - 1)};
+    }
+
+    // Путь разрешается один раз; неудачная загрузка тоже запоминается
+    ImageHandle resolve(const std::string& path) {
+        std::lock_guard<std::mutex> lock(measureMutex);
+        auto it = imageIndex.find(path);
+        if (it != imageIndex.end())
+            return ImageHandle{it->second};
+
+        utils::Image image;
+        const ImageHandle handle = image.loadFromFile(path) ? addImage(image) : ImageHandle();
+        imageIndex.emplace(path, handle.index);
+        return handle;
+    }
+
+    const ImageEntry* findImage(ImageHandle handle) const {
+        return handle.index < images.size() && images[handle.index].texture ? &images[handle.index] : nullptr;
+    }
+
+    void retireTexture(const SoftwareTexture* texture) {
+        auto it = std::find_if(textures.begin(), textures.end(),
+                               [texture](const std::unique_ptr<SoftwareTexture>& owned) {
+                                   return owned.get() == texture;
+                               });
+        if (it == textures.end())
+            return;
+        retiredTextures.push_back(std::move(*it));
+        textures.erase(it);
+
+        // Адрес освобождённой текстуры может достаться новой, и ключ совпадёт
+        for (auto slice = nineSlices.begin(); slice != nineSlices.end();) {
+            auto next = std::next(slice);
+            if (slice->key.texture == texture)
+                retireNineSlice(slice);
+            slice = next;
+        }
+    }
+
+    void retireNineSlice(std::list<NineSliceEntry>::iterator entry) {
+        nineSliceStats.bytes -= entry->texture->rgba.size();
+        retiredTextures.push_back(std::move(entry->texture));
+        nineSliceIndex.erase(entry->key);
+        nineSlices.erase(entry);
+    }
+
+    void trimNineSlices(size_t budget) {
+        while (!nineSlices.empty() && nineSliceStats.bytes > budget) {
+            retireNineSlice(std::prev(nineSlices.end()));
+        }
+    }
+
+    // Собранное изображение или nullptr, если оно не помещается в бюджет; под measureMutex
+    const SoftwareTexture* findNineSlice(const NineSliceKey& key) {
+        auto it = nineSliceIndex.find(key);
+        if (it != nineSliceIndex.end()) {
+            ++nineSliceStats.hits;
+            nineSlices.splice(nineSlices.begin(), nineSlices, it->second);
+            return it->second->texture.get();
+        }
+
+        const size_t bytes = static_cast<size_t>(key.columns[3]) * static_cast<size_t>(key.rows[3]) * 4;
+        if (bytes > nineSliceBudget)
+            return nullptr;
+        ++nineSliceStats.misses;
+        trimNineSlices(nineSliceBudget - bytes);
+        nineSlices.push_front(NineSliceEntry{key, std::make_unique<SoftwareTexture>(composeNineSlice(key))});
+        nineSliceIndex.emplace(key, nineSlices.begin());
+        nineSliceStats.bytes += bytes;
+        return nineSlices.front().texture.get();
+    }
+
+    void beginOverdraw() {
+        frameOverdrawMode = overdrawMode.load(std::memory_order_relaxed);
+        if (frameOverdrawMode == OverdrawMode::Off) {
+            overdrawData = nullptr;
+            if (!overdraw.empty()) {
+                overdraw = std::vector<uint32_t>();
+                overdrawStats = OverdrawStats();
+            }
+            return;
+        }
+        overdraw.assign(static_cast<size_t>(width()) * height(), 0);
+        overdrawData = overdraw.data();
+    }
+
+    void finishOverdraw() {
+        if (!overdrawData)
+            return;
+
+        OverdrawStats stats;
+        for (uint32_t writes : overdraw) {
+            if (writes == 0)
+                continue;
+            stats.writes += writes;
+            ++stats.coveredPixels;
+            if (writes > 1)
+                ++stats.overdrawnPixels;
+            stats.maxWrites = std::max(stats.maxWrites, writes);
+        }
+        overdrawStats = stats;
+
+        if (frameOverdrawMode != OverdrawMode::Heatmap)
+            return;
+        constexpr uint32_t last = sizeof(kOverdrawPalette) / sizeof(kOverdrawPalette[0]) - 1;
+        uint8_t* px = target->getData();
+        for (uint32_t writes : overdraw) {
+            std::memcpy(px, kOverdrawPalette[std::min(writes, last)], 4);
+            px += 4;
+        }
+    }
+
+    // --- Растеризация ---
+
+    uint8_t* pixelAt(int x, int y) const {
+        return target->getData() + (static_cast<size_t>(y) * width() + x) * 4;
+    }
+
+    // Счётчик записей пикселя; без режима перерисовки вызов исчезает при компиляции
+    template<bool kCount>
+    void countWrite(int x, int y) const {
+        if (kCount)
+            ++overdrawData[static_cast<size_t>(y) * width() + x];
+    }
+
+    template<bool kCount>
+    void rasterizeClear(const Command& cmd, const PixelRect& box) const {
+        const uint32_t packed = packColor(cmd.color);
+        for (int y = box.y0; y < box.y1; ++y) {
+            uint8_t* row = pixelAt(box.x0, y);
+            for (int x = box.x0; x < box.x1; ++x, row += 4) {
+                std::memcpy(row, &packed, 4);
+                countWrite<kCount>(x, y);
+            }
+        }
+    }
+
+    template<bool kCount>
+    void rasterizeRect(const Command& cmd, const PixelRect& box) const {
+        const bool opaque = isOpaqueWrite(cmd);
+        const uint32_t packed = packColor(cmd.color);
+        const float rx0 = cmd.rect[0], ry0 = cmd.rect[1], rx1 = cmd.rect[2], ry1 = cmd.rect[3];
+
+        for (int y = box.y0; y < box.y1; ++y) {
+            // Покрытие по вертикали — доля пикселя внутри прямоугольника
+            const float fy = static_cast<float>(y);
+            const float coverY = clamp01(std::min(fy + 1.0f, ry1) - std::max(fy, ry0));
+            if (coverY <= 0.0f)
+                continue;
+
+            uint8_t* px = pixelAt(box.x0, y);
+            for (int x = box.x0; x < box.x1; ++x, px += 4) {
+                const float fx = static_cast<float>(x);
+                const float coverage = coverY * clamp01(std::min(fx + 1.0f, rx1) - std::max(fx, rx0));
+                if (coverage >= 1.0f && opaque) {
+                    std::memcpy(px, &packed, 4);
+                    countWrite<kCount>(x, y);
+                } else if (coverage > 0.0f) {
+                    blendPixel(px, cmd.color, coverage, cmd.blend);
+                    countWrite<kCount>(x, y);
+                }
+            }
+        }
+    }
+
+    template<bool kCount>
+    void rasterizePolygon(const Command& cmd, const PixelRect& box) const {
+        const bool opaque = isOpaqueWrite(cmd);
+        const uint32_t packed = packColor(cmd.color);
+        const int edgeCount = cmd.edgeCount;
+
+        for (int y = box.y0; y < box.y1; ++y) {
+            const float cy = static_cast<float>(y) + 0.5f;
+            const float cx0 = static_cast<float>(box.x0) + 0.5f;
+
+            // Расстояния до рёбер в первом пикселе строки; дальше — инкрементально
+            float distance[4];
+            for (int e = 0; e < edgeCount; ++e) {
+                distance[e] = cmd.edges[e].a * cx0 + cmd.edges[e].b * cy + cmd.edges[e].c;
+            }
+
+            uint8_t* px = pixelAt(box.x0, y);
+            for (int x = box.x0; x < box.x1; ++x, px += 4) {
+                float inside = distance[0];
+                for (int e = 1; e < edgeCount; ++e) {
+                    inside = std::min(inside, distance[e]);
+                }
+                for (int e = 0; e < edgeCount; ++e) {
+                    distance[e] += cmd.edges[e].a;
+                }
+
+                const float coverage = cmd.antialias ? clamp01(inside + 0.5f) : (inside >= 0.0f ? 1.0f : 0.0f);
+                if (coverage >= 1.0f && opaque) {
+                    std::memcpy(px, &packed, 4);
+                    countWrite<kCount>(x, y);
+                } else if (coverage > 0.0f) {
+                    blendPixel(px, cmd.color, coverage, cmd.blend);
+                    countWrite<kCount>(x, y);
+                }
+            }
+        }
+    }
+
+    template<bool kCount>
+    void rasterizeRing(const Command& cmd, const PixelRect& box) const {
+        const bool opaque = isOpaqueWrite(cmd);
+        const uint32_t packed = packColor(cmd.color);
+        const bool filled = cmd.innerRadius < 0.0f;
+
+        for (int y = box.y0; y < box.y1; ++y) {
+            const float dy = static_cast<float>(y) + 0.5f - cmd.center.y;
+            uint8_t* px = pixelAt(box.x0, y);
+            for (int x = box.x0; x < box.x1; ++x, px += 4) {
+                const float dx = static_cast<float>(x) + 0.5f - cmd.center.x;
+                const float dist = std::sqrt(dx * dx + dy * dy);
+                float inside = cmd.outerRadius - dist;
+                if (!filled)
+                    inside = std::min(inside, dist - cmd.innerRadius);
+
+                const float coverage = cmd.antialias ? clamp01(inside + 0.5f) : (inside >= 0.0f ? 1.0f : 0.0f);
+                if (coverage >= 1.0f && opaque) {
+                    std::memcpy(px, &packed, 4);
+                    countWrite<kCount>(x, y);
+                } else if (coverage > 0.0f) {
+                    blendPixel(px, cmd.color, coverage, cmd.blend);
+                    countWrite<kCount>(x, y);
+                }
+            }
+        }
+    }
+
+    template<bool kCount>
+    void rasterizeImage(const Command& cmd, const PixelRect& box) const {
+        const SoftwareTexture& texture = *cmd.texture;
+        const Affine& inv = cmd.inverse;
+        // rect хранит локальный прямоугольник назначения, source — область текстуры
+        const float u0 = cmd.rect[0], v0 = cmd.rect[1];
+        const float uScale = (cmd.source[2] - cmd.source[0]) / (cmd.rect[2] - cmd.rect[0]);
+        const float vScale = (cmd.source[3] - cmd.source[1]) / (cmd.rect[3] - cmd.rect[1]);
+        const float inv255 = 1.0f / 255.0f;
+        // Без оттенка непрозрачный тексель переносится как есть, прозрачный пропускается:
+        // так выводятся слои, большей частью состоящие из тех и других
+        const bool untinted = cmd.color[0] == 1.0f && cmd.color[1] == 1.0f && cmd.color[2] == 1.0f &&
+                              cmd.color[3] == 1.0f && (cmd.blend == BlendMode::Alpha || cmd.blend == BlendMode::None);
+        if (untinted && isUnitMapping(cmd, uScale, vScale)) {
+            blitImage<kCount>(cmd, box);
+            return;
+        }
+
+        for (int y = box.y0; y < box.y1; ++y) {
+            // Обратное отображение аффинно, поэтому вдоль строки достаточно приращений
+            Vector2f local = inv.apply(Vector2f(static_cast<float>(box.x0) + 0.5f,
+                                                static_cast<float>(y) + 0.5f));
+            uint8_t* px = pixelAt(box.x0, y);
+            for (int x = box.x0; x < box.x1; ++x, px += 4, local.x += inv.a, local.y += inv.b) {
+                const float u = cmd.source[0] + (local.x - u0) * uScale;
+                const float v = cmd.source[1] + (local.y - v0) * vScale;
+                if (u < cmd.source[0] || v < cmd.source[1] || u >= cmd.source[2] || v >= cmd.source[3])
+                    continue;
+
+                const uint8_t* texel = &texture.rgba[(static_cast<size_t>(v) * texture.width +
+                                                      static_cast<size_t>(u)) * 4];
+                if (untinted && texel[3] == 255) {
+                    std::memcpy(px, texel, 4);
+                    countWrite<kCount>(x, y);
+                    continue;
+                }
+                if (untinted && texel[3] == 0 && cmd.blend == BlendMode::Alpha)
+                    continue;
+                const float src[4] = {
+                    texel[0] * inv255 * cmd.color[0],
+                    texel[1] * inv255 * cmd.color[1],
+                    texel[2] * inv255 * cmd.color[2],
+                    texel[3] * inv255 * cmd.color[3]
+                };
+                blendPixel(px, src, 1.0f, cmd.blend);
+                if (texel[3] != 0)
+                    countWrite<kCount>(x, y);
+            }
+        }
+    }
+
+    // Тексель на пиксель устройства без дробных границ источника: собранные
+    // девятисрезовые изображения и слои, выровненные по пикселям
+    static bool isUnitMapping(const Command& cmd, float uScale, float vScale) {
+        const Affine& inv = cmd.inverse;
+        return inv.a == 1.0f && inv.b == 0.0f && inv.c == 0.0f && inv.d == 1.0f &&
+               uScale == 1.0f && vScale == 1.0f &&
+               cmd.source[0] == std::floor(cmd.source[0]) && cmd.source[1] == std::floor(cmd.source[1]) &&
+               cmd.source[2] == std::floor(cmd.source[2]) && cmd.source[3] == std::floor(cmd.source[3]);
+    }
+
+    // Строка текстуры идёт подряд: непрозрачные тексели переносятся отрезками
+    template<bool kCount>
+    void blitImage(const Command& cmd, const PixelRect& box) const {
+        const SoftwareTexture& texture = *cmd.texture;
+        const Affine& inv = cmd.inverse;
+        const float inv255 = 1.0f / 255.0f;
+        const int u0 = static_cast<int>(cmd.source[0]), v0 = static_cast<int>(cmd.source[1]);
+        const int u1 = static_cast<int>(cmd.source[2]), v1 = static_cast<int>(cmd.source[3]);
+        // Пиксель x читает тексель x + du; сдвиг одинаков для всего прямоугольника
+        const int du = static_cast<int>(std::floor(cmd.source[0] + static_cast<float>(box.x0) + 0.5f + inv.tx -
+                                                   cmd.rect[0])) - box.x0;
+        const int dv = static_cast<int>(std::floor(cmd.source[1] + static_cast<float>(box.y0) + 0.5f + inv.ty -
+                                                   cmd.rect[1])) - box.y0;
+        const int x0 = std::max(box.x0, u0 - du), x1 = std::min(box.x1, u1 - du);
+        const int y0 = std::max(box.y0, v0 - dv), y1 = std::min(box.y1, v1 - dv);
+
+        for (int y = y0; y < y1; ++y) {
+            const uint8_t* texel = &texture.rgba[(static_cast<size_t>(y + dv) * texture.width +
+                                                  static_cast<size_t>(x0 + du)) * 4];
+            uint8_t* px = pixelAt(x0, y);
+            int x = x0;
+            while (x < x1) {
+                if (texel[3] == 255) {
+                    int run = 1;
+                    while (x + run < x1 && texel[run * 4 + 3] == 255) {
+                        ++run;
+                    }
+                    std::memcpy(px, texel, static_cast<size_t>(run) * 4);
+                    if (kCount) {
+                        for (int i = 0; i < run; ++i) {
+                            countWrite<kCount>(x + i, y);
+                        }
+                    }
+                    x += run;
+                    px += run * 4;
+                    texel += run * 4;
+                    continue;
+                }
+                if (texel[3] != 0 || cmd.blend == BlendMode::None) {
+                    const float src[4] = {texel[0] * inv255, texel[1] * inv255, texel[2] * inv255, texel[3] * inv255};
+                    blendPixel(px, src, 1.0f, cmd.blend);
+                    if (texel[3] != 0)
+                        countWrite<kCount>(x, y);
+                }
+                ++x;
+                px += 4;
+                texel += 4;
+            }
+        }
+    }
+
+    // Покрытие строки копится по подстрокам: участок внутри пути добавляет
+    // долю каждого пикселя, целые пиксели — через разностный массив
+    template<bool kCount>
+    void rasterizePath(const Command& cmd, const PixelRect& box) const {
+        thread_local std::vector<float> t_cover;
+        thread_local std::vector<float> t_delta;
+        thread_local std::vector<const PathEdge*> t_active;
+        thread_local std::vector<std::pair<float, int>> t_crossings;
+
+        const PathParams& params = paths[cmd.pathIndex];
+        const PathEdge* edges = pathEdges.data() + params.edgeBegin;
+        const PathEdge* edgesEnd = edges + params.edgeCount;
+        const int width = box.x1 - box.x0;
+        const float weight = 1.0f / static_cast<float>(kPathSamples);
+        const bool opaque = isOpaqueWrite(cmd);
+        const uint32_t packed = packColor(cmd.color);
+        t_cover.resize(static_cast<size_t>(width) + 1);
+        t_delta.resize(static_cast<size_t>(width) + 1);
+        t_active.clear();
+
+        auto addSpan = [&](float left, float right) {
+            left = std::max(left, static_cast<float>(box.x0)) - static_cast<float>(box.x0);
+            right = std::min(right, static_cast<float>(box.x1)) - static_cast<float>(box.x0);
+            if (right <= left)
+                return;
+            const int first = static_cast<int>(left);
+            const int last = static_cast<int>(right);
+            if (first == last) {
+                t_cover[first] += (right - left) * weight;
+                return;
+            }
+            t_cover[first] += (static_cast<float>(first + 1) - left) * weight;
+            t_delta[first + 1] += weight;
+            t_delta[last] -= weight;
+            if (last < width)
+                t_cover[last] += (right - static_cast<float>(last)) * weight;
+        };
+
+        for (int y = box.y0; y < box.y1; ++y) {
+            std::fill(t_cover.begin(), t_cover.end(), 0.0f);
+            std::fill(t_delta.begin(), t_delta.end(), 0.0f);
+            bool covered = false;
+
+            for (int s = 0; s < kPathSamples; ++s) {
+                const float sy = static_cast<float>(y) + (static_cast<float>(s) + 0.5f) * weight;
+                while (edges != edgesEnd && edges->y0 <= sy) {
+                    t_active.push_back(edges++);
+                }
+                t_active.erase(std::remove_if(t_active.begin(), t_active.end(),
+                                              [sy](const PathEdge* edge) { return edge->y1 <= sy; }),
+                               t_active.end());
+                if (t_active.size() < 2)
+                    continue;
+
+                t_crossings.clear();
+                for (const PathEdge* edge : t_active) {
+                    t_crossings.emplace_back(edge->x0 + (sy - edge->y0) * edge->slope, edge->winding);
+                }
+                std::sort(t_crossings.begin(), t_crossings.end(),
+                          [](const std::pair<float, int>& a, const std::pair<float, int>& b) { return a.first < b.first; });
+
+                int winding = 0;
+                for (size_t i = 0; i + 1 < t_crossings.size(); ++i) {
+                    winding += t_crossings[i].second;
+                    const bool inside = params.rule == FillRule::NonZero ? winding != 0 : (winding & 1) != 0;
+                    if (inside) {
+                        addSpan(t_crossings[i].first, t_crossings[i + 1].first);
+                        covered = true;
+                    }
+                }
+            }
+            if (!covered)
+                continue;
+
+            uint8_t* px = pixelAt(box.x0, y);
+            float running = 0.0f;
+            for (int i = 0; i < width; ++i, px += 4) {
+                running += t_delta[i];
+                float coverage = std::min(t_cover[i] + running, 1.0f);
+                if (!cmd.antialias)
+                    coverage = coverage >= 0.5f ? 1.0f : 0.0f;
+                if (coverage >= 0.999f && opaque) {
+                    std::memcpy(px, &packed, 4);
+                    countWrite<kCount>(box.x0 + i, y);
+                } else if (coverage > 0.001f) {
+                    blendPixel(px, cmd.color, coverage, cmd.blend);
+                    countWrite<kCount>(box.x0 + i, y);
+                }
+            }
+        }
+    }
+
+    // Расстояния до контура считаются в локальных координатах и переводятся в пиксели;
+    // тень, заливка и рамка смешиваются в пиксель за один проход
+    template<bool kCount>
+    void rasterizeShape(const Command& cmd, const PixelRect& box) const {
+        const ShapeParams& shape = shapes[cmd.shapeIndex];
+        const Affine& inv = cmd.inverse;
+        const bool opaque = isOpaqueWrite(cmd);
+        const uint32_t packed = packColor(cmd.color);
+        const bool hasFill = cmd.color[3] > 0.0f;
+        const bool hasBorder = shape.borderWidth > 0.0f && shape.border[3] > 0.0f;
+        const bool hasShadow = shape.shadow[3] > 0.0f;
+        const float borderPixels = shape.borderWidth * shape.pixelScale;
+        // Размытая тень — свёртка края с гауссианом, erfc по расстоянию
+        const float shadowScale = shape.shadowSigma > 0.0f
+            ? 1.0f / (shape.shadowSigma * shape.pixelScale * 1.41421356f) : 0.0f;
+        const bool antialias = cmd.antialias;
+        auto coverage = [antialias](float distance) {
+            return antialias ? clamp01(0.5f - distance) : (distance <= 0.0f ? 1.0f : 0.0f);
+        };
+
+        for (int y = box.y0; y < box.y1; ++y) {
+            Vector2f local = inv.apply(Vector2f(static_cast<float>(box.x0) + 0.5f,
+                                                static_cast<float>(y) + 0.5f)) - shape.center;
+            uint8_t* px = pixelAt(box.x0, y);
+            for (int x = box.x0; x < box.x1; ++x, px += 4, local.x += inv.a, local.y += inv.b) {
+                const float distance = roundedBoxDistance(local, shape.halfSize, shape.radii) * shape.pixelScale;
+                const float outer = coverage(distance);
+                bool written = false;
+
+                // Под непрозрачной заливкой тень не видна
+                if (hasShadow && !(outer >= 1.0f && hasFill && opaque)) {
+                    const float shadowDistance =
+                        roundedBoxDistance(local - shape.shadowOffset, shape.halfSize, shape.radii) * shape.pixelScale;
+                    const float amount = shadowScale > 0.0f ? 0.5f * std::erfc(shadowDistance * shadowScale)
+                                                            : coverage(shadowDistance);
+                    if (amount * shape.shadow[3] >= kMinShadowAlpha) {
+                        blendPixel(px, shape.shadow, amount, cmd.blend);
+                        written = true;
+                    }
+                }
+
+                if (outer > 0.0f) {
+                    if (hasFill) {
+                        if (outer >= 1.0f && opaque)
+                            std::memcpy(px, &packed, 4);
+                        else
+                            blendPixel(px, cmd.color, outer, cmd.blend);
+                        written = true;
+                    }
+                    if (hasBorder) {
+                        const float ring = outer - coverage(distance + borderPixels);
+                        if (ring > 0.0f) {
+                            blendPixel(px, shape.border, ring, cmd.blend);
+                            written = true;
+                        }
+                    }
+                }
+
+                if (written)
+                    countWrite<kCount>(x, y);
+            }
+        }
+    }
+
+    template<bool kCount>
+    void rasterizeText(const Command& cmd, const PixelRect& box) const {
+        const char* text = textArena.data() + cmd.textOffset;
+        const float invScale = 1.0f / cmd.glyphScale;
+
+        for (int y = box.y0; y < box.y1; ++y) {
+            Vector2f local = cmd.inverse.apply(Vector2f(static_cast<float>(box.x0) + 0.5f,
+                                                        static_cast<float>(y) + 0.5f));
+            uint8_t* px = pixelAt(box.x0, y);
+            for (int x = box.x0; x < box.x1; ++x, px += 4, local.x += cmd.inverse.a, local.y += cmd.inverse.b) {
+                const float gx = local.x * invScale;
+                const float gy = local.y * invScale;
+                if (gx < 0.0f || gy < 0.0f || gy >= 7.0f)
+                    continue;
+
+                const uint32_t index = static_cast<uint32_t>(gx / kGlyphCellWidth);
+                if (index >= cmd.textLength)
+                    continue;
+                const int column = static_cast<int>(gx) - static_cast<int>(index * kGlyphCellWidth);
+                if (column >= 5)
+                    continue;
+
+                const uint8_t glyph = static_cast<uint8_t>(text[index]);
+                if (kFont5x7[glyph][column] & (1u << static_cast<int>(gy))) {
+                    blendPixel(px, cmd.color, 1.0f, cmd.blend);
+                    countWrite<kCount>(x, y);
+                }
+            }
+        }
+    }
+
+    template<bool kCount>
+    void rasterizeTile(uint32_t tile) const {
+        const unsigned int tx = tile % tilesX;
+        const unsigned int ty = tile / tilesX;
+        PixelRect tileRect;
+        tileRect.x0 = static_cast<int>(tx * config.tileSize);
+        tileRect.y0 = static_cast<int>(ty * config.tileSize);
+        tileRect.x1 = std::min(tileRect.x0 + static_cast<int>(config.tileSize), static_cast<int>(width()));
+        tileRect.y1 = std::min(tileRect.y0 + static_cast<int>(config.tileSize), static_cast<int>(height()));
+
+        for (uint32_t index : tileBins[tile]) {
+            const Command& cmd = commands[index];
+            const PixelRect box = cmd.bounds.intersect(tileRect);
+            if (box.empty())
+                continue;
+
+            switch (cmd.kind) {
+                case CommandKind::Clear:   rasterizeClear<kCount>(cmd, box); break;
+                case CommandKind::Rect:    rasterizeRect<kCount>(cmd, box); break;
+                case CommandKind::Polygon: rasterizePolygon<kCount>(cmd, box); break;
+                case CommandKind::Ring:    rasterizeRing<kCount>(cmd, box); break;
+                case CommandKind::Image:   rasterizeImage<kCount>(cmd, box); break;
+                case CommandKind::Text:    rasterizeText<kCount>(cmd, box); break;
+                case CommandKind::Shape:   rasterizeShape<kCount>(cmd, box); break;
+                case CommandKind::Path:    rasterizePath<kCount>(cmd, box); break;
+            }
+        }
+    }
+
+    void flush() {
+        if (commands.empty())
+            return;
+
+        // Раскладка команд по тайлам с сохранением порядка отправки
+        for (auto& bin : tileBins) {
+            bin.clear();
+        }
+        activeTiles.clear();
+
+        const int tileSize = static_cast<int>(config.tileSize);
+        for (uint32_t i = 0; i < commands.size(); ++i) {
+            const PixelRect& b = commands[i].bounds;
+            const int tx0 = b.x0 / tileSize;
+            const int ty0 = b.y0 / tileSize;
+            const int tx1 = (b.x1 - 1) / tileSize;
+            const int ty1 = (b.y1 - 1) / tileSize;
+            for (int ty = ty0; ty <= ty1; ++ty) {
+                for (int tx = tx0; tx <= tx1; ++tx) {
+                    auto& bin = tileBins[static_cast<size_t>(ty) * tilesX + tx];
+                    if (bin.empty())
+                        activeTiles.push_back(static_cast<uint32_t>(ty) * tilesX + tx);
+                    bin.push_back(i);
+                }
+            }
+        }
+
+        // Тайлы не пересекаются, поэтому счётчики перерисовки пишутся без синхронизации
+        const bool count = overdrawData != nullptr;
+        auto rasterize = [this, count](uint32_t tile) {
+            if (count)
+                rasterizeTile<true>(tile);
+            else
+                rasterizeTile<false>(tile);
+        };
+        if (pool) {
+            pool->parallelFor(activeTiles.size(), [this, &rasterize](size_t i) { rasterize(activeTiles[i]); });
+        } else {
+            for (uint32_t tile : activeTiles) {
+                rasterize(tile);
+            }
+        }
+
+        commands.clear();
+        textArena.clear();
+    }
+};
+
+SoftwareRenderer::SoftwareRenderer() : SoftwareRenderer(Config()) {}
+
+SoftwareRenderer::SoftwareRenderer(const Config& config)
+    : impl_(std::make_unique<Implementation>(config)) {
+    impl_->cullStats = &cullStats_;
+    impl_->renderStats = &renderStats_;
+}
+
+SoftwareRenderer::~SoftwareRenderer() = default;
+
+bool SoftwareRenderer::initialize() {
+    if (impl_->target == &impl_->ownTarget)
+        impl_->ownTarget.create(impl_->config.width, impl_->config.height, utils::Image::Format::RGBA);
+    impl_->layoutTiles();
+    impl_->resetViewport();
+    return impl_->width() > 0 && impl_->height() > 0;
+}
+
+void SoftwareRenderer::shutdown() {
+    impl_->commands.clear();
+    impl_->textArena.clear();
+    impl_->nineSlices.clear();
+    impl_->nineSliceIndex.clear();
+    impl_->nineSliceStats.bytes = 0;
+    impl_->textures.clear();
+    impl_->retiredTextures.clear();
+    impl_->images.clear();
+    impl_->imageIndex.clear();
+}
+
+void SoftwareRenderer::beginFrame() {
+    beginRenderStats();
+    impl_->beginOverdraw();
+    impl_->commands.clear();
+    impl_->textArena.clear();
+    impl_->shapes.clear();
+    impl_->paths.clear();
+    impl_->pathEdges.clear();
+    {
+        std::lock_guard<std::mutex> lock(impl_->measureMutex);
+        impl_->retiredTextures.clear();
+    }
+    impl_->resetState();
+    resetCullStats();
+}
+
+void SoftwareRenderer::endFrame() {
+    impl_->flush();
+    impl_->finishOverdraw();
+    endRenderStats();
+}
+
+void SoftwareRenderer::clear(const Color& color) {
+    Command cmd = impl_->makeCommand(CommandKind::Clear, color);
+    cmd.blend = BlendMode::None;
+    const PixelRect& viewport = impl_->viewportClip;
+    cmd.bounds = viewport;
+    recordDrawCall();
+    if (!cmd.bounds.empty()) {
+        impl_->commands.push_back(cmd);
+        impl_->countPixels(cmd.bounds);
+    }
+}
+
+void SoftwareRenderer::drawRect(const Rect& rect, const Color& color, float thickness) {
+    const float x0 = rect.position.x, y0 = rect.position.y;
+    const float x1 = x0 + rect.size.x, y1 = y0 + rect.size.y;
+    const float t = std::min(thickness, std::min(rect.size.x, rect.size.y) * 0.5f);
+    if (t <= 0.0f)
+        return;
+
+    recordDrawCall();
+    // Четыре полосы без перекрытия, чтобы полупрозрачная рамка не темнела в углах
+    impl_->submitLocalRect(x0, y0, x1, y0 + t, color);
+    impl_->submitLocalRect(x0, y1 - t, x1, y1, color);
+    impl_->submitLocalRect(x0, y0 + t, x0 + t, y1 - t, color);
+    impl_->submitLocalRect(x1 - t, y0 + t, x1, y1 - t, color);
+}
+
+void SoftwareRenderer::fillRect(const Rect& rect, const Color& color) {
+    recordDrawCall();
+    impl_->submitLocalRect(rect.position.x, rect.position.y,
+                           rect.position.x + rect.size.x, rect.position.y + rect.size.y, color);
+}
+
+void SoftwareRenderer::drawCircle(const Vector2f& center, float radius, const Color& color, float thickness) {
+    const float half = thickness * 0.5f;
+    recordDrawCall();
+    impl_->submitRing(center, radius + half, std::max(0.0f, radius - half), color);
+}
+
+void SoftwareRenderer::fillCircle(const Vector2f& center, float radius, const Color& color) {
+    recordDrawCall();
+    impl_->submitRing(center, radius, -1.0f, color);
+}
+
+void SoftwareRenderer::drawLine(const Vector2f& start, const Vector2f& end, const Color& color, float thickness) {
+    recordDrawCall();
+    impl_->submitLine(start, end, color, thickness);
+}
+
+void SoftwareRenderer::drawTriangle(const Vector2f& p1, const Vector2f& p2, const Vector2f& p3,
+                                    const Color& color, float thickness) {
+    recordDrawCall();
+    impl_->submitLine(p1, p2, color, thickness);
+    impl_->submitLine(p2, p3, color, thickness);
+    impl_->submitLine(p3, p1, color, thickness);
+}
+
+void SoftwareRenderer::fillTriangle(const Vector2f& p1, const Vector2f& p2, const Vector2f& p3, const Color& color) {
+    recordDrawCall();
+    const Affine& m = impl_->currentTransform();
+    const Vector2f points[3] = {m.apply(p1), m.apply(p2), m.apply(p3)};
+    impl_->submitPolygon(points, 3, color);
+}
+
+void SoftwareRenderer::fillRoundedRect(const Rect& rect, float radius, const Color& color) {
+    if (radius <= 0.0f) {
+        fillRect(rect, color);
+        return;
+    }
+    ShapeStyle style;
+    style.fill = color;
+    style.setRadius(radius);
+    drawShape(rect, style);
+}
+
+void SoftwareRenderer::drawRoundedRect(const Rect& rect, float radius, const Color& color, float thickness) {
+    if (radius <= 0.0f) {
+        drawRect(rect, color, thickness);
+        return;
+    }
+    if (thickness <= 0.0f)
+        return;
+    ShapeStyle style;
+    style.border = color;
+    style.borderWidth = thickness;
+    style.setRadius(radius);
+    drawShape(rect, style);
+}
+
+void SoftwareRenderer::drawShape(const Rect& rect, const ShapeStyle& style) {
+    recordDrawCall();
+    impl_->submitShape(rect, style);
+}
+
+void SoftwareRenderer::fillPath(const Path& path, const Color& color, FillRule rule) {
+    if (color.a <= 0.0f || path.isEmpty())
+        return;
+    recordDrawCall();
+    const float scale = getDeviceScale();
+    impl_->submitPath(impl_->pathCache.getFill(path, rule, scale), color);
+}
+
+void SoftwareRenderer::strokePath(const Path& path, const Color& color, const StrokeStyle& stroke) {
+    if (color.a <= 0.0f || stroke.width <= 0.0f || path.isEmpty())
+        return;
+    recordDrawCall();
+    const float scale = getDeviceScale();
+    impl_->submitPath(impl_->pathCache.getStroke(path, stroke, scale), color);
+}
+
+void SoftwareRenderer::drawText(const std::string& text, const Vector2f& position,
+                                const std::string& font, float size, const Color& color) {
+    if (text.empty() || size <= 0.0f)
+        return;
+
+    recordDrawCall();
+    std::lock_guard<std::mutex> lock(impl_->measureMutex);
+    const GlyphRun& run = impl_->glyphRuns.get(text, font, size, shapeText);
+    const float scale = size / kGlyphCellHeight;
+    for (const GlyphLine& line : run.lines) {
+        if (line.glyphCount == 0)
+            continue;
+
+        // В арену попадают уже готовые индексы глифов
+        Command cmd = impl_->makeCommand(CommandKind::Text, color);
+        cmd.textOffset = static_cast<uint32_t>(impl_->textArena.size());
+        cmd.textLength = line.glyphCount;
+        cmd.glyphScale = scale;
+        for (uint32_t i = 0; i < line.glyphCount; ++i) {
+            impl_->textArena.push_back(static_cast<char>(run.glyphs[line.firstGlyph + i].glyph));
+        }
+
+        // Локальная система текста начинается в точке строки
+        const Affine local = impl_->currentTransform() * Affine::translation(position.x, position.y + line.offsetY);
+        impl_->transformStack.push_back(local);
+        impl_->submitMapped(cmd, 0.0f, 0.0f, line.width, kGlyphCellHeight * scale);
+        impl_->transformStack.pop_back();
+    }
+}
+
+void SoftwareRenderer::drawImage(const std::string& imagePath, const Rect& destRect, const Color& tint) {
+    drawImage(impl_->resolve(imagePath), destRect, tint);
+}
+
+ImageHandle SoftwareRenderer::resolveImage(const std::string& imagePath) {
+    return impl_->resolve(imagePath);
+}
+
+ImageHandle SoftwareRenderer::resolveImageRegion(ImageHandle image, const Rect& sourceRect) {
+    std::lock_guard<std::mutex> lock(impl_->measureMutex);
+    const Implementation::ImageEntry* parent = impl_->findImage(image);
+    if (!parent)
+        return ImageHandle();
+
+    // Регион обрезается по области родителя, чтобы не читать соседние регионы атласа
+    Implementation::ImageEntry entry = *parent;
+    entry.source[0] = std::max(parent->source[0], parent->source[0] + sourceRect.position.x);
+    entry.source[1] = std::max(parent->source[1], parent->source[1] + sourceRect.position.y);
+    entry.source[2] = std::min(parent->source[2], parent->source[0] + sourceRect.position.x + sourceRect.size.x);
+    entry.source[3] = std::min(parent->source[3], parent->source[1] + sourceRect.position.y + sourceRect.size.y);
+    if (entry.source[0] >= entry.source[2] || entry.source[1] >= entry.source[3])
+        return ImageHandle();
+
+    impl_->images.push_back(entry);
+    return ImageHandle{static_cast<uint32_t>(impl_->images.size() - 1)};
+}
+
+// Имя перекрывает прежнее изображение с тем же путём; старые дескрипторы остаются валидными
+ImageHandle SoftwareRenderer::createImage(const std::string& name, const utils::Image& image) {
+    if (image.getWidth() == 0 || image.getHeight() == 0)
+        return ImageHandle();
+    std::lock_guard<std::mutex> lock(impl_->measureMutex);
+    const ImageHandle handle = impl_->addImage(image);
+    impl_->imageIndex[name] = handle.index;
+    return handle;
+}
+
+// Регионы, выданные по дескриптору раньше, продолжают ссылаться на прежнюю текстуру
+ImageHandle SoftwareRenderer::updateImage(ImageHandle image, const utils::Image& pixels) {
+    if (pixels.getWidth() == 0 || pixels.getHeight() == 0)
+        return ImageHandle();
+    std::lock_guard<std::mutex> lock(impl_->measureMutex);
+    if (image.index >= impl_->images.size())
+        return impl_->addImage(pixels);
+
+    Implementation::ImageEntry& entry = impl_->images[image.index];
+    impl_->retireTexture(entry.texture);
+    impl_->textures.push_back(std::make_unique<SoftwareTexture>(makeTexture(pixels)));
+    entry.texture = impl_->textures.back().get();
+    entry.source[0] = 0.0f;
+    entry.source[1] = 0.0f;
+    entry.source[2] = static_cast<float>(entry.texture->width);
+    entry.source[3] = static_cast<float>(entry.texture->height);
+    return image;
+}
+
+void SoftwareRenderer::releaseImage(ImageHandle image) {
+    std::lock_guard<std::mutex> lock(impl_->measureMutex);
+    if (image.index >= impl_->images.size())
+        return;
+    Implementation::ImageEntry& entry = impl_->images[image.index];
+    impl_->retireTexture(entry.texture);
+    entry.texture = nullptr;
+}
+
+void SoftwareRenderer::drawImage(ImageHandle image, const Rect& destRect, const Color& tint) {
+    if (destRect.size.x <= 0.0f || destRect.size.y <= 0.0f)
+        return;
+
+    recordDrawCall();
+    Command cmd = impl_->makeCommand(CommandKind::Image, tint);
+    {
+        std::lock_guard<std::mutex> lock(impl_->measureMutex);
+        const Implementation::ImageEntry* entry = impl_->findImage(image);
+        if (!entry)
+            return;
+        cmd.texture = entry->texture;
+        std::memcpy(cmd.source, entry->source, sizeof(cmd.source));
+    }
+    cmd.rect[0] = destRect.position.x;
+    cmd.rect[1] = destRect.position.y;
+    cmd.rect[2] = destRect.position.x + destRect.size.x;
+    cmd.rect[3] = destRect.position.y + destRect.size.y;
+    impl_->submitMapped(cmd, cmd.rect[0], cmd.rect[1], cmd.rect[2], cmd.rect[3]);
+}
+
+void SoftwareRenderer::drawNineSlice(ImageHandle image, const Rect& destRect, const NineSlice& slice,
+                                     const Color& tint) {
+    if (destRect.size.x <= 0.0f || destRect.size.y <= 0.0f)
+        return;
+
+    recordDrawCall();
+    const Affine& m = impl_->currentTransform();
+    const SoftwareTexture* texture = nullptr;
+    const SoftwareTexture* composed = nullptr;
+    NineSliceGrid grid;
+    NineSliceKey key;
+    {
+        std::lock_guard<std::mutex> lock(impl_->measureMutex);
+        const Implementation::ImageEntry* entry = impl_->findImage(image);
+        if (!entry)
+            return;
+        texture = entry->texture;
+        const Rect source(Vector2f(entry->source[0], entry->source[1]),
+                          Vector2f(entry->source[2] - entry->source[0], entry->source[3] - entry->source[1]));
+        grid = makeNineSliceGrid(source, destRect, slice);
+
+        // Границы частей выравниваются по пикселям устройства, и изображение ложится в них один к одному
+        if (m.b == 0.0f && m.c == 0.0f && m.a > 0.0f && m.d > 0.0f) {
+            key.texture = texture;
+            std::memcpy(key.sourceX, grid.sourceX, sizeof(key.sourceX));
+            std::memcpy(key.sourceY, grid.sourceY, sizeof(key.sourceY));
+            const float left = std::round(grid.destX[0] * m.a + m.tx);
+            const float top = std::round(grid.destY[0] * m.d + m.ty);
+            for (int i = 0; i < 4; ++i) {
+                key.columns[i] = static_cast<int32_t>(std::round(grid.destX[i] * m.a + m.tx) - left);
+                key.rows[i] = static_cast<int32_t>(std::round(grid.destY[i] * m.d + m.ty) - top);
+            }
+            if (key.columns[3] <= 0 || key.rows[3] <= 0)
+                return;
+            composed = impl_->findNineSlice(key);
+            if (composed) {
+                grid.destX[0] = (left - m.tx) / m.a;
+                grid.destY[0] = (top - m.ty) / m.d;
+                grid.destX[3] = (left + static_cast<float>(key.columns[3]) - m.tx) / m.a;
+                grid.destY[3] = (top + static_cast<float>(key.rows[3]) - m.ty) / m.d;
+            }
+        }
+    }
+
+    if (composed) {
+        Command cmd = impl_->makeCommand(CommandKind::Image, tint);
+        cmd.texture = composed;
+        cmd.source[2] = static_cast<float>(composed->width);
+        cmd.source[3] = static_cast<float>(composed->height);
+        cmd.rect[0] = grid.destX[0];
+        cmd.rect[1] = grid.destY[0];
+        cmd.rect[2] = grid.destX[3];
+        cmd.rect[3] = grid.destY[3];
+        impl_->submitMapped(cmd, cmd.rect[0], cmd.rect[1], cmd.rect[2], cmd.rect[3]);
+        return;
+    }
+
+    // Под поворотом или сверх бюджета части растягиваются при растеризации
+    for (int row = 0; row < 3; ++row) {
+        for (int column = 0; column < 3; ++column) {
+            if (grid.sourceX[column + 1] <= grid.sourceX[column] || grid.sourceY[row + 1] <= grid.sourceY[row] ||
+                grid.destX[column + 1] <= grid.destX[column] || grid.destY[row + 1] <= grid.destY[row])
+                continue;
+            Command cmd = impl_->makeCommand(CommandKind::Image, tint);
+            cmd.texture = texture;
+            cmd.source[0] = grid.sourceX[column];
+            cmd.source[1] = grid.sourceY[row];
+            cmd.source[2] = grid.sourceX[column + 1];
+            cmd.source[3] = grid.sourceY[row + 1];
+            cmd.rect[0] = grid.destX[column];
+            cmd.rect[1] = grid.destY[row];
+            cmd.rect[2] = grid.destX[column + 1];
+            cmd.rect[3] = grid.destY[row + 1];
+            impl_->submitMapped(cmd, cmd.rect[0], cmd.rect[1], cmd.rect[2], cmd.rect[3]);
+        }
+    }
+}
+
+void SoftwareRenderer::pushClipRect(const Rect& rect) {
+    recordClipPush();
+    const Rect device = impl_->currentTransform().mapRect(rect);
+
+    // Ножницы округляются до целых пикселей, как и на GPU-бэкендах
+    PixelRect clip;
+    clip.x0 = static_cast<int>(std::floor(device.position.x + 0.5f));
+    clip.y0 = static_cast<int>(std::floor(device.position.y + 0.5f));
+    clip.x1 = static_cast<int>(std::floor(device.position.x + device.size.x + 0.5f));
+    clip.y1 = static_cast<int>(std::floor(device.position.y + device.size.y + 0.5f));
+    impl_->clipStack.push_back(clip.intersect(impl_->currentClip()));
+}
+
+void SoftwareRenderer::popClipRect() {
+    if (impl_->clipStack.size() > 1)
+        impl_->clipStack.pop_back();
+}
+
+void SoftwareRenderer::pushTransform(const Transform& transform) {
+    recordStateChange();
+    impl_->transformStack.push_back(impl_->currentTransform() * Affine::fromTransform(transform));
+}
+
+void SoftwareRenderer::pushTransform(const Affine& matrix) {
+    recordStateChange();
+    impl_->transformStack.push_back(impl_->currentTransform() * matrix);
+}
+
+void SoftwareRenderer::popTransform() {
+    if (impl_->transformStack.size() > 1) {
+        impl_->transformStack.pop_back();
+        recordStateChange();
+    }
+}
+
+void SoftwareRenderer::setBlendMode(BlendMode mode) {
+    if (impl_->blendMode != mode)
+        recordStateChange();
+    impl_->blendMode = mode;
+}
+
+void SoftwareRenderer::setAntialiasing(bool enabled) {
+    if (impl_->antialiasing != enabled)
+        recordStateChange();
+    impl_->antialiasing = enabled;
+}
+
+void SoftwareRenderer::setViewport(const Rect& viewport) {
+    recordStateChange();
+    const PixelRect full{0, 0, static_cast<int>(impl_->width()), static_cast<int>(impl_->height())};
+    impl_->viewportTransform = Affine::translation(viewport.position.x, viewport.position.y);
+    impl_->viewportClip = PixelRect::fromBounds(viewport.position.x, viewport.position.y,
+                                                viewport.position.x + viewport.size.x,
+                                                viewport.position.y + viewport.size.y).intersect(full);
+    impl_->resetState();
+}
+
+Vector2f SoftwareRenderer::getTextSize(const std::string& text, const std::string& font, float size) {
+    if (text.empty())
+        return Vector2f();
+    std::lock_guard<std::mutex> lock(impl_->measureMutex);
+    return impl_->glyphRuns.get(text, font, size, shapeText).size;
+}
+
+GlyphRunCache::Stats SoftwareRenderer::getGlyphCacheStats() const {
+    std::lock_guard<std::mutex> lock(impl_->measureMutex);
+    return impl_->glyphRuns.getStats();
+}
+
+void SoftwareRenderer::setGlyphCacheCapacity(size_t runs) {
+    std::lock_guard<std::mutex> lock(impl_->measureMutex);
+    impl_->glyphRuns.setCapacity(runs);
+}
+
+const PathCache::Stats& SoftwareRenderer::getPathCacheStats() const {
+    return impl_->pathCache.getStats();
+}
+
+void SoftwareRenderer::setNineSliceCacheBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(impl_->measureMutex);
+    impl_->nineSliceBudget = bytes;
+    impl_->trimNineSlices(bytes);
+}
+
+SoftwareRenderer::NineSliceCacheStats SoftwareRenderer::getNineSliceCacheStats() const {
+    std::lock_guard<std::mutex> lock(impl_->measureMutex);
+    NineSliceCacheStats stats = impl_->nineSliceStats;
+    stats.entries = impl_->nineSlices.size();
+    return stats;
+}
+
+Vector2f SoftwareRenderer::getImageSize(const std::string& imagePath) {
+    return getImageSize(impl_->resolve(imagePath));
+}
+
+Vector2f SoftwareRenderer::getImageSize(ImageHandle image) {
+    std::lock_guard<std::mutex> lock(impl_->measureMutex);
+    const Implementation::ImageEntry* entry = impl_->findImage(image);
+    if (!entry)
+        return Vector2f();
+    return Vector2f(entry->source[2] - entry->source[0], entry->source[3] - entry->source[1]);
+}
+
+float SoftwareRenderer::getDeviceScale() const {
+    return impl_->currentTransform().scaleFactor();
+}
+
+ClipTest SoftwareRenderer::testClip(const Rect& bounds) const {
+    // Те же границы, что получит команда в submit()
+    const Rect device = impl_->currentTransform().mapRect(bounds);
+    const PixelRect box = PixelRect::fromBounds(device.position.x, device.position.y,
+                                                device.position.x + device.size.x,
+                                                device.position.y + device.size.y);
+    const PixelRect& clip = impl_->currentClip();
+    if (box.intersect(clip).empty())
+        return ClipTest::Outside;
+    return clip.contains(box) ? ClipTest::Inside : ClipTest::Partial;
+}
+
+void SoftwareRenderer::setTarget(utils::Image* target) {
+    impl_->target = target ? target : &impl_->ownTarget;
+    if (impl_->target->getFormat() != utils::Image::Format::RGBA)
+        impl_->target->create(impl_->target->getWidth(), impl_->target->getHeight(), utils::Image::Format::RGBA);
+    impl_->layoutTiles();
+    impl_->resetViewport();
+}
+
+void SoftwareRenderer::resize(unsigned int width, unsigned int height) {
+    impl_->config.width = width;
+    impl_->config.height = height;
+    impl_->target->create(width, height, utils::Image::Format::RGBA);
+    impl_->layoutTiles();
+    impl_->resetViewport();
+}
+
+const utils::Image& SoftwareRenderer::getTarget() const {
+    return *impl_->target;
+}
+
+// Буфер счётчиков освобождается в beginOverdraw() первого кадра без режима
+void SoftwareRenderer::setOverdrawMode(OverdrawMode mode) {
+    impl_->overdrawMode.store(mode, std::memory_order_relaxed);
+}
+
+SoftwareRenderer::OverdrawMode SoftwareRenderer::getOverdrawMode() const {
+    return impl_->overdrawMode.load(std::memory_order_relaxed);
+}
+
+const SoftwareRenderer::OverdrawStats& SoftwareRenderer::getOverdrawStats() const {
+    return impl_->overdrawStats;
+}
+
+uint32_t SoftwareRenderer::getOverdrawCount(unsigned int x, unsigned int y) const {
+    if (impl_->overdraw.size() != static_cast<size_t>(impl_->width()) * impl_->height() ||
+        x >= impl_->width() || y >= impl_->height())
+        return 0;
+    return impl_->overdraw[static_cast<size_t>(y) * impl_->width() + x];
+}
+
+unsigned int SoftwareRenderer::getThreadCount() const {
+    return impl_->pool ? static_cast<unsigned int>(impl_->pool->getThreadCount()) + 1 : 1;
+}
+
+} // namespace gui
\ No newline at end of file
@@ -0,0 +1,159 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "../core/renderer.hpp"
+#include "glyph_cache.hpp"
+#include "path_cache.hpp"
+#include "../utils/image.hpp"
+
+namespace gui {
+
+// Программный рендерер: рисует в gui::utils::Image без участия GPU.
+// Команды кадра записываются в список, при endFrame() раскладываются по тайлам,
+// и тайлы растеризуются параллельно в пуле потоков. Порядок команд внутри тайла
+// сохраняется, поэтому результат не зависит от числа потоков.
+class SoftwareRenderer : public Renderer {
+public:
+    struct Config {
+        unsigned int width = 1920;
+        unsigned int height = 1080;
+        unsigned int threadCount = 0;   // 0 — по числу аппаратных потоков
+        unsigned int tileSize = 64;
+    };
+
+    // Диагностика перерисовки: растеризатор считает записи каждого пикселя.
+    // Heatmap после кадра заменяет изображение цветовой картой счётчиков:
+    // серый — одна запись, далее синий, зелёный, жёлтый, оранжевый, красный — 6 и больше.
+    // Очистка тоже считается записью.
+    enum class OverdrawMode {
+        Off,
+        Count,
+        Heatmap
+    };
+
+    struct OverdrawStats {
+        uint64_t writes = 0;            // записи пикселей за кадр
+        uint64_t coveredPixels = 0;     // пиксели, записанные хотя бы раз
+        uint64_t overdrawnPixels = 0;   // пиксели, записанные больше одного раза
+        uint32_t maxWrites = 0;
+
+        // Среднее число записей на закрашенный пиксель; 1 — перерисовки нет
+        double ratio() const {
+            return coveredPixels ? static_cast<double>(writes) / static_cast<double>(coveredPixels) : 0.0;
+        }
+    };
+
+    // Кэш девятисрезовых изображений, собранных в размере назначения
+    struct NineSliceCacheStats {
+        size_t entries = 0;
+        size_t bytes = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    SoftwareRenderer();
+    explicit SoftwareRenderer(const Config& config);
+    ~SoftwareRenderer() override;
+
+    // Инициализация и очистка
+    bool initialize() override;
+    void shutdown() override;
+
+    // Основные операции рендеринга
+    void beginFrame() override;
+    void endFrame() override;
+    void clear(const Color& color) override;
+
+    // Примитивы рендеринга
+    void drawRect(const Rect& rect, const Color& color, float thickness = 1.0f) override;
+    void fillRect(const Rect& rect, const Color& color) override;
+    void drawCircle(const Vector2f& center, float radius, const Color& color, float thickness = 1.0f) override;
+    void fillCircle(const Vector2f& center, float radius, const Color& color) override;
+    void drawLine(const Vector2f& start, const Vector2f& end, const Color& color, float thickness = 1.0f) override;
+    void drawTriangle(const Vector2f& p1, const Vector2f& p2, const Vector2f& p3,
+                      const Color& color, float thickness = 1.0f) override;
+    void fillTriangle(const Vector2f& p1, const Vector2f& p2, const Vector2f& p3, const Color& color) override;
+    // Скруглённые прямоугольники и фигуры вычисляются по знаковому расстоянию
+    // до контура, без тесселяции и швов между треугольниками
+    void fillRoundedRect(const Rect& rect, float radius, const Color& color) override;
+    void drawRoundedRect(const Rect& rect, float radius, const Color& color, float thickness = 1.0f) override;
+    void drawShape(const Rect& rect, const ShapeStyle& style) override;
+    // Путь заливается по рёбрам из кэша геометрии: четыре подстроки на пиксель
+    // и точное горизонтальное покрытие, без треугольников и швов между ними
+    void fillPath(const Path& path, const Color& color, FillRule rule = FillRule::NonZero) override;
+    void strokePath(const Path& path, const Color& color, const StrokeStyle& stroke = StrokeStyle()) override;
+
+    // Текст и изображения. Текст выводится встроенным растровым шрифтом 5x7,
+    // имя шрифта пока не учитывается.
+    void drawText(const std::string& text, const Vector2f& position,
+                  const std::string& font, float size, const Color& color) override;
+    void drawImage(const std::string& imagePath, const Rect& destRect,
+                   const Color& tint = Color::white()) override;
+
+    // Дескриптор указывает на текстуру и область в ней; строковые вызовы
+    // разрешают путь через ту же таблицу
+    ImageHandle resolveImage(const std::string& imagePath) override;
+    ImageHandle resolveImageRegion(ImageHandle image, const Rect& sourceRect) override;
+    ImageHandle createImage(const std::string& name, const utils::Image& image) override;
+    // Прежняя текстура освобождается в следующем beginFrame(): команды текущего
+    // кадра, в том числе на потоке рендеринга, продолжают её читать
+    ImageHandle updateImage(ImageHandle image, const utils::Image& pixels) override;
+    void releaseImage(ImageHandle image) override;
+    void drawImage(ImageHandle image, const Rect& destRect, const Color& tint = Color::white()) override;
+    // Без поворота изображение собирается в пикселях устройства один раз на размер
+    // и выводится одной командой; иначе — девять команд по частям текстуры
+    void drawNineSlice(ImageHandle image, const Rect& destRect, const NineSlice& slice,
+                       const Color& tint = Color::white()) override;
+
+    // Продвинутые функции рендеринга
+    void pushClipRect(const Rect& rect) override;
+    void popClipRect() override;
+    void pushTransform(const Transform& transform) override;
+    void pushTransform(const Affine& matrix) override;
+    void popTransform() override;
+
+    // Управление состоянием
+    void setBlendMode(BlendMode mode) override;
+    void setAntialiasing(bool enabled) override;
+    void setViewport(const Rect& viewport) override;
+
+    // Вспомогательные функции
+    Vector2f getTextSize(const std::string& text, const std::string& font, float size) override;
+    Vector2f getImageSize(const std::string& imagePath) override;
+    Vector2f getImageSize(ImageHandle image) override;
+    ClipTest testClip(const Rect& bounds) const override;
+    float getDeviceScale() const override;
+    // Измерение и разрешение изображений защищены мьютексом
+    bool isMeasureThreadSafe() const override { return true; }
+
+    // Цель рендеринга. Внешнее изображение должно жить дольше рендерера
+    // и переводится в формат RGBA; nullptr возвращает собственный буфер.
+    void setTarget(utils::Image* target);
+    void resize(unsigned int width, unsigned int height);
+    const utils::Image& getTarget() const;
+
+    unsigned int getThreadCount() const;
+
+    // Режим применяется со следующего beginFrame(); статистика и счётчики — последнего кадра
+    void setOverdrawMode(OverdrawMode mode);
+    OverdrawMode getOverdrawMode() const;
+    const OverdrawStats& getOverdrawStats() const;
+    uint32_t getOverdrawCount(unsigned int x, unsigned int y) const;
+
+    // Кэш шейпинга текста: число строк в кэше и статистика попаданий
+    void setGlyphCacheCapacity(size_t runs);
+    GlyphRunCache::Stats getGlyphCacheStats() const;
+    // Кэш геометрии путей; читается между кадрами
+    const PathCache::Stats& getPathCacheStats() const;
+
+    // Байт пикселей собранных девятисрезовых изображений; 0 отключает кэш
+    void setNineSliceCacheBudget(size_t bytes);
+    NineSliceCacheStats getNineSliceCacheStats() const;
+
+private:
+    struct Implementation;
+    std::unique_ptr<Implementation> impl_;
+};
+
+} // namespace gui
\ No newline at end of file
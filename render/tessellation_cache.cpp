@@ -0,0 +1,210 @@
+#include "tessellation_cache.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace gui {
+
+namespace {
+
+constexpr float kPi = 3.14159265358979323846f;
+constexpr unsigned int kMinSegments = 8;
+constexpr unsigned int kMaxSegments = 1024;
+
+// Радиус и толщина квантуются до 1/8 единицы, допуск — до 1/256
+constexpr float kLengthQuantum = 8.0f;
+constexpr float kToleranceQuantum = 256.0f;
+
+uint64_t quantize(float value, float quantum, uint64_t limit) {
+    const float scaled = std::round(std::max(value, 0.0f) * quantum);
+    return std::min(static_cast<uint64_t>(scaled), limit);
+}
+
+float dequantize(float value, float quantum) {
+    return std::round(std::max(value, 0.0f) * quantum) / quantum;
+}
+
+// Угол стороны k·90°: точка дуги поворачивается в свою четверть и
+// масштабируется на радиус угла
+Affine cornerMapping(unsigned int k, const Vector2f& center, float radius) {
+    static const float kCos[4] = {1.0f, 0.0f, -1.0f, 0.0f};
+    static const float kSin[4] = {0.0f, 1.0f, 0.0f, -1.0f};
+    Affine m;
+    m.a = kCos[k] * radius;
+    m.b = kSin[k] * radius;
+    m.c = -kSin[k] * radius;
+    m.d = kCos[k] * radius;
+    m.tx = center.x;
+    m.ty = center.y;
+    return m;
+}
+
+// Контур скруглённого прямоугольника по часовой стрелке (ось y вниз),
+// начиная с правого нижнего угла; число точек одинаково для любого радиуса
+void appendOutline(std::vector<Vector2f>& out, const std::vector<Vector2f>& arc, const Rect& box, float radius) {
+    const float x0 = box.position.x, y0 = box.position.y;
+    const float x1 = x0 + box.size.x, y1 = y0 + box.size.y;
+    const Vector2f centers[4] = {
+        Vector2f(x1 - radius, y1 - radius), Vector2f(x0 + radius, y1 - radius),
+        Vector2f(x0 + radius, y0 + radius), Vector2f(x1 - radius, y0 + radius)
+    };
+
+    const size_t begin = out.size();
+    out.resize(begin + arc.size() * 4);
+    for (unsigned int k = 0; k < 4; ++k) {
+        cornerMapping(k, centers[k], radius).transformPoints(arc.data(), out.data() + begin + k * arc.size(),
+                                                             arc.size());
+    }
+}
+
+} // namespace
+
+TessellationCache::TessellationCache(size_t capacity) : cache_(capacity) {}
+
+unsigned int TessellationCache::segmentsFor(float radius, float tolerance) {
+    if (radius <= tolerance || tolerance <= 0.0f)
+        return kMinSegments;
+    // Угол, при котором стрелка хорды равна допуску
+    const float step = 2.0f * std::acos(1.0f - tolerance / radius);
+    const unsigned int segments = static_cast<unsigned int>(std::ceil(2.0f * kPi / step));
+    // Кратно четырём, чтобы четверть окружности делилась на целое число сегментов
+    return (std::clamp(segments, kMinSegments, kMaxSegments) + 3u) & ~3u;
+}
+
+uint64_t TessellationCache::makeKey(Shape shape, float radius, float thickness, float tolerance) {
+    uint64_t radiusField = 0, thicknessField = 0, toleranceField = 0;
+    if (shape == Shape::Ring) {
+        radiusField = quantize(radius, kLengthQuantum, 0xFFFFFF);
+        thicknessField = quantize(thickness, kLengthQuantum, 0xFFFF);
+        toleranceField = quantize(tolerance, kToleranceQuantum, 0xFFFF);
+    } else {
+        radiusField = segmentsFor(radius, tolerance);
+    }
+    return (static_cast<uint64_t>(shape) << 56) | (radiusField << 32) | (thicknessField << 16) | toleranceField;
+}
+
+void TessellationCache::build(Shape shape, float radius, float thickness, float tolerance,
+                              std::vector<Vector2f>& out) {
+    switch (shape) {
+        case Shape::Disc: {
+            const unsigned int segments = segmentsFor(radius, tolerance);
+            out.reserve(segments * 3);
+            for (unsigned int i = 0; i < segments; ++i) {
+                const float a0 = 2.0f * kPi * i / segments;
+                const float a1 = 2.0f * kPi * (i + 1) / segments;
+                out.push_back(Vector2f());
+                out.push_back(Vector2f(std::cos(a0), std::sin(a0)));
+                out.push_back(Vector2f(std::cos(a1), std::sin(a1)));
+            }
+            break;
+        }
+        case Shape::Ring: {
+            // Строится по квантованным значениям, чтобы сетка не зависела от первого вызова
+            const float r = dequantize(radius, kLengthQuantum);
+            const float t = dequantize(thickness, kLengthQuantum);
+            const float outer = r + t * 0.5f;
+            if (outer <= 0.0f)
+                break;
+            const float inner = std::max(0.0f, r - t * 0.5f) / outer;
+            const unsigned int segments = segmentsFor(outer, dequantize(tolerance, kToleranceQuantum));
+            out.reserve(segments * 6);
+            for (unsigned int i = 0; i < segments; ++i) {
+                const float a0 = 2.0f * kPi * i / segments;
+                const float a1 = 2.0f * kPi * (i + 1) / segments;
+                const Vector2f d0(std::cos(a0), std::sin(a0));
+                const Vector2f d1(std::cos(a1), std::sin(a1));
+                out.push_back(d0);
+                out.push_back(d1);
+                out.push_back(d1 * inner);
+                out.push_back(d0);
+                out.push_back(d1 * inner);
+                out.push_back(d0 * inner);
+            }
+            break;
+        }
+        case Shape::Arc: {
+            const unsigned int segments = std::max(2u, segmentsFor(radius, tolerance) / 4);
+            out.reserve(segments + 1);
+            for (unsigned int i = 0; i <= segments; ++i) {
+                const float angle = 0.5f * kPi * i / segments;
+                out.push_back(Vector2f(std::cos(angle), std::sin(angle)));
+            }
+            // Концы дуги точные, чтобы стороны прямоугольника не расходились
+            out.front() = Vector2f(1.0f, 0.0f);
+            out.back() = Vector2f(0.0f, 1.0f);
+            break;
+        }
+    }
+}
+
+const std::vector<Vector2f>& TessellationCache::get(Shape shape, float radius, float thickness, float tolerance) {
+    bool created = false;
+    std::vector<Vector2f>& points = cache_.lookup(makeKey(shape, radius, thickness, tolerance), created);
+    if (created)
+        build(shape, radius, thickness, tolerance, points);
+    return points;
+}
+
+void TessellationCache::appendCircle(std::vector<Vector2f>& out, const Vector2f& center, float radius,
+                                     float thickness, float tolerance) {
+    if (radius <= 0.0f)
+        return;
+
+    const bool stroke = thickness > 0.0f;
+    const std::vector<Vector2f>& mesh = stroke ? get(Shape::Ring, radius, thickness, tolerance)
+                                               : get(Shape::Disc, radius, 0.0f, tolerance);
+    const float scale = stroke ? radius + thickness * 0.5f : radius;
+
+    const size_t begin = out.size();
+    out.resize(begin + mesh.size());
+    const Affine mapping = Affine::translation(center.x, center.y) * Affine::scaling(scale, scale);
+    mapping.transformPoints(mesh.data(), out.data() + begin, mesh.size());
+}
+
+void TessellationCache::appendRoundedRect(std::vector<Vector2f>& out, const Rect& rect, float radius,
+                                          float thickness, float tolerance) {
+    const float shortSide = std::min(rect.size.x, rect.size.y);
+    if (shortSide <= 0.0f)
+        return;
+
+    // Без скругления угол вырождается в одну точку
+    static const std::vector<Vector2f> kSharpCorner(1, Vector2f());
+    const float r = std::clamp(radius, 0.0f, shortSide * 0.5f);
+    const std::vector<Vector2f>& arc = r > 0.0f ? get(Shape::Arc, r, 0.0f, tolerance) : kSharpCorner;
+
+    outline_.clear();
+    appendOutline(outline_, arc, rect, r);
+    const size_t count = outline_.size();
+
+    if (thickness <= 0.0f) {
+        // Контур выпуклый, поэтому достаточно веера из центра
+        const Vector2f center = rect.position + rect.size * 0.5f;
+        out.reserve(out.size() + count * 3);
+        for (size_t i = 0; i < count; ++i) {
+            out.push_back(center);
+            out.push_back(outline_[i]);
+            out.push_back(outline_[(i + 1) % count]);
+        }
+        return;
+    }
+
+    const float t = std::min(thickness, shortSide * 0.5f);
+    const Rect inner(rect.position + Vector2f(t, t), rect.size - Vector2f(t * 2.0f, t * 2.0f));
+    appendOutline(outline_, arc, inner, std::max(0.0f, r - t));
+
+    out.reserve(out.size() + count * 6);
+    for (size_t i = 0; i < count; ++i) {
+        const size_t next = (i + 1) % count;
+        const Vector2f& o0 = outline_[i];
+        const Vector2f& o1 = outline_[next];
+        const Vector2f& i0 = outline_[count + i];
+        const Vector2f& i1 = outline_[count + next];
+        out.push_back(o0);
+        out.push_back(o1);
+        out.push_back(i1);
+        out.push_back(o0);
+        out.push_back(i1);
+        out.push_back(i0);
+    }
+}
+
+} // namespace gui
\ No newline at end of file
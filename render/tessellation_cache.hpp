@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "../core/math_types.hpp"
+#include "lru_cache.hpp"
+
+namespace gui {
+
+// Кэш тесселяции скруглённой геометрии в единичном пространстве.
+// Сетка зависит только от вида фигуры, квантованного радиуса, толщины и допуска,
+// поэтому строится один раз и переносится на место преобразованием.
+// Для круга и дуги сетка определяется числом сегментов, и радиус входит
+// в ключ через него. Не потокобезопасен.
+class TessellationCache {
+public:
+    enum class Shape : uint8_t {
+        Disc,   // треугольники круга радиуса 1 с центром в начале координат
+        Ring,   // треугольники кольца: внешний радиус 1, внутренний по толщине
+        Arc     // точки четверти окружности радиуса 1 от (1, 0) до (0, 1)
+    };
+
+    using Stats = CacheStats;
+
+    // Максимальное отклонение хорды от окружности, в единицах рисования
+    static constexpr float kDefaultTolerance = 0.25f;
+
+    explicit TessellationCache(size_t capacity = 256);
+
+    // Единичная сетка; для Ring radius и thickness задают кольцо до нормировки.
+    // Ссылка действительна до следующего get() или clear()
+    const std::vector<Vector2f>& get(Shape shape, float radius, float thickness = 0.0f,
+                                     float tolerance = kDefaultTolerance);
+
+    // Треугольники (по три точки) в координатах рисования.
+    // thickness <= 0 — заливка; обводка круга центрирована на окружности,
+    // обводка прямоугольника лежит внутри него, как у drawRect
+    void appendCircle(std::vector<Vector2f>& out, const Vector2f& center, float radius,
+                      float thickness = 0.0f, float tolerance = kDefaultTolerance);
+    void appendRoundedRect(std::vector<Vector2f>& out, const Rect& rect, float radius,
+                           float thickness = 0.0f, float tolerance = kDefaultTolerance);
+
+    // Число сегментов полной окружности для радиуса и допуска
+    static unsigned int segmentsFor(float radius, float tolerance);
+
+    void clear() { cache_.clear(); }
+    void setCapacity(size_t capacity) { cache_.setCapacity(capacity); }
+    const Stats& getStats() const { return cache_.getStats(); }
+    void resetStats() { cache_.resetStats(); }
+
+private:
+    // Ключ однозначно задаёт сетку, поэтому попадание не сверяется
+    static uint64_t makeKey(Shape shape, float radius, float thickness, float tolerance);
+    static void build(Shape shape, float radius, float thickness, float tolerance, std::vector<Vector2f>& out);
+
+    LruCache<std::vector<Vector2f>> cache_;
+    std::vector<Vector2f> outline_;
+};
+
+} // namespace gui
\ No newline at end of file
@@ -0,0 +1,171 @@
+// Память и скорость обработчиков событий и пользовательских стилей Widget.
+// Самостоятельная программа: собирается вместе с исходниками ядра и печатает
+// размер виджета, память обработчиков и стилей на виджет, время рассылки
+// события и поиска стиля, в том числе из нескольких потоков.
+#include "../../core/widget_base.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace {
+
+std::atomic<size_t> g_bytes{0};
+std::atomic<size_t> g_allocations{0};
+
+// Учитывается реально выделенный блок, если аллокатор его сообщает
+size_t blockSize(void* pointer, size_t requested) {
+#if defined(__GLIBC__)
+    (void)requested;
+    return malloc_usable_size(pointer);
+#else
+    (void)pointer;
+    return requested;
+#endif
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    void* pointer = std::malloc(size ? size : 1);
+    if (!pointer)
+        throw std::bad_alloc();
+    g_bytes += blockSize(pointer, size);
+    ++g_allocations;
+    return pointer;
+}
+
+void operator delete(void* pointer) noexcept {
+    if (!pointer)
+        return;
+    g_bytes -= blockSize(pointer, 0);
+    --g_allocations;
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    operator delete(pointer);
+}
+
+namespace {
+
+using namespace gui;
+using Clock = std::chrono::steady_clock;
+
+constexpr int kWidgets = 20000;
+constexpr int kRounds = 100;
+
+double elapsedNs(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+void measureStyleLookup(const std::vector<Widget*>& widgets) {
+    const std::string property = "cursor";
+    size_t found = 0;
+
+    auto start = Clock::now();
+    for (int round = 0; round < kRounds; ++round) {
+        for (Widget* widget : widgets)
+            found += widget->getCustomStyle(property).size();
+    }
+    const double byName = elapsedNs(start) / (static_cast<double>(kWidgets) * kRounds);
+
+    const std::string* key = Widget::internStyleName(property);
+    start = Clock::now();
+    for (int round = 0; round < kRounds; ++round) {
+        for (Widget* widget : widgets)
+            found += widget->getCustomStyle(key).size();
+    }
+    const double byKey = elapsedNs(start) / (static_cast<double>(kWidgets) * kRounds);
+
+    std::printf("getCustomStyle: %.2f ns by name, %.2f ns by interned name (%zu)\n", byName, byKey, found);
+}
+
+// Параллельная запись поддеревьев читает стили из всех потоков сразу
+void measureParallelStyleLookup(const std::vector<Widget*>& widgets) {
+    const unsigned int threadCount = std::max(2u, std::thread::hardware_concurrency());
+    const size_t slice = widgets.size() / threadCount;
+    std::atomic<size_t> found{0};
+
+    const auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&, t] {
+            const std::string property = "cursor";
+            size_t local = 0;
+            for (int round = 0; round < kRounds; ++round) {
+                for (size_t i = t * slice; i < (t + 1) * slice; ++i)
+                    local += widgets[i]->getCustomStyle(property).size();
+            }
+            found += local;
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    const double total = elapsedNs(start) / (static_cast<double>(slice) * threadCount * kRounds);
+
+    std::printf("getCustomStyle by name, %u threads: %.2f ns per lookup overall (%zu)\n", threadCount, total,
+                found.load());
+}
+
+} // namespace
+
+int main() {
+    std::vector<Widget*> widgets;
+    widgets.reserve(kWidgets);
+
+    const size_t emptyBytes = g_bytes;
+    for (int i = 0; i < kWidgets; ++i)
+        widgets.push_back(new Widget());
+    const double bytesPerWidget = static_cast<double>(g_bytes - emptyBytes) / kWidgets;
+
+    long long sink = 0;
+    long long* target = &sink;
+    const int press = 1;
+    const int release = 2;
+    const size_t bytesBefore = g_bytes;
+    const size_t allocationsBefore = g_allocations;
+    for (Widget* widget : widgets) {
+        widget->setOnMousePress([target, widget, &press](const Event&) {
+            *target += press;
+            (void)widget;
+        });
+        widget->setOnMouseRelease([target, &release](const Event&) { *target += release; });
+        widget->setCustomStyle("font-weight", "bold");
+        widget->setCustomStyle("cursor", "pointer");
+    }
+    std::printf("sizeof(Widget) = %zu, heap per empty widget %.1f bytes\n", sizeof(Widget), bytesPerWidget);
+    std::printf("two handlers and two styles: %.1f bytes in %.2f allocations per widget\n",
+                static_cast<double>(g_bytes - bytesBefore) / kWidgets,
+                static_cast<double>(g_allocations - allocationsBefore) / kWidgets);
+
+    // Одно событие с обработчиком и два без него на каждый виджет
+    const Event pressEvent(Event::Type::MousePress);
+    const Event moveEvent(Event::Type::MouseMove);
+    const Event keyEvent(Event::Type::KeyRelease);
+    const auto start = Clock::now();
+    for (int round = 0; round < kRounds; ++round) {
+        for (Widget* widget : widgets) {
+            widget->handleEvent(pressEvent);
+            widget->handleEvent(moveEvent);
+            widget->handleEvent(keyEvent);
+        }
+    }
+    std::printf("handleEvent: %.2f ns per event (%lld)\n",
+                elapsedNs(start) / (static_cast<double>(kWidgets) * kRounds * 3), sink);
+
+    measureStyleLookup(widgets);
+    measureParallelStyleLookup(widgets);
+
+    for (Widget* widget : widgets)
+        delete widget;
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,150 @@
+// Проходы WidgetStore против обхода дерева по указателям. Самостоятельная
+// программа: строит 50000 виджетов (500 контейнеров по 99 детей, часть
+// повёрнута, масштабирована или скрыта) и печатает время пересчёта
+// преобразований, отсечения по видимой области и поиска под курсором,
+// сверяя результаты обоих способов.
+#include "../../core/widget_store.hpp"
+#include "../../elements/containers.hpp"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+using namespace gui;
+using Clock = std::chrono::steady_clock;
+
+constexpr int kGroups = 500;
+constexpr int kChildren = 99;
+constexpr int kCullRounds = 20;
+constexpr int kHitPoints = 200;
+
+double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Обход по указателям: мировое преобразование накапливается по пути,
+// дети берутся через dynamic_cast к Container
+void walkCull(const Widget& widget, const Affine& parent, const Rect& view, std::vector<const Widget*>& visible) {
+    if (!widget.isVisible())
+        return;
+    const Affine world = parent * widget.getLocalTransform();
+    if (world.mapRect(Rect(widget.getPosition(), widget.getSize())).intersects(view))
+        visible.push_back(&widget);
+    if (const auto* container = dynamic_cast<const Container*>(&widget)) {
+        for (const auto& child : container->getChildren())
+            walkCull(*child, world, view, visible);
+    }
+}
+
+const Widget* walkHitTest(const Widget& widget, const Affine& parent, const Vector2f& point) {
+    if (!widget.isVisible())
+        return nullptr;
+    const Affine world = parent * widget.getLocalTransform();
+    const Widget* hit = nullptr;
+    if (widget.isEnabled() && Rect(widget.getPosition(), widget.getSize()).contains(world.inverse().apply(point)))
+        hit = &widget;
+    // Позже нарисованный ребёнок лежит сверху
+    if (const auto* container = dynamic_cast<const Container*>(&widget)) {
+        for (const auto& child : container->getChildren()) {
+            if (const Widget* childHit = walkHitTest(*child, world, point))
+                hit = childHit;
+        }
+    }
+    return hit;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    auto root = std::make_shared<Container>();
+    root->setSize(Vector2f(4000, 4000));
+    std::vector<std::shared_ptr<Container>> groups;
+    for (int g = 0; g < kGroups; ++g) {
+        auto group = std::make_shared<Container>();
+        group->setPosition(Vector2f(unit(random) * 3800, unit(random) * 3800));
+        group->setSize(Vector2f(200, 200));
+        if (g % 7 == 0)
+            group->setRotation(15.0f);
+        if (g % 11 == 0)
+            group->setScale(Vector2f(1.5f, 1.5f));
+        if (g % 13 == 0)
+            group->setVisible(false);
+        root->addChild(group);
+        groups.push_back(group);
+
+        for (int i = 0; i < kChildren; ++i) {
+            auto widget = std::make_shared<Widget>();
+            widget->setPosition(group->getPosition() + Vector2f(unit(random) * 180, unit(random) * 180));
+            widget->setSize(Vector2f(20, 15));
+            if (i % 17 == 0)
+                widget->setEnabled(false);
+            group->addChild(widget);
+        }
+    }
+
+    WidgetStore store;
+    auto start = Clock::now();
+    root->setWidgetStore(&store);
+    const double bindMs = elapsedMs(start);
+    start = Clock::now();
+    store.updateTransforms();
+    const double updateMs = elapsedMs(start);
+    const WidgetStore::Stats stats = store.getStats();
+    std::printf("%zu widgets, %.1f bytes per widget; bind %.2f ms, first updateTransforms %.2f ms\n",
+                stats.widgetCount, static_cast<double>(stats.bytes) / stats.widgetCount, bindMs, updateMs);
+
+    // Отсечение по области размером с окно
+    const Rect view(Vector2f(1000, 1000), Vector2f(1280, 800));
+    std::vector<WidgetStore::Handle> visible;
+    std::vector<const Widget*> walked;
+    start = Clock::now();
+    for (int round = 0; round < kCullRounds; ++round) {
+        visible.clear();
+        store.cull(view, visible);
+    }
+    const double storeCullMs = elapsedMs(start) / kCullRounds;
+    start = Clock::now();
+    for (int round = 0; round < kCullRounds; ++round) {
+        walked.clear();
+        walkCull(*root, Affine(), view, walked);
+    }
+    const double walkCullMs = elapsedMs(start) / kCullRounds;
+    bool same = visible.size() == walked.size();
+    for (size_t i = 0; same && i < visible.size(); ++i)
+        same = store.getWidget(visible[i]) == walked[i];
+    std::printf("cull: store %.3f ms, pointer walk %.3f ms, %zu visible, results %s\n", storeCullMs, walkCullMs,
+                visible.size(), same ? "match" : "DIFFER");
+
+    // Поиск под курсором в случайных точках
+    double storeHitMs = 0.0;
+    double walkHitMs = 0.0;
+    int agree = 0;
+    for (int i = 0; i < kHitPoints; ++i) {
+        const Vector2f point(unit(random) * 4000, unit(random) * 4000);
+        start = Clock::now();
+        const WidgetStore::Handle handle = store.hitTest(point);
+        storeHitMs += elapsedMs(start);
+        start = Clock::now();
+        const Widget* hit = walkHitTest(*root, Affine(), point);
+        walkHitMs += elapsedMs(start);
+        agree += store.getWidget(handle) == hit;
+    }
+    std::printf("hitTest: store %.4f ms, pointer walk %.4f ms, %d/%d results match\n", storeHitMs / kHitPoints,
+                walkHitMs / kHitPoints, agree, kHitPoints);
+
+    // Сдвиг одного контейнера пересчитывает только его поддерево
+    groups[3]->setPosition(groups[3]->getPosition() + Vector2f(10, 0));
+    start = Clock::now();
+    store.updateTransforms();
+    std::printf("updateTransforms after moving one container: %.3f ms, %zu slots\n", elapsedMs(start),
+                store.getStats().transformsUpdated);
+
+    root->setWidgetStore(nullptr);
+    return 0;
+}
\ No newline at end of file
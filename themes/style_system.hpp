@@ -1,4 +1,5 @@
 #pragma once
+#include <cmath>
 #include <string>
 #include <unordered_map>
 #include <memory>
@@ -14,6 +15,17 @@ enum class EaseType {
     EaseInOut
 };
 
+// Часть прямоугольника box, которую заливка фона закрывает непрозрачно.
+// Пустой прямоугольник — фон просвечивает. Для скруглённых углов остаётся
+// прямоугольник, вписанный в скругление по диагонали.
+inline Rect opaqueFillArea(const Rect& box, const Color& background, float opacity, float cornerRadius) {
+    if (box.isEmpty() || opacity < 1.0f || background.a < 1.0f)
+        return Rect();
+    const float radius = std::fmin(std::fmax(cornerRadius, 0.0f), std::fmin(box.size.x, box.size.y) * 0.5f);
+    const float inset = radius * (1.0f - 0.70710678f);
+    return Rect(box.position + Vector2f(inset, inset), box.size - Vector2f(inset * 2.0f, inset * 2.0f));
+}
+
 // Базовый класс для стилей
 class Style {
 public:
@@ -65,6 +77,13 @@ public:
         bool enabled = true;
     } animation;
 
+    // Область box, закрытая фоном этого стиля непрозрачно
+    Rect getOpaqueArea(const Rect& box) const {
+        if (gradient.enabled && (gradient.startColor.a < 1.0f || gradient.endColor.a < 1.0f))
+            return Rect();
+        return opaqueFillArea(box, backgroundColor, opacity, borderRadius);
+    }
+
     // Клонирование стиля
     virtual std::unique_ptr<Style> clone() const {
         return std::make_unique<Style>(*this);
@@ -1,11 +1,456 @@
 #include "image.hpp"
 #include <algorithm>
+#include <array>
+#include <cctype>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 #include <random>
 #include <stdexcept>
 
 namespace gui::utils {
 
+namespace {
+
+inline uint64_t mix64(uint64_t v) {
+    v ^= v >> 33;
+    v *= 0xff51afd7ed558ccdULL;
+    v ^= v >> 33;
+    v *= 0xc4ceb9fe1a85ec53ULL;
+    v ^= v >> 33;
+    return v;
+}
+
+// Обрабатывает данные словами по 8 байт; для иконок это на порядок быстрее побайтового FNV
+uint64_t hashBytes(const uint8_t* data, size_t size, uint64_t seed) {
+    const uint64_t prime = 0x9E3779B97F4A7C15ULL;
+    uint64_t h = seed ^ (size * prime);
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        h ^= mix64(word);
+        h = ((h << 27) | (h >> 37)) * prime;
+    }
+
+    uint64_t tail = 0;
+    for (size_t shift = 0; i < size; ++i, shift += 8) {
+        tail |= static_cast<uint64_t>(data[i]) << shift;
+    }
+    h ^= mix64(tail);
+
+    return mix64(h);
+}
+
+uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+    static const auto table = []() {
+        std::array<uint32_t, 256> result{};
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            result[n] = c;
+        }
+        return result;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+void appendBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void appendChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& payload) {
+    appendBigEndian(out, static_cast<uint32_t>(payload.size()));
+    const size_t typeOffset = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), payload.begin(), payload.end());
+    appendBigEndian(out, crc32(out.data() + typeOffset, payload.size() + 4));
+}
+
+uint32_t readBigEndian(const uint8_t* data) {
+    return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) |
+           (static_cast<uint32_t>(data[2]) << 8) | static_cast<uint32_t>(data[3]);
+}
+
+// Биты deflate-потока, младшими вперёд
+struct BitReader {
+    const uint8_t* data;
+    size_t size;
+    size_t position = 0;
+    uint32_t buffer = 0;
+    int count = 0;
+
+    bool read(int bits, uint32_t& value) {
+        while (count < bits) {
+            if (position >= size)
+                return false;
+            buffer |= static_cast<uint32_t>(data[position++]) << count;
+            count += 8;
+        }
+        value = buffer & ((1u << bits) - 1);
+        buffer >>= bits;
+        count -= bits;
+        return true;
+    }
+
+    void alignToByte() {
+        buffer >>= count & 7;
+        count -= count & 7;
+    }
+};
+
+// Канонический код Хаффмана: число кодов каждой длины и символы по возрастанию кода
+struct Huffman {
+    uint16_t counts[16];
+    uint16_t symbols[288];
+};
+
+bool buildHuffman(Huffman& huffman, const uint8_t* lengths, int count) {
+    std::fill(std::begin(huffman.counts), std::end(huffman.counts), 0);
+    for (int i = 0; i < count; ++i)
+        ++huffman.counts[lengths[i]];
+    huffman.counts[0] = 0;
+
+    // Переподписанный код недопустим, неполный (один код расстояния) — допустим
+    int left = 1;
+    for (int length = 1; length < 16; ++length) {
+        left = (left << 1) - huffman.counts[length];
+        if (left < 0)
+            return false;
+    }
+
+    uint16_t offsets[16] = {};
+    for (int length = 1; length < 15; ++length)
+        offsets[length + 1] = offsets[length] + huffman.counts[length];
+    for (int i = 0; i < count; ++i) {
+        if (lengths[i] != 0)
+            huffman.symbols[offsets[lengths[i]]++] = static_cast<uint16_t>(i);
+    }
+    return true;
+}
+
+bool decodeSymbol(BitReader& in, const Huffman& huffman, int& symbol) {
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    for (int length = 1; length < 16; ++length) {
+        uint32_t bit;
+        if (!in.read(1, bit))
+            return false;
+        code |= static_cast<int>(bit);
+        const int count = huffman.counts[length];
+        if (code - first < count) {
+            symbol = huffman.symbols[index + code - first];
+            return true;
+        }
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+    return false;
+}
+
+bool inflateCodes(BitReader& in, const Huffman& literals, const Huffman& distances, std::vector<uint8_t>& out,
+                  size_t limit) {
+    static const uint16_t lengthBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                            31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const uint8_t lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                            2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static const uint16_t distanceBase[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,
+                                              33,  49,  65,  97,  129, 193,  257,  385,  513,  769,
+                                              1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    static const uint8_t distanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                              6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+    for (;;) {
+        int symbol;
+        if (!decodeSymbol(in, literals, symbol))
+            return false;
+        if (symbol < 256) {
+            if (out.size() >= limit)
+                return false;
+            out.push_back(static_cast<uint8_t>(symbol));
+            continue;
+        }
+        if (symbol == 256)
+            return true;
+
+        symbol -= 257;
+        uint32_t extra;
+        if (symbol >= 29 || !in.read(lengthExtra[symbol], extra))
+            return false;
+        const size_t length = lengthBase[symbol] + extra;
+        if (!decodeSymbol(in, distances, symbol) || symbol >= 30 || !in.read(distanceExtra[symbol], extra))
+            return false;
+        const size_t distance = distanceBase[symbol] + extra;
+        if (distance > out.size() || out.size() + length > limit)
+            return false;
+        // Копия может перекрывать сама себя, поэтому побайтно
+        const size_t from = out.size() - distance;
+        for (size_t i = 0; i < length; ++i)
+            out.push_back(out[from + i]);
+    }
+}
+
+// zlib-поток; больше limit байт распаковать нельзя
+bool inflateZlib(const uint8_t* data, size_t size, std::vector<uint8_t>& out, size_t limit) {
+    if (size < 6 || (data[0] & 0x0F) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20))
+        return false;
+
+    BitReader in{data + 2, size - 6};
+    uint32_t last = 0;
+    do {
+        uint32_t type;
+        if (!in.read(1, last) || !in.read(2, type))
+            return false;
+
+        if (type == 0) {
+            in.alignToByte();
+            uint32_t length, inverse;
+            if (!in.read(16, length) || !in.read(16, inverse) || length != (~inverse & 0xFFFF) ||
+                out.size() + length > limit)
+                return false;
+            for (uint32_t i = 0; i < length; ++i) {
+                uint32_t byte;
+                if (!in.read(8, byte))
+                    return false;
+                out.push_back(static_cast<uint8_t>(byte));
+            }
+            continue;
+        }
+
+        Huffman literals, distances;
+        uint8_t lengths[320];
+        if (type == 1) {
+            std::fill(lengths, lengths + 144, 8);
+            std::fill(lengths + 144, lengths + 256, 9);
+            std::fill(lengths + 256, lengths + 280, 7);
+            std::fill(lengths + 280, lengths + 288, 8);
+            std::fill(lengths + 288, lengths + 318, 5);
+            buildHuffman(literals, lengths, 288);
+            buildHuffman(distances, lengths + 288, 30);
+        } else if (type == 2) {
+            static const uint8_t order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+            uint32_t literalCount, distanceCount, codeCount;
+            if (!in.read(5, literalCount) || !in.read(5, distanceCount) || !in.read(4, codeCount))
+                return false;
+            literalCount += 257;
+            distanceCount += 1;
+            codeCount += 4;
+            if (literalCount > 286 || distanceCount > 30)
+                return false;
+
+            uint8_t codeLengths[19] = {};
+            for (uint32_t i = 0; i < codeCount; ++i) {
+                uint32_t length;
+                if (!in.read(3, length))
+                    return false;
+                codeLengths[order[i]] = static_cast<uint8_t>(length);
+            }
+            Huffman lengthCode;
+            if (!buildHuffman(lengthCode, codeLengths, 19))
+                return false;
+
+            // Длины кодов литералов и расстояний идут одним рядом
+            const uint32_t total = literalCount + distanceCount;
+            for (uint32_t i = 0; i < total;) {
+                int symbol;
+                if (!decodeSymbol(in, lengthCode, symbol))
+                    return false;
+                if (symbol < 16) {
+                    lengths[i++] = static_cast<uint8_t>(symbol);
+                    continue;
+                }
+                uint8_t value = 0;
+                uint32_t repeat;
+                if (symbol == 16) {
+                    if (i == 0 || !in.read(2, repeat))
+                        return false;
+                    value = lengths[i - 1];
+                    repeat += 3;
+                } else if (symbol == 17) {
+                    if (!in.read(3, repeat))
+                        return false;
+                    repeat += 3;
+                } else {
+                    if (!in.read(7, repeat))
+                        return false;
+                    repeat += 11;
+                }
+                if (i + repeat > total)
+                    return false;
+                std::fill(lengths + i, lengths + i + repeat, value);
+                i += repeat;
+            }
+            if (lengths[256] == 0 || !buildHuffman(literals, lengths, static_cast<int>(literalCount)) ||
+                !buildHuffman(distances, lengths + literalCount, static_cast<int>(distanceCount)))
+                return false;
+        } else {
+            return false;
+        }
+
+        if (!inflateCodes(in, literals, distances, out, limit))
+            return false;
+    } while (!last);
+
+    uint32_t a = 1, b = 0;
+    for (uint8_t byte : out) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    return readBigEndian(data + size - 4) == ((b << 16) | a);
+}
+
+uint8_t paeth(int left, int up, int upLeft) {
+    const int estimate = left + up - upLeft;
+    const int distanceLeft = std::abs(estimate - left);
+    const int distanceUp = std::abs(estimate - up);
+    const int distanceUpLeft = std::abs(estimate - upLeft);
+    if (distanceLeft <= distanceUp && distanceLeft <= distanceUpLeft)
+        return static_cast<uint8_t>(left);
+    return static_cast<uint8_t>(distanceUp <= distanceUpLeft ? up : upLeft);
+}
+
+// Снимает фильтры строк на месте; bpp — байт на пиксель
+bool unfilterRows(std::vector<uint8_t>& raw, size_t rowSize, unsigned int height, unsigned int bpp) {
+    for (unsigned int y = 0; y < height; ++y) {
+        uint8_t* row = raw.data() + y * (rowSize + 1);
+        const uint8_t filter = row[0];
+        ++row;
+        const uint8_t* previous = y > 0 ? row - (rowSize + 1) : nullptr;
+        for (size_t i = 0; i < rowSize; ++i) {
+            const int left = i >= bpp ? row[i - bpp] : 0;
+            const int up = previous ? previous[i] : 0;
+            const int upLeft = previous && i >= bpp ? previous[i - bpp] : 0;
+            switch (filter) {
+                case 0: break;
+                case 1: row[i] = static_cast<uint8_t>(row[i] + left); break;
+                case 2: row[i] = static_cast<uint8_t>(row[i] + up); break;
+                case 3: row[i] = static_cast<uint8_t>(row[i] + ((left + up) >> 1)); break;
+                case 4: row[i] = static_cast<uint8_t>(row[i] + paeth(left, up, upLeft)); break;
+                default: return false;
+            }
+        }
+    }
+    return true;
+}
+
+// PNG с 8 битами на канал без чересстрочности. Серое с альфой и палитра
+// разворачиваются в RGBA
+bool decodePNG(const uint8_t* data, size_t size, unsigned int& width, unsigned int& height,
+               Image::Format& format, std::vector<uint8_t>& pixels) {
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    if (size < 8 || std::memcmp(data, signature, 8) != 0)
+        return false;
+
+    uint8_t colorType = 0;
+    bool header = false;
+    std::vector<uint8_t> compressed;
+    std::vector<uint8_t> palette;
+    std::vector<uint8_t> paletteAlpha;
+    size_t offset = 8;
+    for (;;) {
+        if (offset + 12 > size)
+            return false;
+        const uint32_t length = readBigEndian(data + offset);
+        if (length > size - offset - 12)
+            return false;
+        const uint8_t* type = data + offset + 4;
+        const uint8_t* payload = type + 4;
+        if (crc32(type, length + 4) != readBigEndian(payload + length))
+            return false;
+        offset += length + 12;
+
+        if (std::memcmp(type, "IHDR", 4) == 0) {
+            if (length != 13)
+                return false;
+            width = readBigEndian(payload);
+            height = readBigEndian(payload + 4);
+            colorType = payload[9];
+            // Только 8 бит на канал, стандартные сжатие и фильтрация, без чересстрочности
+            if (payload[8] != 8 || payload[10] != 0 || payload[11] != 0 || payload[12] != 0)
+                return false;
+            if (colorType != 0 && colorType != 2 && colorType != 3 && colorType != 4 && colorType != 6)
+                return false;
+            header = true;
+        } else if (std::memcmp(type, "PLTE", 4) == 0) {
+            palette.assign(payload, payload + length);
+        } else if (std::memcmp(type, "tRNS", 4) == 0) {
+            paletteAlpha.assign(payload, payload + length);
+        } else if (std::memcmp(type, "IDAT", 4) == 0) {
+            compressed.insert(compressed.end(), payload, payload + length);
+        } else if (std::memcmp(type, "IEND", 4) == 0) {
+            break;
+        } else if (!(type[0] & 0x20)) {
+            // Неизвестный обязательный фрагмент
+            return false;
+        }
+    }
+    if (!header || width == 0 || height == 0 || (colorType == 3 && palette.empty()))
+        return false;
+
+    static const unsigned int channelCounts[7] = {1, 0, 3, 1, 2, 0, 4};
+    const unsigned int channels = channelCounts[colorType];
+    const uint64_t rowSize = static_cast<uint64_t>(width) * channels;
+    const uint64_t rawSize = (rowSize + 1) * height;
+    // Заведомо неправдоподобный размер не распаковываем
+    if (rawSize > (uint64_t(1) << 31))
+        return false;
+
+    std::vector<uint8_t> raw;
+    raw.reserve(static_cast<size_t>(rawSize));
+    if (!inflateZlib(compressed.data(), compressed.size(), raw, static_cast<size_t>(rawSize)) ||
+        raw.size() != rawSize || !unfilterRows(raw, static_cast<size_t>(rowSize), height, channels))
+        return false;
+
+    const size_t pixelCount = static_cast<size_t>(width) * height;
+    switch (colorType) {
+        case 0: format = Image::Format::Grayscale; break;
+        case 2: format = Image::Format::RGB; break;
+        default: format = Image::Format::RGBA; break;
+    }
+    const unsigned int outChannels = colorType == 0 ? 1 : colorType == 2 ? 3 : 4;
+    pixels.resize(pixelCount * outChannels);
+
+    for (unsigned int y = 0; y < height; ++y) {
+        const uint8_t* source = raw.data() + y * (rowSize + 1) + 1;
+        uint8_t* target = pixels.data() + static_cast<size_t>(y) * width * outChannels;
+        if (colorType == 0 || colorType == 2 || colorType == 6) {
+            std::memcpy(target, source, static_cast<size_t>(rowSize));
+            continue;
+        }
+        for (unsigned int x = 0; x < width; ++x, target += 4) {
+            if (colorType == 4) {
+                target[0] = target[1] = target[2] = source[x * 2];
+                target[3] = source[x * 2 + 1];
+                continue;
+            }
+            const size_t index = source[x];
+            if (index * 3 + 2 >= palette.size())
+                return false;
+            target[0] = palette[index * 3];
+            target[1] = palette[index * 3 + 1];
+            target[2] = palette[index * 3 + 2];
+            target[3] = index < paletteAlpha.size() ? paletteAlpha[index] : 255;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
 Image::Image() : width_(0), height_(0), format_(Format::RGBA) {}
 
 Image::Image(unsigned int width, unsigned int height, Format format)
@@ -42,6 +487,129 @@ void Image::resize(unsigned int width, unsigned int height) {
     *this = std::move(newImage);
 }
 
+uint64_t Image::computeHash() const {
+    const uint64_t seed = (static_cast<uint64_t>(width_) << 32) ^
+                          (static_cast<uint64_t>(height_) << 4) ^
+                          static_cast<uint64_t>(format_);
+    return hashBytes(data_.data(), data_.size(), seed);
+}
+
+std::vector<uint8_t> Image::encodePNG() const {
+    const unsigned int channels = getBytesPerPixel();
+    uint8_t colorType = 6;
+    switch (format_) {
+        case Format::RGB:
+        case Format::BGR:       colorType = 2; break;
+        case Format::RGBA:
+        case Format::BGRA:      colorType = 6; break;
+        case Format::Grayscale: colorType = 0; break;
+    }
+    const bool swapRB = format_ == Format::BGR || format_ == Format::BGRA;
+
+    // Строки с фильтром None
+    const size_t rowSize = static_cast<size_t>(width_) * channels;
+    std::vector<uint8_t> raw;
+    raw.reserve((rowSize + 1) * height_);
+    for (unsigned int y = 0; y < height_; ++y) {
+        raw.push_back(0);
+        const uint8_t* row = data_.data() + y * rowSize;
+        if (!swapRB) {
+            raw.insert(raw.end(), row, row + rowSize);
+            continue;
+        }
+        for (unsigned int x = 0; x < width_; ++x) {
+            const uint8_t* px = row + x * channels;
+            raw.push_back(px[2]);
+            raw.push_back(px[1]);
+            raw.push_back(px[0]);
+            if (channels == 4)
+                raw.push_back(px[3]);
+        }
+    }
+
+    // zlib-поток из несжатых блоков deflate по 65535 байт
+    std::vector<uint8_t> zlib;
+    zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+    size_t offset = 0;
+    do {
+        const size_t block = std::min<size_t>(65535, raw.size() - offset);
+        const bool last = offset + block == raw.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(static_cast<uint8_t>(block & 0xFF));
+        zlib.push_back(static_cast<uint8_t>(block >> 8));
+        zlib.push_back(static_cast<uint8_t>(~block & 0xFF));
+        zlib.push_back(static_cast<uint8_t>((~block >> 8) & 0xFF));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + block);
+        offset += block;
+    } while (offset < raw.size());
+
+    uint32_t a = 1, b = 0;
+    for (uint8_t byte : raw) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    appendBigEndian(zlib, (b << 16) | a);
+
+    std::vector<uint8_t> header;
+    appendBigEndian(header, width_);
+    appendBigEndian(header, height_);
+    header.push_back(8);          // бит на канал
+    header.push_back(colorType);
+    header.push_back(0);          // сжатие
+    header.push_back(0);          // фильтрация
+    header.push_back(0);          // без чересстрочности
+
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    std::vector<uint8_t> png(signature, signature + 8);
+    appendChunk(png, "IHDR", header);
+    appendChunk(png, "IDAT", zlib);
+    appendChunk(png, "IEND", {});
+    return png;
+}
+
+bool Image::saveToFile(const std::string& filename) const {
+    const std::string::size_type dot = filename.find_last_of('.');
+    if (dot == std::string::npos || width_ == 0 || height_ == 0)
+        return false;
+
+    std::string extension = filename.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (extension != "png")
+        return false;
+
+    const std::vector<uint8_t> png = encodePNG();
+    std::ofstream file(filename, std::ios::binary);
+    if (!file)
+        return false;
+    file.write(reinterpret_cast<const char*>(png.data()), static_cast<std::streamsize>(png.size()));
+    return static_cast<bool>(file);
+}
+
+bool Image::loadFromFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file)
+        return false;
+    const std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return !bytes.empty() && loadFromMemory(bytes.data(), bytes.size());
+}
+
+bool Image::loadFromMemory(const void* data, size_t size) {
+    unsigned int width = 0;
+    unsigned int height = 0;
+    Format format = Format::RGBA;
+    std::vector<uint8_t> pixels;
+    if (!data || !decodePNG(static_cast<const uint8_t*>(data), size, width, height, format, pixels))
+        return false;
+    width_ = width;
+    height_ = height;
+    format_ = format;
+    data_ = std::move(pixels);
+    return true;
+}
+
 void Image::setPixel(unsigned int x, unsigned int y, const Color& color) {
     if (x < width_ && y < height_)
         setPixelUnsafe(x, y, color);
@@ -351,108 +919,250 @@ Image TextureGenerator::generatePerlinNoise(unsigned int width, unsigned int hei
 TextureAtlas::TextureAtlas(unsigned int width, unsigned int height)
     : atlasImage_(width, height, Image::Format::RGBA) {}
 
-bool TextureAtlas::addTexture(const std::string& name, const Image& texture) {
-    if (regionMap_.find(name) != regionMap_.end())
+bool TextureAtlas::allocate(unsigned int width, unsigned int height, Vector2f& outPosition) {
+    // Полочная упаковка: заполняем строку слева направо, затем начинаем новую
+    if (shelfX_ + width > atlasImage_.getWidth()) {
+        shelfX_ = 0;
+        shelfY_ += shelfHeight_;
+        shelfHeight_ = 0;
+    }
+
+    if (width > atlasImage_.getWidth() || shelfY_ + height > atlasImage_.getHeight())
         return false;
-        
-    // Simple packing algorithm (can be improved with better bin packing)
-    unsigned int currentX = 0;
-    unsigned int currentY = 0;
-    unsigned int maxRowHeight = 0;
-    
-    for (const auto& region : regions_) {
-        if (currentX + texture.getWidth() > atlasImage_.getWidth()) {
-            currentX = 0;
-            currentY += maxRowHeight;
-            maxRowHeight = 0;
+
+    outPosition = Vector2f(static_cast<float>(shelfX_), static_cast<float>(shelfY_));
+    shelfX_ += width;
+    shelfHeight_ = std::max(shelfHeight_, height);
+    return true;
+}
+
+uint32_t TextureAtlas::findDuplicate(uint64_t hash, const Image& texture) const {
+    auto range = contentIndex_.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        const Region& region = regions_[it->second];
+        if (static_cast<unsigned int>(region.bounds.size.x) != texture.getWidth() ||
+            static_cast<unsigned int>(region.bounds.size.y) != texture.getHeight())
+            continue;
+
+        // Хеш лишь кандидат: подтверждаем совпадение попиксельным сравнением
+        const unsigned int originX = static_cast<unsigned int>(region.bounds.position.x);
+        const unsigned int originY = static_cast<unsigned int>(region.bounds.position.y);
+        bool equal = true;
+        for (unsigned int y = 0; y < texture.getHeight() && equal; ++y) {
+            for (unsigned int x = 0; x < texture.getWidth(); ++x) {
+                const Color a = texture.getPixel(x, y);
+                const Color b = atlasImage_.getPixel(originX + x, originY + y);
+                if (a.r != b.r || a.g != b.g || a.b != b.b || a.a != b.a) {
+                    equal = false;
+                    break;
+                }
+            }
         }
-        
-        maxRowHeight = std::max(maxRowHeight, region.bounds.height);
-        currentX += region.bounds.width;
+        if (equal)
+            return it->second;
     }
-    
-    if (currentY + texture.getHeight() > atlasImage_.getHeight())
-        return false;
+    return RegionHandle::InvalidIndex;
+}
+
+TextureAtlas::RegionHandle TextureAtlas::addTexture(const std::string& name, const Image& texture) {
+    if (regionMap_.find(name) != regionMap_.end())
+        return RegionHandle();
+
+    const uint64_t hash = texture.computeHash();
+    const uint32_t duplicate = findDuplicate(hash, texture);
+    if (duplicate != RegionHandle::InvalidIndex) {
+        ++refCounts_[duplicate];
+        ++duplicateHits_;
+        regionMap_[name] = duplicate;
+        return makeHandle(duplicate);
+    }
+
+    Vector2f position;
+    if (!allocate(texture.getWidth(), texture.getHeight(), position))
+        return RegionHandle();
         
     // Copy texture to atlas
+    const unsigned int originX = static_cast<unsigned int>(position.x);
+    const unsigned int originY = static_cast<unsigned int>(position.y);
     for (unsigned int y = 0; y < texture.getHeight(); ++y) {
         for (unsigned int x = 0; x < texture.getWidth(); ++x) {
-            atlasImage_.setPixel(currentX + x, currentY + y, 
-                               texture.getPixel(x, y));
+            atlasImage_.setPixel(originX + x, originY + y, texture.getPixel(x, y));
         }
     }
     
-    // Add region
+    // Add region, reusing a freed slot when possible
     Region region;
-    region.bounds = Rect(currentX, currentY, 
-                        texture.getWidth(), texture.getHeight());
+    region.bounds = Rect(position, Vector2f(static_cast<float>(texture.getWidth()),
+                                            static_cast<float>(texture.getHeight())));
     region.name = name;
-    
-    regions_.push_back(region);
-    regionMap_[name] = regions_.size() - 1;
-    
+
+    uint32_t index;
+    if (!freeSlots_.empty()) {
+        index = freeSlots_.back();
+        freeSlots_.pop_back();
+        regions_[index] = std::move(region);
+        refCounts_[index] = 1;
+        contentHashes_[index] = hash;
+    } else {
+        index = static_cast<uint32_t>(regions_.size());
+        regions_.push_back(std::move(region));
+        generations_.push_back(0);
+        refCounts_.push_back(1);
+        contentHashes_.push_back(hash);
+    }
+
+    regionMap_[name] = index;
+    contentIndex_.emplace(hash, index);
+    return makeHandle(index);
+}
+
+void TextureAtlas::releaseSlot(uint32_t index) {
+    auto range = contentIndex_.equal_range(contentHashes_[index]);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == index) {
+            contentIndex_.erase(it);
+            break;
+        }
+    }
+
+    // Пиксели остаются в атласе до следующего optimize()
+    regions_[index] = Region();
+    refCounts_[index] = 0;
+    ++generations_[index];
+    freeSlots_.push_back(index);
+}
+
+bool TextureAtlas::removeTexture(const std::string& name) {
+    auto it = regionMap_.find(name);
+    if (it == regionMap_.end())
+        return false;
+
+    const uint32_t index = it->second;
+    regionMap_.erase(it);
+
+    if (--refCounts_[index] == 0) {
+        releaseSlot(index);
+        return true;
+    }
+
+    // Регион жив под другими именами; основное имя передаём одному из псевдонимов
+    if (regions_[index].name == name) {
+        for (const auto& entry : regionMap_) {
+            if (entry.second == index) {
+                regions_[index].name = entry.first;
+                break;
+            }
+        }
+    }
     return true;
 }
 
-const TextureAtlas::Region* TextureAtlas::getRegion(const std::string& name) const {
+bool TextureAtlas::removeTexture(RegionHandle handle) {
+    if (!getRegion(handle))
+        return false;
+
+    for (auto it = regionMap_.begin(); it != regionMap_.end();) {
+        if (it->second == handle.index)
+            it = regionMap_.erase(it);
+        else
+            ++it;
+    }
+    releaseSlot(handle.index);
+    return true;
+}
+
+TextureAtlas::Stats TextureAtlas::getStats() const {
+    Stats stats;
+    stats.duplicateHits = duplicateHits_;
+    for (size_t i = 0; i < regions_.size(); ++i) {
+        if (refCounts_[i] == 0)
+            continue;
+
+        const size_t bytes = static_cast<size_t>(regions_[i].bounds.size.x) *
+                             static_cast<size_t>(regions_[i].bounds.size.y) * 4;
+        ++stats.regionCount;
+        stats.aliasCount += refCounts_[i] - 1;
+        stats.bytesUsed += bytes;
+        stats.bytesSaved += bytes * (refCounts_[i] - 1);
+    }
+    return stats;
+}
+
+TextureAtlas::RegionHandle TextureAtlas::findRegion(const std::string& name) const {
     auto it = regionMap_.find(name);
     if (it != regionMap_.end())
-        return &regions_[it->second];
-    return nullptr;
+        return makeHandle(it->second);
+    return RegionHandle();
+}
+
+const TextureAtlas::Region* TextureAtlas::getRegion(const std::string& name) const {
+    return getRegion(findRegion(name));
 }
 
-void TextureAtlas::optimize() {
-    // Sort regions by height
-    std::sort(regions_.begin(), regions_.end(),
-              [](const Region& a, const Region& b) {
-                  return a.bounds.height > b.bounds.height;
+bool TextureAtlas::optimize() {
+    // Sort live regions by height; the slots themselves stay put so handles remain valid
+    std::vector<uint32_t> order;
+    order.reserve(regions_.size());
+    for (uint32_t i = 0; i < regions_.size(); ++i) {
+        if (refCounts_[i] > 0)
+            order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(),
+              [this](uint32_t a, uint32_t b) {
+                  return regions_[a].bounds.size.y > regions_[b].bounds.size.y;
               });
-              
-    // Create new atlas with optimized layout
-    Image newAtlas(atlasImage_.getWidth(), atlasImage_.getHeight(), 
-                  atlasImage_.getFormat());
-                  
-    unsigned int currentX = 0;
-    unsigned int currentY = 0;
-    unsigned int rowHeight = 0;
-    
-    for (auto& region : regions_) {
-        if (currentX + region.bounds.width > newAtlas.getWidth()) {
-            currentX = 0;
-            currentY += rowHeight;
-            rowHeight = 0;
+
+    // Trial layout first: a region that does not fit must not be left
+    // pointing into the new, blank atlas
+    const unsigned int oldShelfX = shelfX_;
+    const unsigned int oldShelfY = shelfY_;
+    const unsigned int oldShelfHeight = shelfHeight_;
+    shelfX_ = shelfY_ = shelfHeight_ = 0;
+
+    std::vector<Vector2f> positions(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        const Region& region = regions_[order[i]];
+        if (!allocate(static_cast<unsigned int>(region.bounds.size.x),
+                      static_cast<unsigned int>(region.bounds.size.y), positions[i])) {
+            shelfX_ = oldShelfX;
+            shelfY_ = oldShelfY;
+            shelfHeight_ = oldShelfHeight;
+            return false;
         }
-        
-        // Copy region to new position
-        for (unsigned int y = 0; y < region.bounds.height; ++y) {
-            for (unsigned int x = 0; x < region.bounds.width; ++x) {
-                newAtlas.setPixel(currentX + x, currentY + y,
-                                atlasImage_.getPixel(
-                                    region.bounds.x + x,
-                                    region.bounds.y + y));
+    }
+
+    // Every region fits: copy pixels into the new atlas and commit positions
+    Image newAtlas(atlasImage_.getWidth(), atlasImage_.getHeight(),
+                  atlasImage_.getFormat());
+    for (size_t i = 0; i < order.size(); ++i) {
+        Region& region = regions_[order[i]];
+        const Vector2f& position = positions[i];
+        const unsigned int width = static_cast<unsigned int>(region.bounds.size.x);
+        const unsigned int height = static_cast<unsigned int>(region.bounds.size.y);
+        const unsigned int srcX = static_cast<unsigned int>(region.bounds.position.x);
+        const unsigned int srcY = static_cast<unsigned int>(region.bounds.position.y);
+        for (unsigned int y = 0; y < height; ++y) {
+            for (unsigned int x = 0; x < width; ++x) {
+                newAtlas.setPixel(static_cast<unsigned int>(position.x) + x,
+                                  static_cast<unsigned int>(position.y) + y,
+                                  atlasImage_.getPixel(srcX + x, srcY + y));
             }
         }
-        
-        // Update region position
-        region.bounds.x = currentX;
-        region.bounds.y = currentY;
-        
-        currentX += region.bounds.width;
-        rowHeight = std::max(rowHeight, region.bounds.height);
+        region.bounds.position = position;
     }
-    
     atlasImage_ = std::move(newAtlas);
-    
-    // Update region map
-    regionMap_.clear();
-    for (size_t i = 0; i < regions_.size(); ++i) {
-        regionMap_[regions_[i].name] = i;
-    }
+    return true;
 }
 
 void TextureAtlas::clear() {
     regions_.clear();
+    generations_.clear();
+    freeSlots_.clear();
+    refCounts_.clear();
+    contentHashes_.clear();
     regionMap_.clear();
+    contentIndex_.clear();
+    shelfX_ = shelfY_ = shelfHeight_ = 0;
     atlasImage_.create(atlasImage_.getWidth(), atlasImage_.getHeight(),
                       atlasImage_.getFormat());
 }
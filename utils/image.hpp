@@ -23,10 +23,15 @@ public:
     Image(unsigned int width, unsigned int height, Format format = Format::RGBA);
     ~Image();
 
-    // Загрузка и сохранение
+    // Загрузка и сохранение. Читается PNG с 8 битами на канал без
+    // чересстрочности; при ошибке изображение не меняется
     bool loadFromFile(const std::string& filename);
     bool loadFromMemory(const void* data, size_t size);
-    bool saveToFile(const std::string& filename) const;
+    bool saveToFile(const std::string& filename) const;   // пока поддерживается только .png
+    
+    // Кодирование в PNG без внешних зависимостей: deflate без сжатия,
+    // поэтому результат побайтно повторяем, но крупнее, чем у zlib
+    std::vector<uint8_t> encodePNG() const;
     
     // Создание и изменение размера
     void create(unsigned int width, unsigned int height, Format format = Format::RGBA);
@@ -78,6 +83,9 @@ public:
     uint8_t* getData() { return data_.data(); }
     size_t getSize() const { return data_.size(); }
 
+    // Быстрый некриптографический хеш содержимого (размеры, формат и пиксели)
+    uint64_t computeHash() const;
+
 private:
     unsigned int width_;
     unsigned int height_;
@@ -122,16 +130,60 @@ public:
         std::string name;
     };
 
+    // Стабильный дескриптор региона. Остаётся валидным до removeTexture()/clear(),
+    // в том числе после optimize(); поколение отсекает устаревшие дескрипторы
+    // при повторном использовании слота.
+    struct RegionHandle {
+        uint32_t index = InvalidIndex;
+        uint32_t generation = 0;
+
+        static constexpr uint32_t InvalidIndex = 0xFFFFFFFFu;
+
+        bool isValid() const { return index != InvalidIndex; }
+        explicit operator bool() const { return isValid(); }
+
+        bool operator==(const RegionHandle& other) const {
+            return index == other.index && generation == other.generation;
+        }
+        bool operator!=(const RegionHandle& other) const { return !(*this == other); }
+    };
+
+    struct Stats {
+        size_t regionCount = 0;     // уникальные регионы в атласе
+        size_t aliasCount = 0;      // имена, указывающие на уже существующий регион
+        size_t duplicateHits = 0;   // всего совпадений по содержимому за время жизни
+        size_t bytesUsed = 0;       // пиксели уникальных регионов в атласе
+        size_t bytesSaved = 0;      // память, сэкономленная за счёт псевдонимов
+    };
+
     TextureAtlas(unsigned int width, unsigned int height);
     
-    bool addTexture(const std::string& name, const Image& texture);
-    bool removeTexture(const std::string& name);
-    
+    // Возвращает невалидный дескриптор, если имя занято или не хватило места.
+    // Текстура, побайтно совпадающая с уже добавленной, не занимает место в атласе:
+    // имя становится псевдонимом существующего региона и получает его дескриптор.
+    RegionHandle addTexture(const std::string& name, const Image& texture);
+    bool removeTexture(const std::string& name);    // снимает одно имя
+    bool removeTexture(RegionHandle handle);        // снимает регион со всеми псевдонимами
+    
+    // Быстрый путь: прямой индекс в массиве регионов
+    const Region* getRegion(RegionHandle handle) const {
+        if (handle.index >= regions_.size() || generations_[handle.index] != handle.generation)
+            return nullptr;
+        return &regions_[handle.index];
+    }
+
+    // Медленный путь для инструментов: хеширование строки и поиск в таблице
     const Region* getRegion(const std::string& name) const;
+    RegionHandle findRegion(const std::string& name) const;
+
     const Image& getAtlasImage() const { return atlasImage_; }
+    size_t getRegionCount() const { return regionMap_.size(); }
+    Stats getStats() const;
     
     void clear();
-    void optimize();
+    // Плотно перепаковывает живые регионы. Если они не помещаются,
+    // атлас не меняется и возвращается false
+    bool optimize();
     
     bool saveToFile(const std::string& filename) const;
     bool loadFromFile(const std::string& filename);
@@ -139,7 +191,23 @@ public:
 private:
     Image atlasImage_;
     std::vector<Region> regions_;
-    std::unordered_map<std::string, size_t> regionMap_;
+    std::vector<uint32_t> generations_;
+    std::vector<uint32_t> freeSlots_;
+    std::vector<uint32_t> refCounts_;
+    std::vector<uint64_t> contentHashes_;
+    std::unordered_map<std::string, uint32_t> regionMap_;
+    std::unordered_multimap<uint64_t, uint32_t> contentIndex_;
+    size_t duplicateHits_ = 0;
+
+    // Курсор полочной упаковки
+    unsigned int shelfX_ = 0;
+    unsigned int shelfY_ = 0;
+    unsigned int shelfHeight_ = 0;
+
+    bool allocate(unsigned int width, unsigned int height, Vector2f& outPosition);
+    uint32_t findDuplicate(uint64_t hash, const Image& texture) const;
+    void releaseSlot(uint32_t index);
+    RegionHandle makeHandle(uint32_t index) const { return RegionHandle{index, generations_[index]}; }
 };
 
 } // namespace gui::utils
\ No newline at end of file
@@ -0,0 +1,148 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace gui::utils {
+
+template<typename Signature, size_t Capacity = 32>
+class SmallFunction;
+
+// Вызываемый объект с хранением на месте: функтор до Capacity байт (лямбда
+// с несколькими захватами, std::function) лежит внутри объекта, без
+// выделения памяти. Больший или с особым выравниванием уходит в кучу.
+// Копирование и перемещение — через таблицу операций одного типа функтора.
+template<typename R, typename... Args, size_t Capacity>
+class SmallFunction<R(Args...), Capacity> {
+public:
+    SmallFunction() = default;
+    SmallFunction(std::nullptr_t) {}
+
+    template<typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, SmallFunction> &&
+                                                     std::is_invocable_r_v<R, std::decay_t<F>&, Args...>>>
+    SmallFunction(F&& function) {
+        using Functor = std::decay_t<F>;
+        static_assert(std::is_copy_constructible_v<Functor>, "SmallFunction требует копируемый функтор");
+        if constexpr (std::is_constructible_v<bool, const Functor&>) {
+            // Пустой std::function или нулевой указатель — пустой SmallFunction
+            if (!static_cast<bool>(function))
+                return;
+        }
+        if constexpr (fitsInline<Functor>()) {
+            new (storage_) Functor(std::forward<F>(function));
+            ops_ = &InlineOps<Functor>::table;
+        } else {
+            new (storage_) Functor*(new Functor(std::forward<F>(function)));
+            ops_ = &HeapOps<Functor>::table;
+        }
+    }
+
+    SmallFunction(const SmallFunction& other) {
+        if (other.ops_) {
+            other.ops_->copy(storage_, other.storage_);
+            ops_ = other.ops_;
+        }
+    }
+
+    SmallFunction(SmallFunction&& other) noexcept {
+        if (other.ops_) {
+            other.ops_->move(storage_, other.storage_);
+            ops_ = other.ops_;
+            other.ops_ = nullptr;
+        }
+    }
+
+    ~SmallFunction() { reset(); }
+
+    SmallFunction& operator=(const SmallFunction& other) {
+        if (this != &other) {
+            SmallFunction copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    SmallFunction& operator=(SmallFunction&& other) noexcept {
+        if (this != &other) {
+            reset();
+            if (other.ops_) {
+                other.ops_->move(storage_, other.storage_);
+                ops_ = other.ops_;
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    SmallFunction& operator=(std::nullptr_t) {
+        reset();
+        return *this;
+    }
+
+    void reset() {
+        if (ops_) {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    explicit operator bool() const { return ops_ != nullptr; }
+
+    R operator()(Args... args) const {
+        return ops_->invoke(const_cast<unsigned char*>(storage_), std::forward<Args>(args)...);
+    }
+
+    // Функтор хранится внутри объекта, без кучи
+    bool isInline() const { return ops_ && ops_->isInline; }
+
+private:
+    struct Ops {
+        R (*invoke)(void* storage, Args&&... args);
+        void (*copy)(void* destination, const void* source);
+        void (*move)(void* destination, void* source);
+        void (*destroy)(void* storage);
+        bool isInline;
+    };
+
+    template<typename Functor>
+    static constexpr bool fitsInline() {
+        return sizeof(Functor) <= Capacity && alignof(Functor) <= alignof(void*) &&
+               std::is_nothrow_move_constructible_v<Functor>;
+    }
+
+    template<typename Functor>
+    struct InlineOps {
+        static Functor& get(void* storage) { return *std::launder(reinterpret_cast<Functor*>(storage)); }
+        static R invoke(void* storage, Args&&... args) { return get(storage)(std::forward<Args>(args)...); }
+        static void copy(void* destination, const void* source) {
+            new (destination) Functor(get(const_cast<void*>(source)));
+        }
+        static void move(void* destination, void* source) {
+            new (destination) Functor(std::move(get(source)));
+            get(source).~Functor();
+        }
+        static void destroy(void* storage) { get(storage).~Functor(); }
+        static constexpr Ops table = {&invoke, &copy, &move, &destroy, true};
+    };
+
+    template<typename Functor>
+    struct HeapOps {
+        static Functor*& get(void* storage) { return *std::launder(reinterpret_cast<Functor**>(storage)); }
+        static R invoke(void* storage, Args&&... args) { return (*get(storage))(std::forward<Args>(args)...); }
+        static void copy(void* destination, const void* source) {
+            new (destination) Functor*(new Functor(*get(const_cast<void*>(source))));
+        }
+        static void move(void* destination, void* source) {
+            new (destination) Functor*(get(source));
+            get(source) = nullptr;
+        }
+        static void destroy(void* storage) { delete get(storage); }
+        static constexpr Ops table = {&invoke, &copy, &move, &destroy, false};
+    };
+
+    alignas(void*) unsigned char storage_[Capacity];
+    const Ops* ops_ = nullptr;
+};
+
+} // namespace gui::utils
\ No newline at end of file
@@ -0,0 +1,129 @@
+#pragma once
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <atomic>
+#include <algorithm>
+
+namespace gui::utils {
+
+// Пул рабочих потоков для параллельного рендеринга и фоновых задач
+class ThreadPool {
+public:
+    // threadCount == 0 — по числу аппаратных потоков минус вызывающий
+    explicit ThreadPool(unsigned int threadCount = 0) {
+        if (threadCount == 0) {
+            const unsigned int hardware = std::thread::hardware_concurrency();
+            threadCount = hardware > 1 ? hardware - 1 : 1;
+        }
+
+        workers_.reserve(threadCount);
+        for (unsigned int i = 0; i < threadCount; ++i) {
+            workers_.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        condition_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t getThreadCount() const { return workers_.size(); }
+
+    template<typename F>
+    auto submit(F&& task) -> std::future<decltype(task())> {
+        using Result = decltype(task());
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.emplace([packaged]() { (*packaged)(); });
+        }
+        condition_.notify_one();
+        return result;
+    }
+
+    // Выполняет body(i) для i в [0, count). Вызывающий поток участвует в работе,
+    // поэтому вложенный вызов из задачи пула не приводит к взаимоблокировке.
+    void parallelFor(size_t count, const std::function<void(size_t)>& body) {
+        if (count == 0)
+            return;
+        if (count == 1 || workers_.empty()) {
+            for (size_t i = 0; i < count; ++i) {
+                body(i);
+            }
+            return;
+        }
+
+        struct Shared {
+            std::atomic<size_t> next{0};
+            std::atomic<size_t> done{0};
+            std::mutex mutex;
+            std::condition_variable finished;
+        };
+        auto shared = std::make_shared<Shared>();
+
+        auto run = [shared, count, &body]() {
+            size_t completed = 0;
+            for (size_t i = shared->next.fetch_add(1); i < count; i = shared->next.fetch_add(1)) {
+                body(i);
+                ++completed;
+            }
+            if (completed > 0 && shared->done.fetch_add(completed) + completed == count) {
+                std::lock_guard<std::mutex> lock(shared->mutex);
+                shared->finished.notify_all();
+            }
+        };
+
+        const size_t helpers = std::min(workers_.size(), count - 1);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (size_t i = 0; i < helpers; ++i) {
+                tasks_.emplace(run);
+            }
+        }
+        condition_.notify_all();
+
+        run();
+
+        std::unique_lock<std::mutex> lock(shared->mutex);
+        shared->finished.wait(lock, [&]() { return shared->done.load() == count; });
+    }
+
+private:
+    void workerLoop() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                condition_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+                if (stopping_ && tasks_.empty())
+                    return;
+                task = std::move(tasks_.front());
+                tasks_.pop();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    bool stopping_ = false;
+};
+
+} // namespace gui::utils
\ No newline at end of file